@@ -88,6 +88,14 @@ public:
 
 	virtual void applyQualitySettings();
 
+	// devices calling Mixer::renderNextBuffer() right from their audio
+	// callback instead of reading what the FIFO writer thread rendered
+	// re-implement this
+	virtual bool rendersInCallback() const
+	{
+		return false;
+	}
+
 
 
 protected:
@@ -99,7 +107,8 @@ protected:
 	{
 	}
 
-	// called by according driver for fetching new sound-data
+	// called by according driver for fetching new sound-data - never
+	// returns more than framesPerPeriod() frames
 	fpp_t getNextBuffer( surroundSampleFrame * _ab );
 
 	// convert a given audio-buffer to a buffer in signed 16-bit samples
@@ -115,16 +124,15 @@ protected:
 							const fpp_t _frames );
 
 	// resample given buffer from samplerate _src_sr to samplerate _dst_sr
-	void resample( const surroundSampleFrame * _src,
+	// into at most _dst_frames frames, returns num of frames generated
+	f_cnt_t resample( const surroundSampleFrame * _src,
 					const fpp_t _frames,
 					surroundSampleFrame * _dst,
+					const f_cnt_t _dst_frames,
 					const sample_rate_t _src_sr,
 					const sample_rate_t _dst_sr );
 
-	inline void setSampleRate( const sample_rate_t _new_sr )
-	{
-		m_sampleRate = _new_sr;
-	}
+	void setSampleRate( const sample_rate_t _new_sr );
 
 	Mixer* mixer()
 	{
@@ -141,6 +149,11 @@ protected:
 
 
 private:
+	fpp_t getNextResampledBuffer( surroundSampleFrame * _ab );
+	// makes room for what a period resampled at the current rates
+	// can leave
+	void reserveResampled();
+
 	sample_rate_t m_sampleRate;
 	ch_cnt_t m_channels;
 	Mixer* m_mixer;
@@ -150,6 +163,12 @@ private:
 
 	SRC_DATA m_srcData;
 	SRC_STATE * m_srcState;
+	int m_srcInterpolation;
+
+	// resampled frames not handed out yet
+	surroundSampleFrame * m_resampled;
+	f_cnt_t m_resampledSize;
+	f_cnt_t m_resampledFrames;
 
 	surroundSampleFrame * m_buffer;
 
@@ -37,12 +37,14 @@
 #include <QtCore/QVector>
 #include <QtCore/QList>
 #include <QtCore/QMap>
+#include <QtCore/QMutex>
 
 #include "AudioDevice.h"
 #include "AudioDeviceSetupWidget.h"
 
 class QLineEdit;
 class LcdSpinBox;
+class LedCheckBox;
 class MidiJack;
 
 
@@ -77,6 +79,7 @@ public:
 	private:
 		QLineEdit * m_clientName;
 		LcdSpinBox * m_channels;
+		LedCheckBox * m_renderInCallback;
 
 	} ;
 
@@ -92,6 +95,11 @@ private:
 	virtual void stopProcessing();
 	virtual void applyQualitySettings();
 
+	virtual bool rendersInCallback() const
+	{
+		return m_renderInCallback;
+	}
+
 	virtual void registerPort( AudioPort * _port );
 	virtual void unregisterPort( AudioPort * _port );
 	virtual void renamePort( AudioPort * _port );
@@ -113,9 +121,17 @@ private:
 	jack_default_audio_sample_t * * m_tempOutBufs;
 	surroundSampleFrame * m_outBuf;
 
+	// whether the mixer renders right in processCallback(), in that case
+	// m_curBuf points to the mixer's buffer unless it has to be resampled
+	bool m_renderInCallback;
+	const surroundSampleFrame * m_curBuf;
 	f_cnt_t m_framesDoneInCurBuf;
 	f_cnt_t m_framesToDoInCurBuf;
 
+	// held while rendering in the callback, so stopProcessing() can wait
+	// for it to finish
+	QMutex m_renderMutex;
+
 
 #ifdef AUDIO_PORT_SUPPORT
 	struct StereoPort
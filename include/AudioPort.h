@@ -33,6 +33,7 @@
 #include "PlayHandle.h"
 
 class EffectChain;
+class FreezeCache;
 class FloatModel;
 class BoolModel;
 
@@ -108,6 +109,28 @@ public:
 	void addPlayHandle( PlayHandle * handle );
 	void removePlayHandle( PlayHandle * handle );
 
+	// while frozen, play-handle output is passed to the fx mixer as is
+	inline bool isFrozen() const
+	{
+		return m_frozen;
+	}
+
+	inline void setFrozen( bool _frozen )
+	{
+		m_frozen = _frozen;
+	}
+
+	// if set, every processed period is appended to the given cache
+	inline void setFreezeCapture( FreezeCache * _cache )
+	{
+		m_freezeCapture = _cache;
+	}
+
+	inline FreezeCache * freezeCapture() const
+	{
+		return m_freezeCapture;
+	}
+
 private:
 	volatile bool m_bufferUsage;
 
@@ -128,6 +151,9 @@ private:
 	FloatModel * m_panningModel;
 	BoolModel * m_mutedModel;
 
+	volatile bool m_frozen;
+	FreezeCache * m_freezeCapture;
+
 	friend class Mixer;
 	friend class MixerWorkerThread;
 
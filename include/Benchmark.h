@@ -0,0 +1,79 @@
+/*
+ * Benchmark.h - renders synthetic projects and measures the mixer's speed
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QString>
+#include <QtCore/QStringList>
+
+
+//! Backend of the "bench" command: builds a project of _tracks instrument
+//! tracks, each playing a chord of _voices notes through the given effect
+//! chain, renders it offline with a varying number of mixer threads and
+//! reports the period times as JSON.
+//!
+//! The project is built from a fixed random seed and every run starts from
+//! the song's beginning, so results of different builds are comparable.
+class Benchmark
+{
+public:
+	Benchmark( int _tracks, int _voices, const QString & _instrument,
+				const QStringList & _effects, int _periods );
+	~Benchmark();
+
+	//! Creates the project, prints an error and returns false if the
+	//! instrument or one of the effects can't be loaded. Must be called
+	//! once the engine has been initialized.
+	bool createProject();
+
+	//! Renders the project once for each entry of _threads and returns the
+	//! results. An empty list benchmarks 1, 2, 4, ... threads up to the
+	//! number of threads the mixer has been started with.
+	QByteArray run( QList<int> _threads );
+
+
+private:
+	struct Result
+	{
+		int threads;
+		double periodsPerSecond;
+		double p50;
+		double p99;
+		double max;
+		double realtimeFactor;
+	} ;
+
+	Result runWithThreads( int _threads );
+
+	int m_tracks;
+	int m_voices;
+	QString m_instrument;
+	QStringList m_effects;
+	int m_periods;
+
+} ;
+
+
+#endif
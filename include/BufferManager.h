@@ -33,7 +33,6 @@
 class EXPORT BufferManager
 {
 public:
-	static void init( fpp_t framesPerPeriod );
 	static sampleFrame * acquire();
 	// audio-buffer-mgm
 	static void clear( sampleFrame * ab, const f_cnt_t frames,
@@ -166,6 +166,10 @@ protected:
 	static long s_periods;
 
 
+private slots:
+	void updateFramesPerPeriod();
+
+
 signals:
 	// The value changed while the mixer isn't running (i.e: MIDI CC)
 	void valueChanged();
@@ -28,11 +28,14 @@
 #define DATA_FILE_H
 
 #include <QDomDocument>
+#include <QList>
+#include <QVector>
 
 #include "export.h"
 #include "MemoryManager.h"
 
 class QTextStream;
+class SampleData;
 
 class EXPORT DataFile : public QDomDocument
 {
@@ -84,6 +87,58 @@ public:
 		return m_type;
 	}
 
+	//! Makes savers store sample data through addSampleData() instead of
+	//! embedding it as base64 - only possible if the file is written as a
+	//! project bundle, see ProjectBundle.
+	void setBundled( bool _bundled )
+	{
+		m_bundled = _bundled;
+	}
+
+	bool isBundled() const
+	{
+		return m_bundled;
+	}
+
+	//! Adds _data to the binary entries written along with the XML and
+	//! returns the reference to store in the XML instead of the frames.
+	QString addSampleData( SampleData * _data );
+
+	//! Returns the sample data _ref refers to in the bundle _element has
+	//! been loaded from, with a reference held by the caller, or NULL.
+	//! Only works as long as the DataFile exists.
+	static SampleData * sampleData( const QDomElement & _element,
+						const QString & _ref );
+
+	//! A note of a pattern the streaming loader kept out of the DOM. Notes
+	//! with children, e.g. detuning, stay in the DOM - inDom marks their
+	//! place among the others.
+	struct StreamedNote
+	{
+		int key;
+		int volume;
+		int panning;
+		int length;
+		int pos;
+		bool inDom;
+	} ;
+
+	//! A point of an automation pattern the streaming loader kept out of
+	//! the DOM.
+	struct StreamedTimePoint
+	{
+		int pos;
+		float value;
+	} ;
+
+	//! Return the notes or points the streaming loader took from
+	//! _element, or NULL if all of them are in the DOM. Only valid as long
+	//! as the DataFile exists.
+	static const QVector<StreamedNote> * streamedNotes(
+					const QDomElement & _element );
+	static const QVector<StreamedTimePoint> * streamedTimePoints(
+					const QDomElement & _element );
+
 private:
 	static Type type( const QString& typeName );
 	static QString typeName( Type type );
@@ -112,6 +167,9 @@ private:
 	void upgrade();
 
 	void loadData( const QByteArray & _data, const QString & _sourceFile );
+	void loadBundle( const QString & _fileName );
+	bool loadStreamed( const QByteArray & _data );
+	static const DataFile * streamedFile( const QDomElement & _element );
 
 
 	struct EXPORT typeDescStruct
@@ -125,6 +183,16 @@ private:
 	QDomElement m_head;
 	Type m_type;
 
+	bool m_bundled;
+	// samples added for saving or loaded from a bundle
+	QList<SampleData *> m_sampleData;
+
+	// serial under which the DataFile can be found by streamedNotes() and
+	// streamedTimePoints(), -1 if nothing has been streamed
+	int m_streamSerial;
+	QVector<QVector<StreamedNote> > m_streamedNotes;
+	QVector<QVector<StreamedTimePoint> > m_streamedTimePoints;
+
 } ;
 
 
@@ -0,0 +1,129 @@
+/*
+ * FreezeCache.h - memory-mapped audio cache holding the rendered output of a
+ *                 frozen track
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef FREEZE_CACHE_H
+#define FREEZE_CACHE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "export.h"
+#include "lmms_basics.h"
+#include "shared_object.h"
+
+class QDomDocument;
+class QFile;
+
+
+//! Fixed-size float cache backed by a memory-mapped temporary file, so that
+//! frozen tracks don't pin their whole render in RAM.
+class EXPORT FreezeCache : public sharedObject
+{
+public:
+	FreezeCache();
+	virtual ~FreezeCache();
+
+	//! (Re)creates the backing file for _frames zeroed frames - if no file
+	//! name is given, a temporary file is used which is removed again
+	//! once the cache is released
+	bool allocate( f_cnt_t _frames, sample_rate_t _sampleRate,
+					const QByteArray & _stateHash,
+					const QString & _fileName = QString() );
+
+	//! Maps a previously written cache file read-only
+	bool load( const QString & _fileName, sample_rate_t _sampleRate,
+					const QByteArray & _stateHash );
+
+	bool isValid() const
+	{
+		return m_data != NULL;
+	}
+
+	f_cnt_t frames() const
+	{
+		return m_frames;
+	}
+
+	sample_rate_t sampleRate() const
+	{
+		return m_sampleRate;
+	}
+
+	const QByteArray & stateHash() const
+	{
+		return m_stateHash;
+	}
+
+	//! Appends _frames frames at the current write position, used while
+	//! rendering; frames past the end of the cache are dropped
+	void write( const sampleFrame * _src, const fpp_t _frames );
+
+	f_cnt_t framesWritten() const
+	{
+		return m_writePos;
+	}
+
+	//! Records that _tick started _offset frames into the period being
+	//! written next, so that playback finds it even if the tempo changed
+	//! in between
+	void markTick( tick_t _tick, f_cnt_t _offset );
+
+	//! Returns the frame _tick started at while rendering - ticks which
+	//! weren't recorded are extrapolated with _framesPerTick
+	f_cnt_t tickFrame( tick_t _tick, float _framesPerTick ) const;
+
+	//! Copies _frames frames starting at _pos into _dst and zero-fills
+	//! everything outside of the cached range
+	void read( f_cnt_t _pos, sampleFrame * _dst, const fpp_t _frames ) const;
+
+	//! Sequential counterpart of read(), for consumers which play the cache
+	//! from start to end exactly once
+	void readNext( sampleFrame * _dst, const fpp_t _frames )
+	{
+		read( m_readPos, _dst, _frames );
+		m_readPos += _frames;
+	}
+
+	//! SHA1 over _doc with all journalling metadata removed, as the IDs in
+	//! there change from session to session
+	static QByteArray hashState( QDomDocument & _doc );
+
+
+private:
+	void release();
+
+	QFile * m_file;
+	sampleFrame * m_data;
+	f_cnt_t m_frames;
+	f_cnt_t m_writePos;
+	f_cnt_t m_readPos;
+	sample_rate_t m_sampleRate;
+	QByteArray m_stateHash;
+	// frame each tick started at, -1 for ticks not rendered
+	QVector<f_cnt_t> m_tickFrames;
+
+} ;
+
+
+#endif
@@ -0,0 +1,70 @@
+/*
+ * FreezePlayHandle.h - play-handle streaming the cached output of a frozen
+ *                      instrument track
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef FREEZE_PLAY_HANDLE_H
+#define FREEZE_PLAY_HANDLE_H
+
+#include "PlayHandle.h"
+
+class FreezeCache;
+class InstrumentTrack;
+
+
+class FreezePlayHandle : public PlayHandle
+{
+public:
+	FreezePlayHandle( InstrumentTrack * _track, FreezeCache * _cache );
+	virtual ~FreezePlayHandle();
+
+	// called by InstrumentTrack::play() - the frame at _offset within the
+	// current period corresponds to _cacheFrame of the frozen render
+	void seek( f_cnt_t _offset, f_cnt_t _cacheFrame );
+
+	virtual void play( sampleFrame * _working_buffer );
+	virtual bool isFinished() const;
+
+	virtual bool isFromTrack( const Track * _track ) const;
+
+
+private:
+	struct SeekPoint
+	{
+		f_cnt_t offset;
+		f_cnt_t frame;
+	} ;
+
+	static const int MaxSeekPoints = 64;
+
+	InstrumentTrack * m_track;
+	FreezeCache * m_cache;
+
+	// position inside the cache at the start of the next period
+	f_cnt_t m_position;
+
+	SeekPoint m_seekPoints[MaxSeekPoints];
+	int m_numSeekPoints;
+
+} ;
+
+
+#endif
@@ -31,6 +31,7 @@
 #include "ThreadableJob.h"
 
 
+class FreezeCache;
 class FxRoute;
 typedef QVector<FxRoute *> FxRouteVector;
 
@@ -66,6 +67,12 @@ class FxChannel : public ThreadableJob
 		// pointers to other channels that send to this one
 		FxRouteVector m_receives;
 
+		// used by RenderCache while exporting: take the channel's output
+		// from a cache, record it into one, or don't process it at all
+		FreezeCache * m_cachedOutput;
+		FreezeCache * m_outputCapture;
+		bool m_skipped;
+
 		virtual bool requiresProcessing() const { return true; }
 		void unmuteForSolo();
 
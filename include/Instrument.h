@@ -27,6 +27,7 @@
 #define INSTRUMENT_H
 
 #include <QString>
+#include <QAtomicPointer>
 #include "export.h"
 #include "lmms_basics.h"
 #include "MemoryManager.h"
@@ -36,6 +37,7 @@
 
 // forward-declarations
 class InstrumentTrack;
+template<typename T> class LocklessList;
 class MidiEvent;
 class NotePlayHandle;
 class Track;
@@ -132,10 +134,39 @@ protected:
 	// desiredReleaseFrames() frames are left
 	void applyRelease( sampleFrame * buf, const NotePlayHandle * _n );
 
+	// single streamed MIDI based instruments can queue the events they
+	// get in handleMidiEvent() together with their offset and render
+	// their period with renderSplitAtEvents(), so that each event takes
+	// effect right at the frame it belongs to instead of at the start of
+	// the period - if the queue is full, false is returned and the event
+	// should be applied right away
+	bool queueMidiEvent( const MidiEvent & _event, f_cnt_t _offset );
+
+	// splits the period at the offsets of the queued events and calls
+	// renderFrames() for the parts in between and processQueuedMidiEvent()
+	// for each event in the order of the offsets
+	void renderSplitAtEvents( sampleFrame * _buf, const fpp_t _frames );
+
+	// to be implemented by instruments using renderSplitAtEvents()
+	virtual void renderFrames( sampleFrame * /* _buf */,
+						const fpp_t /* _frames */ )
+	{
+	}
+
+	virtual void processQueuedMidiEvent( const MidiEvent & /* _event */ )
+	{
+	}
+
 
 private:
+	struct QueuedMidiEvent;
+	typedef LocklessList<QueuedMidiEvent> MidiEventQueue;
+
 	InstrumentTrack * m_instrumentTrack;
 
+	// only allocated once an instrument queues events
+	QAtomicPointer<MidiEventQueue> m_midiEventQueue;
+
 } ;
 
 Q_DECLARE_OPERATORS_FOR_FLAGS(Instrument::Flags)
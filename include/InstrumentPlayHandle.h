@@ -69,11 +69,19 @@ public:
 		return false;
 	}
 
+	// the instrument of a frozen track doesn't need to run
+	virtual bool requiresProcessing() const;
+
 	virtual bool isFromTrack( const Track* _track ) const
 	{
 		return m_instrument->isFromTrack( _track );
 	}
 
+	Instrument * instrument() const
+	{
+		return m_instrument;
+	}
+
 
 private:
 	Instrument* m_instrument;
@@ -47,6 +47,8 @@ class InstrumentFunctionNoteStackingView;
 class EffectRackView;
 class InstrumentSoundShapingView;
 class FadeButton;
+class FreezeCache;
+class FreezePlayHandle;
 class Instrument;
 class InstrumentTrackWindow;
 class InstrumentMidiIOView;
@@ -210,6 +212,26 @@ public:
 
 	void setPreviewMode( const bool );
 
+	// a frozen track plays back its pre-rendered output instead of running
+	// the instrument and its effect chain
+	bool isFrozen() const
+	{
+		return m_freezeCache != NULL;
+	}
+
+	// takes a reference on _cache, passing NULL unfreezes the track
+	void setFreezeCache( FreezeCache * _cache );
+
+	// hash over everything that affects the rendered output of this track
+	QByteArray freezeStateHash();
+
+	// called by FreezePlayHandle
+	void freezePlayHandleDeleted( FreezePlayHandle * _handle );
+
+
+public slots:
+	void unfreeze();
+
 
 signals:
 	void instrumentChanged();
@@ -231,9 +253,15 @@ protected slots:
 	void updatePitch();
 	void updatePitchRange();
 	void updateEffectChannel();
+	void checkFreezeState();
+	void scheduleFreezeCheck();
+	void watchFreezeState( TrackContentObject * _tco );
 
 
 private:
+	// whether automating _model changes the rendered output of this track
+	bool isFreezeRelevant( const Model * _model ) const;
+
 	MidiPort m_midiPort;
 
 	NotePlayHandle* m_notes[NumKeys];
@@ -270,6 +298,10 @@ private:
 
 	Piano m_piano;
 
+	FreezeCache * m_freezeCache;
+	FreezePlayHandle * m_freezePlayHandle;
+	bool m_freezeCheckPending;
+
 
 	friend class InstrumentTrackView;
 	friend class InstrumentTrackWindow;
@@ -315,6 +347,10 @@ public:
 	QMenu * createFxMenu( QString title, QString newFxLabel );
 
 
+public slots:
+	void freezeTrack();
+
+
 protected:
 	virtual void dragEnterEvent( QDragEnterEvent * _dee );
 	virtual void dropEvent( QDropEvent * _de );
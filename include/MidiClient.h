@@ -59,6 +59,10 @@ public:
 	// re-implemented methods HAVE to call removePort() of base-class!!
 	virtual void removePort( MidiPort * _port );
 
+	// called by the mixer at the start of every period for processing the
+	// events all ports received during the last one
+	void processQueuedInEvents( const fpp_t _frames );
+
 
 	// returns whether client works with raw-MIDI, only needs to be
 	// re-implemented by MidiClientRaw for returning true
@@ -109,6 +113,9 @@ public:
 protected:
 	QVector<MidiPort *> m_midiPorts;
 
+private:
+	qint64 m_lastPeriodStart;
+
 } ;
 
 
@@ -31,12 +31,13 @@
 #include <QtCore/QMap>
 
 #include "Midi.h"
+#include "MidiEvent.h"
 #include "MidiTime.h"
 #include "AutomatableModel.h"
+#include "LocklessList.h"
 
 
 class MidiClient;
-class MidiEvent;
 class MidiEventProcessor;
 class MidiPortMenu;
 
@@ -99,7 +100,19 @@ public:
 		return outputChannel() - 1;
 	}
 
+	// called by the MIDI client - the event is only queued, along with the
+	// time it has been received at, and processed at the next period
 	void processInEvent( const MidiEvent& event, const MidiTime& time = MidiTime() );
+
+	// passes the queued events on to the event processor, each at the
+	// offset within the period corresponding to when it has been received
+	// between periodStart and periodEnd
+	void processQueuedInEvents( qint64 periodStart, qint64 periodEnd,
+							fpp_t frames );
+
+	// monotonic time in nanoseconds events are timestamped with
+	static qint64 timestamp();
+
 	void processOutEvent( const MidiEvent& event, const MidiTime& time = MidiTime() );
 
 
@@ -161,6 +174,16 @@ private:
 	Map m_readablePorts;
 	Map m_writablePorts;
 
+	struct QueuedInEvent
+	{
+		MidiEvent event;
+		MidiTime time;
+		qint64 timestamp;
+	} ;
+
+	// written by the MIDI client, read by the mixer
+	LocklessList<QueuedInEvent> m_queuedInEvents;
+
 
 	friend class ControllerConnectionDialog;
 	friend class InstrumentMidiIOView;
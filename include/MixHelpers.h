@@ -73,6 +73,9 @@ void multiplyAndAddMultiplied( sampleFrame* dst, const sampleFrame* src, float c
 /*! \brief Multiply dst by coeffDst and add samples from srcLeft/srcRight multiplied by coeffSrc */
 void multiplyAndAddMultipliedJoined( sampleFrame* dst, const sample_t* srcLeft, const sample_t* srcRight, float coeffDst, float coeffSrc, int frames );
 
+/*! \brief Multiply samples from src by gain, clip them and convert them to signed 16 bit dst, optionally byte swapped - NaNs become silence */
+void convertToS16( int_sample_t* dst, const sample_t* src, float gain, int samples, bool swapBytes );
+
 }
 
 #endif
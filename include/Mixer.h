@@ -306,12 +306,34 @@ public:
 
 	void changeQuality( const struct qualitySettings & _qs );
 
+	//! Change the period size without restarting: rendering is stopped,
+	//! framesPerPeriodChanged() is emitted and the audio device is
+	//! reopened. Sizes above DEFAULT_BUFFER_SIZE only deepen the FIFO.
+	//! sampleRateChanged() is only emitted if the reopened device runs at
+	//! another rate.
+	void setFramesPerPeriod( fpp_t _frames );
+
 	inline bool isMetronomeActive() const { return m_metronomeActive; }
 	inline void setMetronomeActive(bool value = true) { m_metronomeActive = value; }
 
 	void requestChangeInModel();
 	void doneChangeInModel();
 
+	// whether the calling thread is in between requestChangeInModel() and
+	// doneChangeInModel()
+	bool isChangingModel() const
+	{
+		return m_changingThread == QThread::currentThread();
+	}
+
+	// audio devices rendering in their callback call this before
+	// rendering - if it returns false, the model is being changed and
+	// the period mustn't be rendered
+	bool startCallbackRendering();
+	// ... and this afterwards, so that changes to the model don't wait
+	// for a callback which might never come
+	void finishCallbackRendering();
+
 	static bool isAudioDevNameValid(QString name);
 	static bool isMidiDevNameValid(QString name);
 
@@ -319,6 +341,7 @@ public:
 signals:
 	void qualitySettingsChanged();
 	void sampleRateChanged();
+	void framesPerPeriodChanged();
 	void nextAudioBuffer( const surroundSampleFrame * buffer );
 
 
@@ -428,10 +451,16 @@ private:
 	QWaitCondition m_changesRequestCondition;
 
 	bool m_waitingForWrite;
+	// the thread holding m_doChangesMutex and how often it requested
+	QThread * m_changingThread;
+	int m_changeDepth;
 
+	friend class Benchmark;
 	friend class LmmsCore;
 	friend class MixerWorkerThread;
+	friend class PluginBenchmark;
 	friend class ProjectRenderer;
+	friend class TrackFreezer;
 
 } ;
 
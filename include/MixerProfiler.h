@@ -26,35 +26,131 @@
 #define MIXER_PROFILER_H
 
 #include <QFile>
+#include <QVector>
 
+#include "AtomicInt.h"
 #include "MicroTimer.h"
 
 class MixerProfiler
 {
 public:
+	// what's timed when tracing - see Scope
+	enum JobTypes
+	{
+		PlayHandleJob,
+		AudioPortJob,
+		EffectJob,
+		FxChannelJob,
+		PeriodJob
+	} ;
+
 	MixerProfiler();
 	~MixerProfiler();
 
 	void startPeriod()
 	{
 		m_periodTimer.reset();
+		if( m_tracing )
+		{
+			m_periodStart = now();
+		}
 	}
 
 	void finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPeriod );
 
+	// looks up the names of the jobs traced since the last call - has to
+	// be called while no jobs are running and before any of them gets
+	// deleted, so that the workers don't have to build them
+	void nameJobs()
+	{
+		if( m_tracing )
+		{
+			nameTraceEvents();
+		}
+	}
+
 	int cpuLoad() const
 	{
 		return m_cpuLoad;
 	}
 
+	// output files ending in ".json" get a Chrome trace (chrome://tracing)
+	// of every job processed, others just the time spent per period
 	void setOutputFile( const QString& outputFile );
 
 
+	// times the enclosing block as a job of the given type if tracing is
+	// enabled, otherwise costs just a single check
+	class Scope
+	{
+	public:
+		Scope( JobTypes type, void * job ) :
+			m_profiler( s_tracer )
+		{
+			if( m_profiler )
+			{
+				m_type = type;
+				m_job = job;
+				m_start = m_profiler->now();
+			}
+		}
+
+		~Scope()
+		{
+			if( m_profiler )
+			{
+				m_profiler->addJob( m_type, m_job, m_start );
+			}
+		}
+
+	private:
+		MixerProfiler * m_profiler;
+		JobTypes m_type;
+		void * m_job;
+		qint64 m_start;
+
+	} ;
+
+
 private:
+	struct TraceEvent
+	{
+		JobTypes type;
+		void * job;
+		QString name;
+		int thread;
+		qint64 start;
+		qint64 duration;
+	} ;
+
+	static const int MaxTraceEvents = 8192;
+	// slot of the event covering the whole period, filled in last
+	static const int PeriodTraceEvent = 0;
+
+	qint64 now() const;
+	void addJob( JobTypes type, void * job, qint64 start );
+	void nameTraceEvents();
+	void writeTraceEvents();
+	void closeOutputFile();
+
+	static QString jobName( JobTypes type, void * job );
+	static int currentThreadIndex();
+
+	static MixerProfiler * s_tracer;
+
 	MicroTimer m_periodTimer;
 	int m_cpuLoad;
 	QFile m_outputFile;
 
+	bool m_tracing;
+	qint64 m_traceStart;
+	qint64 m_periodStart;
+	TraceEvent * m_traceEvents;
+	AtomicInt m_traceEventCount;
+	int m_namedTraceEvents;
+	bool m_firstTraceEvent;
+	QVector<bool> m_namedThreads;
+
 };
 
 #endif
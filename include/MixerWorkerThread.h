@@ -102,6 +102,23 @@ public:
 
 	static void startAndWaitForJobs();
 
+	// number of threads working on the job queue, including the mixer thread
+	static int threadCount()
+	{
+		return workerThreads.size();
+	}
+
+	// lets only the first _threads threads (again including the mixer
+	// thread) take jobs from the queue, the others keep sleeping - used for
+	// measuring how processing scales with the number of threads
+	static void setActiveThreadCount( int _threads );
+
+	// makes the worker threads run with the given SCHED_FIFO priority, so
+	// they don't get preempted while the realtime thread of an audio
+	// device that renders in its callback waits for them - each thread
+	// applies it the next time it wakes up
+	static void setRealtimePriority( int _priority );
+
 
 private:
 	virtual void run();
@@ -109,8 +126,14 @@ private:
 	static JobQueue globalJobQueue;
 	static QWaitCondition * queueReadyWaitCond;
 	static QList<MixerWorkerThread *> workerThreads;
+	static volatile int s_activeWorkers;
+	static volatile int s_realtimePriority;
+
+	void applyRealtimePriority();
 
+	int m_index;
 	volatile bool m_quit;
+	int m_realtimePriority;
 
 } ;
 
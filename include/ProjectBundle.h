@@ -0,0 +1,69 @@
+/*
+ * ProjectBundle.h - project file format storing samples as binary entries
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef PROJECT_BUNDLE_H
+#define PROJECT_BUNDLE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QString>
+
+class QFile;
+class QIODevice;
+class SampleData;
+
+
+//! Reads and writes .mmpb files, which hold the compressed project XML and
+//! the frames of all embedded samples as separate binary entries. The XML
+//! refers to the entries by their index, see DataFile::addSampleData().
+//!
+//! Sample entries are stored raw if compressing them doesn't pay off, in
+//! which case they're copied to temporary files when loading and mapped
+//! from there instead of being held in memory. The bundle itself is never
+//! kept open, so it can be overwritten when saving. Otherwise the bytes of the floats are regrouped by significance
+//! before compressing them, which works considerably better for audio than
+//! compressing the floats as they are.
+class ProjectBundle
+{
+public:
+	static const char * Extension;
+
+	//! Returns whether _fileName has the extension of project bundles.
+	static bool isBundleName( const QString & _fileName );
+
+	//! Returns whether _device starts with a bundle header, without
+	//! consuming anything.
+	static bool isBundle( QIODevice * _device );
+
+	//! The i-th sample of _samples becomes entry i + 1.
+	static bool write( QFile & _file, const QByteArray & _xml,
+				const QList<SampleData *> & _samples );
+
+	//! Returns false if _fileName isn't a valid bundle. Every SampleData
+	//! added to _samples has a reference held by the caller.
+	static bool read( const QString & _fileName, QByteArray & _xml,
+					QList<SampleData *> & _samples );
+
+} ;
+
+
+#endif
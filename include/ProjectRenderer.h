@@ -30,6 +30,7 @@
 #include "Mixer.h"
 #include "OutputSettings.h"
 
+class RenderCache;
 
 class ProjectRenderer : public QThread
 {
@@ -88,6 +89,7 @@ private:
 
 	AudioFileDevice * m_fileDev;
 	Mixer::qualitySettings m_qualitySettings;
+	RenderCache * m_renderCache;
 
 	volatile int m_progress;
 	volatile bool m_abort;
@@ -35,9 +35,20 @@
 #include <cstring>
 #include <string>
 #include <cassert>
+#include <algorithm>
 
 
-#if !(defined(LMMS_HAVE_SYS_IPC_H) && defined(LMMS_HAVE_SEMAPHORE_H))
+#ifdef LMMS_BUILD_LINUX
+// exchange messages through shared memory and only enter the kernel if
+// the other side has to be woken up
+#define SYNC_WITH_SHM_FIFO
+#define USE_FUTEX
+
+#include <climits>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#elif !(defined(LMMS_HAVE_SYS_IPC_H) && defined(LMMS_HAVE_SEMAPHORE_H))
 #define SYNC_WITH_SHM_FIFO
 #define USE_QT_SEMAPHORES
 
@@ -91,6 +102,7 @@ typedef int32_t key_t;
 #include <QtCore/QMutex>
 #include <QtCore/QProcess>
 #include <QtCore/QThread>
+#include <QtCore/QVector>
 
 #ifndef SYNC_WITH_SHM_FIFO
 #include <poll.h>
@@ -101,13 +113,21 @@ typedef int32_t key_t;
 
 #ifdef SYNC_WITH_SHM_FIFO
 // sometimes we need to exchange bigger messages (e.g. for VST parameter dumps)
-// so set a usable value here
+// so set a usable value here - messages exceeding it are transferred in
+// chunks, it has to be a power of two
 const int SHM_FIFO_SIZE = 512*1024;
 
+// how often a waiting side polls the FIFO before going to sleep - the
+// other side usually answers within a few microseconds
+const int SHM_FIFO_SPIN_COUNT = 4096;
 
-// implements a FIFO inside a shared memory segment
+
+// implements a lock-free single-producer/single-consumer FIFO inside a
+// shared memory segment - each side only advances its own counter and
+// wakes up the other one if it went to sleep
 class shmFifo
 {
+#ifdef USE_QT_SEMAPHORES
 	// need this union to handle different sizes of sem_t on 32 bit
 	// and 64 bit platforms
 	union sem32_t
@@ -115,13 +135,17 @@ class shmFifo
 		int semKey;
 		char fill[32];
 	} ;
+#endif
 	struct shmData
 	{
-		sem32_t dataSem;	// semaphore for locking this
-					// FIFO management data
-		sem32_t messageSem;	// semaphore for incoming messages
-		volatile int32_t startPtr; // current start of FIFO in memory
-		volatile int32_t endPtr;   // current end of FIFO in memory
+#ifdef USE_QT_SEMAPHORES
+		sem32_t dataSem;	// semaphore for waking up the reader
+		sem32_t spaceSem;	// semaphore for waking up the writer
+#endif
+		volatile uint32_t readCount;	// bytes read so far
+		volatile uint32_t writeCount;	// bytes written so far
+		volatile int32_t readerSleeping;
+		volatile int32_t writerSleeping;
 		char data[SHM_FIFO_SIZE];  // actual data
 	} ;
 
@@ -137,10 +161,15 @@ public:
 		m_shmID( -1 ),
 #endif
 		m_data( NULL ),
+#ifdef USE_QT_SEMAPHORES
 		m_dataSem( QString::null ),
-		m_messageSem( QString::null ),
-		m_lockDepth( 0 )
+		m_spaceSem( QString::null ),
+#endif
+		m_lock()
 	{
+#ifdef BUILD_REMOTE_PLUGIN_CLIENT
+		pthread_mutex_init( &m_lock, NULL );
+#endif
 #ifdef USE_QT_SHMEM
 		do
 		{
@@ -157,15 +186,17 @@ public:
 		m_data = (shmData *) shmat( m_shmID, 0, 0 );
 #endif
 		assert( m_data != NULL );
-		m_data->startPtr = m_data->endPtr = 0;
+		m_data->readCount = m_data->writeCount = 0;
+		m_data->readerSleeping = m_data->writerSleeping = 0;
+#ifdef USE_QT_SEMAPHORES
 		static int k = 0;
 		m_data->dataSem.semKey = ( getpid()<<10 ) + ++k;
-		m_data->messageSem.semKey = ( getpid()<<10 ) + ++k;
+		m_data->spaceSem.semKey = ( getpid()<<10 ) + ++k;
 		m_dataSem.setKey( QString::number( m_data->dataSem.semKey ),
-						1, QSystemSemaphore::Create );
-		m_messageSem.setKey( QString::number(
-						m_data->messageSem.semKey ),
 						0, QSystemSemaphore::Create );
+		m_spaceSem.setKey( QString::number( m_data->spaceSem.semKey ),
+						0, QSystemSemaphore::Create );
+#endif
 	}
 
 	// constructor for remote-/client-side - use _shm_key for making up
@@ -180,10 +211,15 @@ public:
 		m_shmID( shmget( _shm_key, 0, 0 ) ),
 #endif
 		m_data( NULL ),
+#ifdef USE_QT_SEMAPHORES
 		m_dataSem( QString::null ),
-		m_messageSem( QString::null ),
-		m_lockDepth( 0 )
+		m_spaceSem( QString::null ),
+#endif
+		m_lock()
 	{
+#ifdef BUILD_REMOTE_PLUGIN_CLIENT
+		pthread_mutex_init( &m_lock, NULL );
+#endif
 #ifdef USE_QT_SHMEM
 		if( m_shmObj.attach() )
 		{
@@ -196,9 +232,10 @@ public:
 		}
 #endif
 		assert( m_data != NULL );
+#ifdef USE_QT_SEMAPHORES
 		m_dataSem.setKey( QString::number( m_data->dataSem.semKey ) );
-		m_messageSem.setKey( QString::number(
-						m_data->messageSem.semKey ) );
+		m_spaceSem.setKey( QString::number( m_data->spaceSem.semKey ) );
+#endif
 	}
 
 	~shmFifo()
@@ -212,6 +249,9 @@ public:
 		}
 #ifndef USE_QT_SHMEM
 		shmdt( m_data );
+#endif
+#ifdef BUILD_REMOTE_PLUGIN_CLIENT
+		pthread_mutex_destroy( &m_lock );
 #endif
 	}
 
@@ -220,9 +260,17 @@ public:
 		return m_invalid;
 	}
 
+	// invalidate and wake up whoever is waiting on this FIFO
 	void invalidate()
 	{
 		m_invalid = true;
+#ifdef USE_FUTEX
+		futexWake( &m_data->writeCount );
+		futexWake( &m_data->readCount );
+#else
+		m_dataSem.release();
+		m_spaceSem.release();
+#endif
 	}
 
 	// do we act as master (i.e. not as remote-process?)
@@ -231,96 +279,130 @@ public:
 		return m_master;
 	}
 
-	// recursive lock
+	// serializes the threads of this process accessing our end of the
+	// FIFO, the other process only ever touches the other end - the lock
+	// may be held across blocking waits, so it has to be a real mutex
 	inline void lock()
 	{
-		if( !isInvalid() && __sync_add_and_fetch( &m_lockDepth, 1 ) == 1 )
-		{
-			m_dataSem.acquire();
-		}
+#ifdef BUILD_REMOTE_PLUGIN_CLIENT
+		pthread_mutex_lock( &m_lock );
+#else
+		m_lock.lock();
+#endif
 	}
 
-	// recursive unlock
 	inline void unlock()
 	{
-		if( __sync_sub_and_fetch( &m_lockDepth, 1) <= 0 )
-		{
-			m_dataSem.release();
-		}
+#ifdef BUILD_REMOTE_PLUGIN_CLIENT
+		pthread_mutex_unlock( &m_lock );
+#else
+		m_lock.unlock();
+#endif
 	}
 
-	// wait until message-semaphore is available
+	// wait until there's something to read
 	inline void waitForMessage()
 	{
-		if( !isInvalid() )
-		{
-			m_messageSem.acquire();
-		}
+		waitForData( 1 );
+	}
+
+
+	inline void readData( void * _buf, int _len )
+	{
+		read( _buf, _len );
 	}
 
-	// increase message-semaphore
-	inline void messageSent()
+	inline void writeData( const void * _buf, int _len )
 	{
-		m_messageSem.release();
+		write( _buf, _len );
 	}
 
 
-	inline int32_t readInt()
+	inline bool messagesLeft()
 	{
-		int32_t i;
-		read( &i, sizeof( i ) );
-		return i;
+		return !isInvalid() && readable() > 0;
 	}
 
-	inline void writeInt( const int32_t & _i )
+
+	inline int shmKey() const
 	{
-		write( &_i, sizeof( _i ) );
+		return m_shmKey;
 	}
 
-	inline std::string readString()
+
+private:
+	inline uint32_t readable() const
 	{
-		const int len = readInt();
-		if( len )
-		{
-			char * sc = new char[len + 1];
-			read( sc, len );
-			sc[len] = 0;
-			std::string s( sc );
-			delete[] sc;
-			return s;
-		}
-		return std::string();
+		return m_data->writeCount - m_data->readCount;
 	}
 
+	inline uint32_t writable() const
+	{
+		return SHM_FIFO_SIZE - readable();
+	}
 
-	inline void writeString( const std::string & _s )
+#ifdef USE_FUTEX
+	// the futexes are not private as they are shared between processes
+	static inline void futexWait( volatile uint32_t * _word,
+							uint32_t _expected )
 	{
-		const int len = _s.size();
-		writeInt( len );
-		write( _s.c_str(), len );
+		syscall( SYS_futex, _word, FUTEX_WAIT, _expected,
+							NULL, NULL, 0 );
 	}
 
+	static inline void futexWake( volatile uint32_t * _word )
+	{
+		syscall( SYS_futex, _word, FUTEX_WAKE, INT_MAX,
+							NULL, NULL, 0 );
+	}
+#endif
 
-	inline bool messagesLeft()
+	void waitForData( uint32_t _len )
 	{
-		if( isInvalid() )
+		for( int i = 0; isInvalid() == false && readable() < _len; ++i )
 		{
-			return false;
+			if( i < SHM_FIFO_SPIN_COUNT )
+			{
+				continue;
+			}
+			const uint32_t writeCount = m_data->writeCount;
+			m_data->readerSleeping = 1;
+			__sync_synchronize();
+			if( isInvalid() == false && readable() < _len )
+			{
+#ifdef USE_FUTEX
+				futexWait( &m_data->writeCount, writeCount );
+#else
+				m_dataSem.acquire();
+#endif
+			}
+			m_data->readerSleeping = 0;
 		}
-		lock();
-		const bool empty = ( m_data->startPtr == m_data->endPtr );
-		unlock();
-		return !empty;
 	}
 
-
-	inline int shmKey() const
+	void waitForSpace( uint32_t _len )
 	{
-		return m_shmKey;
+		for( int i = 0; isInvalid() == false && writable() < _len; ++i )
+		{
+			if( i < SHM_FIFO_SPIN_COUNT )
+			{
+				continue;
+			}
+			const uint32_t readCount = m_data->readCount;
+			m_data->writerSleeping = 1;
+			__sync_synchronize();
+			if( isInvalid() == false && writable() < _len )
+			{
+#ifdef USE_FUTEX
+				futexWait( &m_data->readCount, readCount );
+#else
+				m_spaceSem.acquire();
+#endif
+			}
+			m_data->writerSleeping = 0;
+		}
 	}
 
-
-private:
 	static inline void fastMemCpy( void * _dest, const void * _src,
 							const int _len )
 	{
@@ -337,60 +419,76 @@ private:
 
 	void read( void * _buf, int _len )
 	{
-		if( isInvalid() )
-		{
-			memset( _buf, 0, _len );
-			return;
-		}
-		lock();
-		while( isInvalid() == false &&
-				_len > m_data->endPtr - m_data->startPtr )
+		char * buf = (char *) _buf;
+		while( _len > 0 )
 		{
-			unlock();
-#ifndef LMMS_BUILD_WIN32
-			usleep( 5 );
+			waitForData( 1 );
+			if( isInvalid() )
+			{
+				memset( buf, 0, _len );
+				return;
+			}
+			// make sure we see the data belonging to writeCount
+			__sync_synchronize();
+			const uint32_t len = std::min<uint32_t>( _len, readable() );
+			const uint32_t pos = m_data->readCount % SHM_FIFO_SIZE;
+			const uint32_t first = std::min<uint32_t>( len,
+							SHM_FIFO_SIZE - pos );
+			fastMemCpy( buf, m_data->data + pos, first );
+			if( first < len )
+			{
+				memcpy( buf + first, m_data->data, len - first );
+			}
+			__sync_synchronize();
+			m_data->readCount += len;
+			__sync_synchronize();
+			if( m_data->writerSleeping )
+			{
+#ifdef USE_FUTEX
+				futexWake( &m_data->readCount );
+#else
+				m_spaceSem.release();
 #endif
-			lock();
-		}
-		fastMemCpy( _buf, m_data->data + m_data->startPtr, _len );
-		m_data->startPtr += _len;
-		// nothing left?
-		if( m_data->startPtr == m_data->endPtr )
-		{
-			// then reset to 0
-			m_data->startPtr = m_data->endPtr = 0;
+			}
+			buf += len;
+			_len -= len;
 		}
-		unlock();
 	}
 
 	void write( const void * _buf, int _len )
 	{
-		if( isInvalid() || _len > SHM_FIFO_SIZE )
-		{
-			return;
-		}
-		lock();
-		while( _len > SHM_FIFO_SIZE - m_data->endPtr )
+		const char * buf = (const char *) _buf;
+		while( _len > 0 && isInvalid() == false )
 		{
-			// if no space is left, try to move data to front
-			if( m_data->startPtr > 0 )
+			waitForSpace( 1 );
+			if( isInvalid() )
 			{
-				memmove( m_data->data,
-					m_data->data + m_data->startPtr,
-					m_data->endPtr - m_data->startPtr );
-				m_data->endPtr = m_data->endPtr -
-							m_data->startPtr;
-				m_data->startPtr = 0;
+				return;
 			}
-			unlock();
-#ifndef LMMS_BUILD_WIN32
-			usleep( 5 );
+			const uint32_t len = std::min<uint32_t>( _len, writable() );
+			const uint32_t pos = m_data->writeCount % SHM_FIFO_SIZE;
+			const uint32_t first = std::min<uint32_t>( len,
+							SHM_FIFO_SIZE - pos );
+			fastMemCpy( m_data->data + pos, buf, first );
+			if( first < len )
+			{
+				memcpy( m_data->data, buf + first, len - first );
+			}
+			// publish the data before the new count
+			__sync_synchronize();
+			m_data->writeCount += len;
+			__sync_synchronize();
+			if( m_data->readerSleeping )
+			{
+#ifdef USE_FUTEX
+				futexWake( &m_data->writeCount );
+#else
+				m_dataSem.release();
 #endif
-			lock();
+			}
+			buf += len;
+			_len -= len;
 		}
-		fastMemCpy( m_data->data + m_data->endPtr, _buf, _len );
-		m_data->endPtr += _len;
-		unlock();
 	}
 
 	volatile bool m_invalid;
@@ -402,9 +500,15 @@ private:
 	int m_shmID;
 #endif
 	shmData * m_data;
+#ifdef USE_QT_SEMAPHORES
 	QSystemSemaphore m_dataSem;
-	QSystemSemaphore m_messageSem;
-	volatile int m_lockDepth;
+	QSystemSemaphore m_spaceSem;
+#endif
+#ifdef BUILD_REMOTE_PLUGIN_CLIENT
+	pthread_mutex_t m_lock;
+#else
+	QMutex m_lock;
+#endif
 
 } ;
 #endif
@@ -438,59 +542,107 @@ enum RemoteMessageIDs
 	IdSavePresetFile,
 	IdLoadPresetFile,
 	IdDebugMessage,
+	IdProtocolVersion,
+	IdAddInstance,
+	IdChangeBufferSize,
+	IdProcessInstances,
 	IdUserBase = 64
 } ;
 
 
+// version 1 transfers all message arguments as strings, version 2 adds
+// binary encoded messages - the client announces its version, so both
+// sides stick to strings when talking to an older peer
+const int32_t RemoteProtocolVersion = 2;
+const int32_t RemoteProtocolTextMessages = 1;
+const int32_t RemoteProtocolBinaryMessages = 2;
+
+// set in the ID of binary encoded messages
+const int32_t BinaryMessageFlag = 1 << 30;
+
+
 
 class EXPORT RemotePluginBase
 {
 public:
+	// arguments are stored as a sequence of type/value records which
+	// can be sent as they are - small messages get along without any
+	// heap allocation
 	struct message
 	{
 		message() :
 			id( IdUndefined ),
-			data()
+			m_data( m_inline ),
+			m_size( 0 ),
+			m_capacity( InlineSize ),
+			m_count( 0 )
 		{
 		}
 
 		message( const message & _m ) :
 			id( _m.id ),
-			data( _m.data )
+			m_data( m_inline ),
+			m_size( 0 ),
+			m_capacity( InlineSize ),
+			m_count( 0 )
 		{
+			assign( _m );
 		}
 
 		message( int _id ) :
 			id( _id ),
-			data()
+			m_data( m_inline ),
+			m_size( 0 ),
+			m_capacity( InlineSize ),
+			m_count( 0 )
 		{
 		}
 
+		~message()
+		{
+			if( m_data != m_inline )
+			{
+				delete[] m_data;
+			}
+		}
+
+		message & operator=( const message & _m )
+		{
+			if( this != &_m )
+			{
+				id = _m.id;
+				assign( _m );
+			}
+			return *this;
+		}
+
 		inline message & addString( const std::string & _s )
 		{
-			data.push_back( _s );
+			memcpy( appendArg( ArgString, _s.size() ), _s.data(),
+								_s.size() );
 			return *this;
 		}
 
 		message & addInt( int _i )
 		{
-			char buf[32];
-			sprintf( buf, "%d", _i );
-			data.push_back( std::string( buf ) );
+			int32_t i = _i;
+			memcpy( appendArg( ArgInt, sizeof( i ) ), &i, sizeof( i ) );
 			return *this;
 		}
 
 		message & addFloat( float _f )
 		{
-			char buf[32];
-			sprintf( buf, "%f", _f );
-			data.push_back( std::string( buf ) );
+			memcpy( appendArg( ArgFloat, sizeof( _f ) ), &_f,
+							sizeof( _f ) );
 			return *this;
 		}
 
-		inline std::string getString( int _p = 0 ) const
+		std::string getString( int _p = 0 ) const
 		{
-			return data[_p];
+			char buf[TextBufferSize];
+			int32_t len;
+			const char * s = argText( arg( _p ), buf, &len );
+			return s ? std::string( s, len ) : std::string();
 		}
 
 #ifndef BUILD_REMOTE_PLUGIN_CLIENT
@@ -500,14 +652,65 @@ public:
 		}
 #endif
 
-		inline int getInt( int _p = 0 ) const
+		int getInt( int _p = 0 ) const
 		{
-			return atoi( data[_p].c_str() );
+			const char * a = arg( _p );
+			if( a == NULL )
+			{
+				return 0;
+			}
+			switch( *a )
+			{
+				case ArgInt:
+				{
+					int32_t i;
+					memcpy( &i, a + 1, sizeof( i ) );
+					return i;
+				}
+				case ArgFloat:
+				{
+					float f;
+					memcpy( &f, a + 1, sizeof( f ) );
+					return (int) f;
+				}
+				default:
+				{
+					// arguments of text encoded messages
+					char buf[TextBufferSize];
+					return atoi( stringArg( a, buf,
+							sizeof( buf ) ) );
+				}
+			}
 		}
 
-		inline float getFloat( int _p ) const
+		float getFloat( int _p ) const
 		{
-			return (float) atof( data[_p].c_str() );
+			const char * a = arg( _p );
+			if( a == NULL )
+			{
+				return 0;
+			}
+			switch( *a )
+			{
+				case ArgFloat:
+				{
+					float f;
+					memcpy( &f, a + 1, sizeof( f ) );
+					return f;
+				}
+				case ArgInt:
+				{
+					int32_t i;
+					memcpy( &i, a + 1, sizeof( i ) );
+					return (float) i;
+				}
+				default:
+				{
+					char buf[TextBufferSize];
+					return (float) atof( stringArg( a, buf,
+							sizeof( buf ) ) );
+				}
+			}
 		}
 
 		inline bool operator==( const message & _m ) const
@@ -518,7 +721,163 @@ public:
 		int id;
 
 	private:
-		std::vector<std::string> data;
+		enum ArgTypes
+		{
+			ArgInt,
+			ArgFloat,
+			ArgString
+		} ;
+
+		static const uint32_t InlineSize = 64;
+		// enough for printing any float with "%f"
+		static const int TextBufferSize = 64;
+
+		void assign( const message & _m )
+		{
+			m_size = 0;
+			memcpy( grow( _m.m_size ), _m.m_data, _m.m_size );
+			m_count = _m.m_count;
+		}
+
+		// makes room for _len more bytes and returns where they go
+		char * grow( uint32_t _len )
+		{
+			if( m_size + _len > m_capacity )
+			{
+				m_capacity = std::max( m_capacity * 2,
+							m_size + _len );
+				char * data = new char[m_capacity];
+				memcpy( data, m_data, m_size );
+				if( m_data != m_inline )
+				{
+					delete[] m_data;
+				}
+				m_data = data;
+			}
+			char * p = m_data + m_size;
+			m_size += _len;
+			return p;
+		}
+
+		char * appendArg( ArgTypes _type, uint32_t _len )
+		{
+			char * p = grow( 1 + ( _type == ArgString ? 4 : 0 ) +
+									_len );
+			*p++ = _type;
+			if( _type == ArgString )
+			{
+				const int32_t len = _len;
+				memcpy( p, &len, sizeof( len ) );
+				p += sizeof( len );
+			}
+			++m_count;
+			return p;
+		}
+
+		// returns the size of the record at _pos or 0 if it's corrupt
+		uint32_t argSize( uint32_t _pos ) const
+		{
+			if( _pos >= m_size )
+			{
+				return 0;
+			}
+			uint32_t size = 1;
+			switch( m_data[_pos] )
+			{
+				case ArgInt:
+				case ArgFloat:
+					size += 4;
+					break;
+				case ArgString:
+				{
+					int32_t len;
+					if( _pos + 5 > m_size )
+					{
+						return 0;
+					}
+					memcpy( &len, m_data + _pos + 1, 4 );
+					if( len < 0 )
+					{
+						return 0;
+					}
+					size += 4 + len;
+					break;
+				}
+				default:
+					return 0;
+			}
+			return _pos + size <= m_size ? size : 0;
+		}
+
+		const char * arg( int _p ) const
+		{
+			uint32_t pos = 0;
+			for( int i = 0; i < m_count; ++i )
+			{
+				const uint32_t size = argSize( pos );
+				if( size == 0 )
+				{
+					break;
+				}
+				if( i == _p )
+				{
+					return m_data + pos;
+				}
+				pos += size;
+			}
+			return NULL;
+		}
+
+		// returns the argument at _a the way the text encoding
+		// transfers it, numbers are printed into _buf which has to
+		// hold TextBufferSize bytes
+		static const char * argText( const char * _a, char * _buf,
+								int32_t * _len )
+		{
+			if( _a == NULL )
+			{
+				return NULL;
+			}
+			switch( *_a )
+			{
+				case ArgInt:
+				{
+					int32_t i;
+					memcpy( &i, _a + 1, sizeof( i ) );
+					*_len = sprintf( _buf, "%d", i );
+					return _buf;
+				}
+				case ArgFloat:
+				{
+					float f;
+					memcpy( &f, _a + 1, sizeof( f ) );
+					*_len = sprintf( _buf, "%f", f );
+					return _buf;
+				}
+				default:
+					memcpy( _len, _a + 1, sizeof( *_len ) );
+					return _a + 5;
+			}
+		}
+
+		// returns a zero terminated copy of string argument _a
+		// for parsing numbers from it
+		static const char * stringArg( const char * _a, char * _buf,
+								int _size )
+		{
+			int32_t len;
+			memcpy( &len, _a + 1, sizeof( len ) );
+			len = std::min( len, _size - 1 );
+			memcpy( _buf, _a + 5, len );
+			_buf[len] = 0;
+			return _buf;
+		}
+
+		char * m_data;
+		uint32_t m_size;
+		uint32_t m_capacity;
+		int32_t m_count;
+		char m_inline[InlineSize];
 
 		friend class RemotePluginBase;
 
@@ -563,43 +922,6 @@ public:
 		return m;
 	}
 
-#ifndef SYNC_WITH_SHM_FIFO
-	inline int32_t readInt()
-	{
-		int32_t i;
-		read( &i, sizeof( i ) );
-		return i;
-	}
-
-	inline void writeInt( const int32_t & _i )
-	{
-		write( &_i, sizeof( _i ) );
-	}
-
-	inline std::string readString()
-	{
-		const int len = readInt();
-		if( len )
-		{
-			char * sc = new char[len + 1];
-			read( sc, len );
-			sc[len] = 0;
-			std::string s( sc );
-			delete[] sc;
-			return s;
-		}
-		return std::string();
-	}
-
-
-	inline void writeString( const std::string & _s )
-	{
-		const int len = _s.size();
-		writeInt( len );
-		write( _s.c_str(), len );
-	}
-#endif
-
 #ifndef BUILD_REMOTE_PLUGIN_CLIENT
 	inline bool messagesLeft()
 	{
@@ -653,12 +975,18 @@ protected:
 #ifdef SYNC_WITH_SHM_FIFO
 		m_in->invalidate();
 		m_out->invalidate();
-		m_in->messageSent();
 #else
 		m_invalid = true;
 #endif
 	}
 
+	// messages to the peer are binary encoded if it announced a
+	// protocol version supporting them
+	inline void setPeerProtocolVersion( int _version )
+	{
+		m_binaryMessages = _version >= RemoteProtocolBinaryMessages;
+	}
+
 
 #ifndef SYNC_WITH_SHM_FIFO
 	int m_socket;
@@ -674,6 +1002,26 @@ private:
 	}
 #endif
 
+	inline void readData( void * _buf, int _len )
+	{
+#ifdef SYNC_WITH_SHM_FIFO
+		m_in->readData( _buf, _len );
+#else
+		read( _buf, _len );
+#endif
+	}
+
+	inline void writeData( const void * _buf, int _len )
+	{
+#ifdef SYNC_WITH_SHM_FIFO
+		m_out->writeData( _buf, _len );
+#else
+		write( _buf, _len );
+#endif
+	}
+
+	volatile bool m_binaryMessages;
+
 #ifdef SYNC_WITH_SHM_FIFO
 	shmFifo * m_in;
 	shmFifo * m_out;
@@ -745,6 +1093,7 @@ private:
 
 
 class RemotePlugin;
+class RemotePluginHost;
 
 class ProcessWatcher : public QThread
 {
@@ -782,14 +1131,7 @@ public:
 	RemotePlugin();
 	virtual ~RemotePlugin();
 
-	inline bool isRunning()
-	{
-#ifdef DEBUG_REMOTE_PLUGIN
-		return true;
-#else
-		return m_process.state() != QProcess::NotRunning;
-#endif
-	}
+	bool isRunning();
 
 	bool init( const QString &pluginExecutable, bool waitForInitDoneMsg, QStringList extraArgs = {} );
 
@@ -808,6 +1150,19 @@ public:
 
 	bool process( const sampleFrame * _in_buf, sampleFrame * _out_buf );
 
+	// in pipelined mode process() hands the current period over to the
+	// plugin and returns what it rendered during the previous one, so the
+	// calling thread doesn't have to wait for the plugin
+	inline bool isPipelined() const
+	{
+		return m_pipelined;
+	}
+
+	void setPipelined( bool _on );
+
+	// number of frames the output lags behind the input
+	f_cnt_t latency() const;
+
 	void processMidiEvent( const MidiEvent&, const f_cnt_t _offset );
 
 	void updateSampleRate( sample_rate_t _sr )
@@ -860,9 +1215,36 @@ protected:
 		m_splitChannels = _on;
 	}
 
+	// has to be called before init() - lets the plugin run inside a
+	// process shared with other instances, the executable has to
+	// support this (see IdAddInstance)
+	inline void setSharedProcess( bool _on )
+	{
+		m_sharedProcess = _on;
+	}
+
+
+protected slots:
+	virtual void processFinished( int exitCode,
+					QProcess::ExitStatus exitStatus );
+
 
 private:
+	void setChannelCounts( int _inputs, int _outputs );
+	void applyPendingChannelCounts();
 	void resizeSharedProcessingMemory();
+	void collectOutput( sampleFrame * _out_buf, const fpp_t frames );
+
+	// waits for the period handed over last time
+	void finishProcessing();
+	void sendQueuedMidiEvents();
+
+	// pipelined instances of a shared process leave starting their
+	// periods to the host, which batches them
+	inline bool isBatched() const
+	{
+		return m_pipelined && m_host != NULL;
+	}
 
 
 	bool m_failed;
@@ -886,16 +1268,104 @@ private:
 	int m_inputCount;
 	int m_outputCount;
 
+	bool m_pipelined;
+	// IdStartProcessing has been sent but IdProcessingDone not received
+	bool m_processing;
+	// the period being processed went to the host's batch instead
+	bool m_batched;
+	// the shared memory holds output not handed out yet
+	bool m_pendingOutput;
+	// channel counts the client changed to while processing, applied
+	// once process() got IdProcessingDone
+	bool m_channelCountsPending;
+	int m_pendingInputCount;
+	int m_pendingOutputCount;
+
+	bool m_sharedProcess;
+	// the process we're running in if it's shared
+	RemotePluginHost * m_host;
+	// identifies us in the batches of the host
+	int m_hostInstanceId;
+	// MIDI events going along with the next batched period, five values
+	// per event as in IdMidiEvent
+	QVector<int> m_queuedMidiEvents;
+
 #ifndef SYNC_WITH_SHM_FIFO
 	int m_server;
 	QString m_socketFile;
 #endif
 
 	friend class ProcessWatcher;
+	friend class RemotePluginHost;
 
 
 private slots:
-	void processFinished( int exitCode, QProcess::ExitStatus exitStatus );
+	void updateBufferSize();
+	void handleConfigChange( QString _cls, QString _attribute,
+							QString _value );
+} ;
+
+
+
+// a remote process running several plugin instances - each one talks to
+// its RemotePlugin through its own channel, but in pipelined mode the
+// periods of all instances are started with a single IdProcessInstances
+// message per period, which the host renders on a pool of worker threads
+// before it answers with a single IdProcessingDone
+class RemotePluginHost : public RemotePlugin
+{
+	Q_OBJECT
+public:
+	// returns a host running _exec with room for another instance or
+	// NULL if none could be started
+	static RemotePluginHost * acquire( const QString & _exec,
+						RemotePlugin * _plugin );
+	static void release( RemotePluginHost * _host,
+						RemotePlugin * _plugin );
+
+	// sends the periods the instances of every host queued - called by
+	// the mixer once all of the current period has been processed
+	static void startProcessing();
+
+	// starts an instance connecting to the channel given by _args
+	void addInstance( RemotePlugin * _plugin, const QStringList & _args );
+
+	// adds the period in the shared memory of _plugin and the MIDI events
+	// preceding it to the next batch
+	void queueProcessing( RemotePlugin * _plugin,
+					const QVector<int> & _midiEvents );
+	// returns once the period _plugin handed over has been rendered
+	void finishProcessing( RemotePlugin * _plugin );
+
+
+protected slots:
+	virtual void processFinished( int exitCode,
+					QProcess::ExitStatus exitStatus );
+
+
+private:
+	// limits how many instances a crash takes down
+	static const int MaxInstances = 8;
+
+	RemotePluginHost( const QString & _exec );
+	virtual ~RemotePluginHost();
+
+	void sendBatch();
+	void waitForBatch();
+
+	QString m_executable;
+	QList<RemotePlugin *> m_plugins;
+
+	// the instances in the batch to be sent, the batch holds the ID, the
+	// number of MIDI events and the events of each of them
+	QList<RemotePlugin *> m_queued;
+	QVector<int> m_batch;
+	bool m_batchInFlight;
+	int m_nextInstanceId;
+
+	static QList<RemotePluginHost *> s_hosts;
+	static QMutex s_hostsMutex;
+
 } ;
 
 #endif
@@ -984,9 +1454,13 @@ public:
 	}
 
 
+protected:
+	// renders a period from the shared memory into it
+	void doProcessing();
+
+
 private:
 	void setShmKey( key_t _key, int _size );
-	void doProcessing();
 
 #ifdef USE_QT_SHMEM
 	QSharedMemory m_shmObj;
@@ -1018,11 +1492,13 @@ private:
 
 #ifdef SYNC_WITH_SHM_FIFO
 RemotePluginBase::RemotePluginBase( shmFifo * _in, shmFifo * _out ) :
+	m_binaryMessages( false ),
 	m_in( _in ),
 	m_out( _out )
 #else
 RemotePluginBase::RemotePluginBase() :
 	m_socket( -1 ),
+	m_binaryMessages( false ),
 	m_invalid( false )
 #endif
 {
@@ -1058,26 +1534,40 @@ int RemotePluginBase::sendMessage( const message & _m )
 {
 #ifdef SYNC_WITH_SHM_FIFO
 	m_out->lock();
-	m_out->writeInt( _m.id );
-	m_out->writeInt( _m.data.size() );
-	int j = 8;
-	for( unsigned int i = 0; i < _m.data.size(); ++i )
-	{
-		m_out->writeString( _m.data[i] );
-		j += 4 + _m.data[i].size();
-	}
-	m_out->unlock();
-	m_out->messageSent();
 #else
 	pthread_mutex_lock( &m_sendMutex );
-	writeInt( _m.id );
-	writeInt( _m.data.size() );
-	int j = 8;
-	for( unsigned int i = 0; i < _m.data.size(); ++i )
+#endif
+	int j;
+	if( m_binaryMessages )
+	{
+		// the records are sent as they are
+		const int32_t header[3] = { _m.id | BinaryMessageFlag,
+						_m.m_count,
+						(int32_t) _m.m_size };
+		writeData( header, sizeof( header ) );
+		writeData( _m.m_data, _m.m_size );
+		j = sizeof( header ) + _m.m_size;
+	}
+	else
 	{
-		writeString( _m.data[i] );
-		j += 4 + _m.data[i].size();
+		const int32_t header[2] = { _m.id, _m.m_count };
+		writeData( header, sizeof( header ) );
+		j = sizeof( header );
+		char buf[message::TextBufferSize];
+		int32_t len;
+		for( uint32_t pos = 0, size;
+				( size = _m.argSize( pos ) ) > 0; pos += size )
+		{
+			const char * s = message::argText( _m.m_data + pos,
+								buf, &len );
+			writeData( &len, sizeof( len ) );
+			writeData( s, len );
+			j += sizeof( len ) + len;
+		}
 	}
+#ifdef SYNC_WITH_SHM_FIFO
+	m_out->unlock();
+#else
 	pthread_mutex_unlock( &m_sendMutex );
 #endif
 
@@ -1092,23 +1582,45 @@ RemotePluginBase::message RemotePluginBase::receiveMessage()
 #ifdef SYNC_WITH_SHM_FIFO
 	m_in->waitForMessage();
 	m_in->lock();
-	message m;
-	m.id = m_in->readInt();
-	const int s = m_in->readInt();
-	for( int i = 0; i < s; ++i )
-	{
-		m.data.push_back( m_in->readString() );
-	}
-	m_in->unlock();
 #else
 	pthread_mutex_lock( &m_receiveMutex );
+#endif
 	message m;
-	m.id = readInt();
-	const int s = readInt();
-	for( int i = 0; i < s; ++i )
+	int32_t header[2];
+	readData( header, sizeof( header ) );
+	if( header[0] & BinaryMessageFlag )
+	{
+		int32_t size;
+		readData( &size, sizeof( size ) );
+		if( size >= 0 )
+		{
+			m.id = header[0] & ~BinaryMessageFlag;
+			readData( m.grow( size ), size );
+			m.m_count = header[1];
+		}
+		else
+		{
+			fprintf( stderr, "RemotePluginBase: received "
+						"corrupt message\n" );
+			invalidate();
+		}
+	}
+	else
 	{
-		m.data.push_back( readString() );
+		// every argument of a text encoded message is a string
+		m.id = header[0];
+		for( int i = 0; i < header[1] && !isInvalid(); ++i )
+		{
+			int32_t len;
+			readData( &len, sizeof( len ) );
+			readData( m.appendArg( message::ArgString,
+						std::max( len, 0 ) ),
+							std::max( len, 0 ) );
+		}
 	}
+#ifdef SYNC_WITH_SHM_FIFO
+	m_in->unlock();
+#else
 	pthread_mutex_unlock( &m_receiveMutex );
 #endif
 	return m;
@@ -1226,6 +1738,10 @@ RemotePluginClient::RemotePluginClient( const char * socketPath ) :
 	}
 #endif
 
+	// LMMS replies with its own version if it supports binary messages
+	sendMessage( message( IdProtocolVersion ).addInt(
+						RemoteProtocolVersion ) );
+
 #ifdef USE_QT_SHMEM
 	if( m_shmQtID.attach( QSharedMemory::ReadOnly ) )
 	{
@@ -1334,16 +1850,27 @@ bool RemotePluginClient::processMessage( const message & _m )
 			break;
 
 		case IdBufferSizeInformation:
-			// Should LMMS gain the ability to change buffer size
-			// without a restart, it must wait for this message to
-			// complete processing or else risk VST crashes
 			m_bufferSize = _m.getInt();
 			updateBufferSize();
 			break;
 
+		case IdChangeBufferSize:
+			// LMMS waits for this message to complete processing
+			// before it resizes the shared memory and continues
+			// rendering
+			m_bufferSize = _m.getInt();
+			updateBufferSize();
+			reply_message.id = IdInformationUpdated;
+			reply = true;
+			break;
+
 		case IdQuit:
 			return false;
 
+		case IdProtocolVersion:
+			setPeerProtocolVersion( _m.getInt() );
+			break;
+
 		case IdMidiEvent:
 			processMidiEvent(
 				MidiEvent( static_cast<MidiEventTypes>(
@@ -0,0 +1,122 @@
+/*
+ * RenderCache.h - reuses rendered tracks and FX channels across exports
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef RENDER_CACHE_H
+#define RENDER_CACHE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QHash>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "lmms_basics.h"
+
+class FreezeCache;
+class InstrumentTrack;
+class Track;
+
+
+//! Keeps the rendered output of song instrument tracks and FX channels on
+//! disk, keyed by a hash over their settings, everything feeding into them
+//! and the export settings. On the next export, unchanged FX channels are
+//! played from the cache instead of being processed, and tracks which only
+//! feed cached channels aren't rendered at all. Unchanged tracks feeding a
+//! channel which has to be rendered are played back like frozen tracks.
+//!
+//! Used by ProjectRenderer, which calls prepare() once the export quality
+//! has been set up and finish() after rendering, both with the mixer
+//! stopped.
+class RenderCache
+{
+public:
+	RenderCache();
+	~RenderCache();
+
+	static bool isEnabled();
+
+	//! Directory to keep the cache in, an empty string disables the cache.
+	//! Defaults to the "rendercache"/"dir" configuration value.
+	static void setDirectory( const QString & _dir );
+
+	//! Least recently used entries are removed once the cache grows larger
+	//! than _bytes
+	static void setSizeLimit( qint64 _bytes );
+
+	void prepare();
+	void finish( bool _completed );
+
+
+private:
+	struct TrackEntry
+	{
+		InstrumentTrack * track;
+		QByteArray key;
+		FreezeCache * cache;
+		bool hit;
+	} ;
+
+	struct ChannelEntry
+	{
+		QByteArray key;
+		FreezeCache * cache;
+		bool hit;
+		bool needed;
+		bool neededValid;
+	} ;
+
+	static QString directory();
+	static qint64 sizeLimit();
+
+	QString fileName( const QByteArray & _key ) const;
+
+	QByteArray globalKey() const;
+	QByteArray trackKey( Track * _track ) const;
+	QByteArray channelKey( int _ch );
+	bool isChannelNeeded( int _ch );
+	bool isChannelRendered( int _ch );
+
+	FreezeCache * loadEntry( const QByteArray & _key,
+					const QByteArray & _stateHash );
+	FreezeCache * createEntry( const QByteArray & _key );
+	void commitEntry( const QByteArray & _key, FreezeCache * _cache,
+							bool _completed );
+	void enforceSizeLimit();
+
+	static QString s_directory;
+	static bool s_directorySet;
+	static qint64 s_sizeLimit;
+
+	bool m_active;
+	tick_t m_endTick;
+	f_cnt_t m_frames;
+	f_cnt_t m_requiredFrames;
+	QByteArray m_globalKey;
+
+	QVector<TrackEntry> m_tracks;
+	QVector<ChannelEntry> m_channels;
+	QHash<int, QVector<QByteArray> > m_channelInputs;
+	QVector<Track *> m_mutedTracks;
+
+} ;
+
+
+#endif
@@ -200,6 +200,7 @@ public:
 
 protected slots:
 	void updateSamplerate();
+	void updateFramesPerPeriod();
 
 private:
 	inline f_cnt_t msToFrames( float ms )
@@ -207,7 +208,7 @@ private:
 		return static_cast<f_cnt_t>( ceilf( ms * (float)m_samplerate * 0.001f ) );
 	}
 
-	const fpp_t m_fpp;
+	fpp_t m_fpp;
 	sample_rate_t m_samplerate;
 	size_t m_size;
 	sampleFrame * m_buffer;
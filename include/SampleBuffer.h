@@ -26,6 +26,7 @@
 #ifndef SAMPLE_BUFFER_H
 #define SAMPLE_BUFFER_H
 
+#include <QtCore/QAtomicPointer>
 #include <QtCore/QReadWriteLock>
 #include <QtCore/QObject>
 
@@ -37,8 +38,12 @@
 #include "lmms_math.h"
 #include "shared_object.h"
 #include "MemoryManager.h"
+#include "SampleData.h"
+#include "SampleInterpolator.h"
 
 
+class QDomDocument;
+class QDomElement;
 class QPainter;
 class QRect;
 
@@ -92,11 +97,23 @@ public:
 
 
 	private:
+		// returns a buffer for at least _frames frames, which is only
+		// reallocated when a longer fragment than ever before is needed
+		sampleFrame * fragmentBuffer( f_cnt_t _frames );
+
 		f_cnt_t m_frameIndex;
 		const bool m_varyingPitch;
 		bool m_isBackwards;
+		// NULL if the built-in interpolator is used instead
 		SRC_STATE * m_resamplingData;
 		int m_interpolationMode;
+		SampleInterpolator::Qualities m_interpolatorQuality;
+		// fractional read position and the last input frames of the
+		// built-in interpolator
+		double m_interpolatorPosition;
+		sampleFrame m_interpolatorHistory[SampleInterpolator::MaxHistoryFrames];
+		sampleFrame * m_fragment;
+		f_cnt_t m_fragmentFrames;
 
 		friend class SampleBuffer;
 
@@ -168,7 +185,8 @@ public:
 
 	inline f_cnt_t frames() const
 	{
-		return m_frames;
+		const SampleData * d = sampleData();
+		return d ? d->frames() : 0;
 	}
 
 	inline float amplification() const
@@ -206,9 +224,40 @@ public:
 		m_sampleRate = _rate;
 	}
 
+	//! Lets update() stream files which are longer than StreamingThreshold
+	//! from disk instead of decoding them completely. data() is NULL for
+	//! streamed files, so only enable it for users playing the sample with
+	//! play() and LoopOff only.
+	void setStreamingEnabled( bool _enabled )
+	{
+		m_streamingEnabled = _enabled;
+	}
+
+	bool isStreamed() const
+	{
+		const SampleData * d = sampleData();
+		return d && d->stream();
+	}
+
+	//! Whether visualize() can't draw all of the waveform yet because the
+	//! peaks of a streamed sample are still being scanned.
+	bool isScanningPeaks() const
+	{
+		const SampleData * d = sampleData();
+		return d && d->stream() &&
+				d->stream()->peaks()->frames() < d->frames();
+	}
+
+	//! Tells a streamed sample where playback is going to jump to, does
+	//! nothing if the sample isn't streamed.
+	void cue( SampleStream::Cues _cue, f_cnt_t _frame );
+
+	// only valid until the sample is changed the next time - use
+	// dataReadLock() and dataUnlock() when calling from the GUI
 	inline const sampleFrame * data() const
 	{
-		return m_data;
+		const SampleData * d = sampleData();
+		return d ? d->data() : NULL;
 	}
 
 	QString openAudioFile() const;
@@ -217,6 +266,14 @@ public:
 
 	QString & toBase64( QString & _dst ) const;
 
+	// store the frames in the attribute _name of _this - as base64, or as
+	// a reference to a binary entry if _doc is saved as a project bundle
+	void saveSampleData( QDomDocument & _doc, QDomElement & _this,
+						const QString & _name ) const;
+	// counterpart of saveSampleData(), returns false if there are no
+	// frames stored under _name
+	bool loadSampleData( const QDomElement & _this, const QString & _name );
+
 
 	// protect calls from the GUI to this function with dataReadLock() and
 	// dataUnlock()
@@ -230,8 +287,9 @@ public:
 	// dataUnlock(), out of loops for efficiency
 	inline sample_t userWaveSample( const float _sample ) const
 	{
-		f_cnt_t frames = m_frames;
-		sampleFrame * data = m_data;
+		const SampleData * d = sampleData();
+		const f_cnt_t frames = d->frames();
+		const sampleFrame * data = d->data();
 		const float frame = _sample * frames;
 		f_cnt_t f1 = static_cast<f_cnt_t>( frame ) % frames;
 		if( f1 < 0 )
@@ -251,6 +309,17 @@ public:
 		m_varLock.unlock();
 	}
 
+	//! Decodes _file the way setAudioFile() does and returns a reference to
+	//! the result, or NULL if it can't be decoded. The result is shared
+	//! through SampleDataCache, so files can be decoded in other threads
+	//! before SampleBuffers load them. _limit_exceeded is set if the file
+	//! is too large to be decoded.
+	static SampleData * decodeFile( const QString & _file,
+					sample_rate_t _sample_rate, bool _reversed,
+					bool * _limit_exceeded = NULL );
+	//! Whether _file is streamed from disk if streaming is enabled.
+	static bool streamsFile( const QString & _file );
+
 	static QString tryToMakeRelative( const QString & _file );
 	static QString tryToMakeAbsolute(const QString & file);
 
@@ -265,31 +334,61 @@ public slots:
 	void sampleRateChanged();
 
 private:
+	// limits for files which are decoded completely
+	static const int FileSizeMax = 300; // MB
+	static const int SampleLengthMax = 90; // minutes
+	// files longer than this are streamed if streaming is enabled
+	static const int StreamingThreshold = 120; // seconds
+
 	static sample_rate_t mixerSampleRate();
 
+	inline SampleData * sampleData() const
+	{
+#if QT_VERSION >= 0x050000
+		return m_sampleData.loadAcquire();
+#else
+		return m_sampleData;
+#endif
+	}
+
 	void update( bool _keep_settings = false );
+	void setOrigData( const sampleFrame * _data, f_cnt_t _frames );
+	void setSampleData( SampleData * _data, bool _keep_settings );
+
+	static void resampleFrames( const sampleFrame * _src,
+					const f_cnt_t _src_frames,
+					sampleFrame * _dst,
+					const f_cnt_t _dst_frames,
+					const sample_rate_t _src_sr,
+					const sample_rate_t _dst_sr );
 
-	void convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames, int _channels);
-	void directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _channels);
+	static sampleFrame * convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames, int _channels, bool _reversed );
+	static sampleFrame * directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _channels, bool _reversed );
 
-	f_cnt_t decodeSampleSF( QString _f, sample_t * & _buf,
+	static f_cnt_t decodeSampleSF( QString _f, sampleFrame * & _data,
 						ch_cnt_t & _channels,
-						sample_rate_t & _sample_rate );
+						sample_rate_t & _sample_rate,
+						bool _reversed );
 #ifdef LMMS_HAVE_OGGVORBIS
-	f_cnt_t decodeSampleOGGVorbis( QString _f, int_sample_t * & _buf,
+	static f_cnt_t decodeSampleOGGVorbis( QString _f, sampleFrame * & _data,
 						ch_cnt_t & _channels,
-						sample_rate_t & _sample_rate );
+						sample_rate_t & _sample_rate,
+						bool _reversed );
 #endif
-	f_cnt_t decodeSampleDS( QString _f, int_sample_t * & _buf,
+	static f_cnt_t decodeSampleDS( QString _f, sampleFrame * & _data,
 						ch_cnt_t & _channels,
-						sample_rate_t & _sample_rate );
+						sample_rate_t & _sample_rate,
+						bool _reversed );
 
 	QString m_audioFile;
-	sampleFrame * m_origData;
-	f_cnt_t m_origFrames;
-	sampleFrame * m_data;
+	// frames the sample has been created from if there's no audio file,
+	// shared with other SampleBuffers holding the same frames
+	SampleData * m_origData;
+	// replaced as a whole by update(), readers in the mixer thread don't
+	// lock anything
+	QAtomicPointer<SampleData> m_sampleData;
 	QReadWriteLock m_varLock;
-	f_cnt_t m_frames;
+	bool m_streamingEnabled;
 	f_cnt_t m_startFrame;
 	f_cnt_t m_endFrame;
 	f_cnt_t m_loopStartFrame;
@@ -299,11 +398,19 @@ private:
 	float m_frequency;
 	sample_rate_t m_sampleRate;
 
-	sampleFrame * getSampleFragment( f_cnt_t _index, f_cnt_t _frames,
+	// returns a pointer to _frames frames starting at _index, either
+	// directly into the sample data or - if the fragment crosses the end or
+	// loop boundaries - into _dst, which must hold at least _frames frames
+	const sampleFrame * getSampleFragment( const SampleData * _sampleData,
+						f_cnt_t _index, f_cnt_t _frames,
 						LoopMode _loopmode,
-						sampleFrame * * _tmp,
+						sampleFrame * _dst,
 						bool * _backwards, f_cnt_t _loopstart, f_cnt_t _loopend,
 						f_cnt_t _end ) const;
+	// returns the play position _frames frames after _index
+	f_cnt_t advance( f_cnt_t _index, f_cnt_t _frames, LoopMode _loopmode,
+				bool _backwards, f_cnt_t _loopstart,
+					f_cnt_t _loopend ) const;
 	f_cnt_t getLoopedIndex( f_cnt_t _index, f_cnt_t _startf, f_cnt_t _endf  ) const;
 	f_cnt_t getPingPongIndex( f_cnt_t _index, f_cnt_t _startf, f_cnt_t _endf  ) const;
 
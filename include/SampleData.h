@@ -0,0 +1,150 @@
+/*
+ * SampleData.h - immutable block of decoded sample frames
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_DATA_H
+#define SAMPLE_DATA_H
+
+#include <QtCore/QFile>
+#include <QtCore/QMutex>
+
+#include "lmms_basics.h"
+#include "MemoryManager.h"
+#include "shared_object.h"
+#include "SampleDataCache.h"
+#include "SamplePeaks.h"
+#include "SampleStream.h"
+
+
+//! The frames a SampleBuffer plays from. They are never modified once
+//! created - SampleBuffer replaces the whole object instead, so the mixer
+//! can keep reading the old frames while new ones are being prepared.
+//! SampleBuffers created from the same file or frames share the same
+//! SampleData, see SampleDataCache.
+//!
+//! Long files may be streamed from disk instead, in which case data() is
+//! NULL and the frames have to be read through stream().
+//!
+//! The peaks for drawing the waveform are built when they're needed for the
+//! first time and shared by all views. Streams build them in the background
+//! instead.
+//!
+//! Frames loaded from SampleDiskCache are mapped from the cache file rather
+//! than copied into memory.
+class SampleData : public sharedObject
+{
+	MM_OPERATORS
+public:
+	//! takes ownership of _data, which has to be allocated with MM_ALLOC
+	SampleData( sampleFrame * _data, f_cnt_t _frames ) :
+		m_data( _data ),
+		m_frames( _frames ),
+		m_stream( NULL ),
+		m_file( NULL ),
+		m_peaks( NULL )
+	{
+	}
+
+	//! takes ownership of _stream
+	SampleData( SampleStream * _stream ) :
+		m_data( NULL ),
+		m_frames( _stream->frames() ),
+		m_stream( _stream ),
+		m_file( NULL ),
+		m_peaks( NULL )
+	{
+	}
+
+	//! takes ownership of _file, _data has to be mapped from it
+	SampleData( QFile * _file, sampleFrame * _data, f_cnt_t _frames ) :
+		m_data( _data ),
+		m_frames( _frames ),
+		m_stream( NULL ),
+		m_file( _file ),
+		m_peaks( NULL )
+	{
+	}
+
+	virtual ~SampleData()
+	{
+		SampleDataCache::remove( this );
+		delete m_peaks;
+		if( m_file )
+		{
+			m_file->unmap( (uchar *) m_data );
+			delete m_file;
+		}
+		else
+		{
+			MM_FREE( m_data );
+		}
+		delete m_stream;
+	}
+
+	inline const sampleFrame * data() const
+	{
+		return m_data;
+	}
+
+	inline SampleStream * stream() const
+	{
+		return m_stream;
+	}
+
+	inline f_cnt_t frames() const
+	{
+		return m_frames;
+	}
+
+	//! The peaks of streamed samples are incomplete until the stream has
+	//! scanned the whole file. Not realtime safe.
+	const SamplePeaks * peaks() const
+	{
+		if( m_stream != NULL )
+		{
+			return m_stream->peaks();
+		}
+		QMutexLocker lock( &m_peaksMutex );
+		if( m_peaks == NULL && m_data != NULL )
+		{
+			m_peaks = new SamplePeaks( m_data, m_frames );
+		}
+		return m_peaks;
+	}
+
+
+private:
+	sampleFrame * m_data;
+	f_cnt_t m_frames;
+	SampleStream * m_stream;
+	QFile * m_file;
+	mutable SamplePeaks * m_peaks;
+	mutable QMutex m_peaksMutex;
+	// set by SampleDataCache::insert()
+	QString m_cacheKey;
+
+
+	friend class SampleDataCache;
+
+} ;
+
+
+#endif
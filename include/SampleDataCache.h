@@ -0,0 +1,65 @@
+/*
+ * SampleDataCache.h - shares decoded samples between all SampleBuffers
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_DATA_CACHE_H
+#define SAMPLE_DATA_CACHE_H
+
+#include <QtCore/QString>
+
+#include "export.h"
+#include "lmms_basics.h"
+
+class SampleData;
+
+
+//! Keeps track of all SampleData objects by what they have been created
+//! from, so that SampleBuffers loading the same file or holding the same
+//! frames share one copy of the data. The cache doesn't hold references
+//! itself - an entry disappears as soon as the last SampleBuffer using it
+//! releases it.
+class EXPORT SampleDataCache
+{
+public:
+	//! Returns a new reference to the data stored for _key, or NULL if
+	//! there is none.
+	static SampleData * acquire( const QString & _key );
+
+	//! Stores _data for _key and returns it. If another thread inserted
+	//! data for _key in the meantime, _data is released and a new
+	//! reference to the other data is returned instead.
+	static SampleData * insert( const QString & _key, SampleData * _data );
+
+	//! Called by SampleData's destructor.
+	static void remove( SampleData * _data );
+
+	//! Key of _file decoded with the given settings - includes the file's
+	//! modification time, so changed files are loaded again.
+	static QString fileKey( const QString & _file, sample_rate_t _sample_rate,
+								bool _reversed );
+
+	//! Key of a copy of _frames frames from _data.
+	static QString dataKey( const sampleFrame * _data, f_cnt_t _frames );
+
+} ;
+
+
+#endif
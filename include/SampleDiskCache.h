@@ -0,0 +1,67 @@
+/*
+ * SampleDiskCache.h - keeps decoded samples on disk between sessions
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_DISK_CACHE_H
+#define SAMPLE_DISK_CACHE_H
+
+#include <QtCore/QString>
+
+#include "lmms_basics.h"
+
+class SampleData;
+
+
+//! Stores the frames of decoded and resampled audio files as raw floats in
+//! a cache directory, so that opening the same files again only has to map
+//! the cached frames instead of decoding and resampling them. Entries are
+//! keyed by a hash over the source file's path, size and modification time
+//! plus the target sample rate.
+//!
+//! Disabled unless the "samplecache"/"dir" configuration value is set.
+//! Least recently used entries are removed once the cache exceeds
+//! "samplecache"/"sizelimit" MB or haven't been used for
+//! "samplecache"/"maxage" days.
+class SampleDiskCache
+{
+public:
+	static bool isEnabled();
+
+	//! Maps the cached frames of _file, returns NULL if there are none.
+	//! Thread safe.
+	static SampleData * load( const QString & _file,
+				sample_rate_t _sample_rate, bool _reversed );
+
+	//! Writes _data to the cache. Thread safe.
+	static void store( const QString & _file, sample_rate_t _sample_rate,
+				bool _reversed, const SampleData * _data );
+
+
+private:
+	static QString directory();
+	static QString fileName( const QString & _file,
+				sample_rate_t _sample_rate, bool _reversed );
+	static void enforceLimits();
+
+} ;
+
+
+#endif
@@ -0,0 +1,90 @@
+/*
+ * SampleInterpolator.h - fast interpolation for pitched sample playback
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_INTERPOLATOR_H
+#define SAMPLE_INTERPOLATOR_H
+
+#include "export.h"
+#include "lmms_basics.h"
+
+
+//! Resamples frames at an arbitrary ratio, as needed for playing samples at
+//! a different pitch. Unlike libsamplerate, it keeps no state besides the
+//! fractional read position, so it is cheap enough to be used for every
+//! voice of large drum kits. The sinc qualities use precomputed polyphase
+//! tables, which are stretched by the ratio when it is above 1 so that
+//! pitching up doesn't alias. SRC_SINC_BEST_QUALITY is still left to
+//! libsamplerate.
+//!
+//! Its output differs slightly from libsamplerate's, so it is only used if
+//! enabled in the settings, otherwise existing projects would change their
+//! sound.
+//!
+//! process() reads historyFrames() frames before _src and lookaheadFrames()
+//! frames after the last position it interpolates at, so callers have to
+//! keep the last historyFrames() input frames around between calls. Both
+//! cover the widest stretched kernel, so they don't depend on the ratio.
+class EXPORT SampleInterpolator
+{
+public:
+	enum Qualities
+	{
+		ZeroOrderHold,
+		Linear,
+		SincFast,
+		SincMedium,
+		NumQualities
+	} ;
+
+	static const int MaxHistoryFrames = 31;
+
+	static bool isEnabled();
+	static void setEnabled( bool _enabled );
+
+	//! Returns false if _converter (a libsamplerate converter type) has no
+	//! counterpart here and should be left to libsamplerate.
+	static bool fromConverter( int _converter, Qualities * _quality );
+
+	static int historyFrames( Qualities _quality );
+	static int lookaheadFrames( Qualities _quality );
+
+	//! Returns how many input frames a process() call for _frames frames
+	//! at _ratio will read, starting at _src.
+	static inline f_cnt_t inputFrames( Qualities _quality, fpp_t _frames,
+					double _ratio, double _position )
+	{
+		return static_cast<f_cnt_t>( _position + _frames * _ratio ) + 1 +
+						lookaheadFrames( _quality );
+	}
+
+	//! Writes _frames frames to _dst, the first one interpolated at
+	//! _src + *_position, each following one _ratio input frames further.
+	//! Returns how many input frames were consumed and leaves the
+	//! fraction of the next read position in *_position.
+	static f_cnt_t process( Qualities _quality, const sampleFrame * _src,
+				sampleFrame * _dst, fpp_t _frames,
+					double _ratio, double * _position );
+
+} ;
+
+
+#endif
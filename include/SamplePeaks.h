@@ -0,0 +1,102 @@
+/*
+ * SamplePeaks.h - min/max pyramid for drawing waveforms
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_PEAKS_H
+#define SAMPLE_PEAKS_H
+
+#include <QtCore/QVector>
+
+#include "AtomicInt.h"
+#include "lmms_basics.h"
+#include "MemoryManager.h"
+
+
+//! Minimum and maximum of every channel over blocks of frames, at several
+//! block sizes - each level combines BlocksPerLevel blocks of the level
+//! below. The peak of any range of frames can be looked up by combining a
+//! handful of blocks, so drawing a waveform costs the same no matter how
+//! many frames each pixel covers.
+//!
+//! For frames which aren't held in memory, e.g. streamed samples, the peaks
+//! are added block by block while the frames are being decoded.
+class SamplePeaks
+{
+	MM_OPERATORS
+public:
+	struct Peak
+	{
+		sample_t min[DEFAULT_CHANNELS];
+		sample_t max[DEFAULT_CHANNELS];
+	} ;
+
+	//! _data has to outlive the SamplePeaks
+	SamplePeaks( const sampleFrame * _data, f_cnt_t _frames );
+
+	//! Creates empty peaks for _frames frames which have to be passed to
+	//! add() in order. Ranges shorter than a block are approximated by the
+	//! blocks covering them.
+	explicit SamplePeaks( f_cnt_t _frames );
+
+	//! Adds the _frames frames following the ones added so far. _frames
+	//! has to be a multiple of StreamBlockFrames unless the frames end
+	//! there. Must not be called by more than one thread.
+	void add( const sampleFrame * _data, f_cnt_t _frames );
+
+	//! Returns how many frames the peaks cover so far. May be called from
+	//! any thread while add() is running.
+	inline f_cnt_t frames() const
+	{
+		return (int) m_available;
+	}
+
+	//! Returns the peak of the frames from _start up to (excluding) _end.
+	//! Frames not added yet are treated as silence.
+	Peak peak( f_cnt_t _start, f_cnt_t _end ) const;
+
+	// larger blocks for frames which aren't in memory, so that the peaks
+	// of hour long streams stay within a few MB
+	static const f_cnt_t StreamBlockFrames = 256;
+
+
+private:
+	static const f_cnt_t BlockFrames = 64;
+	static const int LevelShift = 2;
+	static const int BlocksPerLevel = 1 << LevelShift;
+
+	inline f_cnt_t blockFrames( int _level ) const
+	{
+		return m_blockFrames << ( LevelShift * _level );
+	}
+
+	void accumulate( Peak & _peak, f_cnt_t _start, f_cnt_t _end,
+							int _level ) const;
+
+	const sampleFrame * m_data;
+	f_cnt_t m_frames;
+	f_cnt_t m_blockFrames;
+	AtomicInt m_available;
+	QVector<QVector<Peak> > m_levels;
+
+} ;
+
+
+#endif
@@ -0,0 +1,67 @@
+/*
+ * SamplePreloader.h - decodes the samples of a project in parallel
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_PRELOADER_H
+#define SAMPLE_PRELOADER_H
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QObject>
+
+#include "AtomicInt.h"
+
+class QDomElement;
+class SampleData;
+
+
+//! Decodes all samples referenced by a project on a thread pool before the
+//! project's tracks are loaded. SampleBuffers loading the same files then
+//! find the decoded data in SampleDataCache instead of decoding the files
+//! one after another. The data is kept alive until the preloader is
+//! destroyed, so it has to live until the project has been loaded.
+class SamplePreloader : public QObject
+{
+	Q_OBJECT
+public:
+	SamplePreloader();
+	virtual ~SamplePreloader();
+
+	//! Decodes the samples referenced in _project and returns once all of
+	//! them are done, showing the progress if there's a GUI. Returns false
+	//! if the user cancelled loading.
+	bool load( const QDomElement & _project );
+
+
+private:
+	class Job;
+
+	void jobDone( SampleData * _data );
+
+	QMutex m_dataMutex;
+	QList<SampleData *> m_data;
+	AtomicInt m_jobsDone;
+	AtomicInt m_cancelled;
+
+} ;
+
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * SampleStream.h - plays long audio files from disk instead of from memory
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef SAMPLE_STREAM_H
+#define SAMPLE_STREAM_H
+
+#include <QtCore/QFile>
+#include <QtCore/QString>
+
+#include <samplerate.h>
+#include <sndfile.h>
+
+#include "AtomicInt.h"
+#include "lmms_basics.h"
+#include "MemoryManager.h"
+#include "SamplePeaks.h"
+
+
+//! Decodes an audio file block by block while it is being played. Only a
+//! fixed number of blocks is kept in memory, no matter how long the file is:
+//!
+//! - the head of the file, loaded when the stream is opened, so playback
+//!   starting at the beginning never has to wait for the disk
+//! - a few cue windows which get loaded in advance at positions playback is
+//!   going to jump to, e.g. the song's loop begin
+//! - a ring of blocks which a background thread fills ahead of the current
+//!   read position
+//!
+//! Frames are delivered at the sample rate passed to open(). read() never
+//! blocks - frames which haven't been loaded yet are played as silence.
+//!
+//! Whenever there's nothing to load for playback, the background thread
+//! decodes the file from the beginning to build the peaks for drawing the
+//! waveform.
+class SampleStream
+{
+	MM_OPERATORS
+public:
+	enum Cues
+	{
+		CuePlayPosition,
+		CueLoopBegin,
+		NumCues
+	} ;
+
+	//! Returns NULL if _file can't be opened or doesn't support seeking.
+	static SampleStream * open( const QString & _file,
+						sample_rate_t _sample_rate );
+
+	//! Returns the length of _file in seconds without decoding it, or a
+	//! negative value if libsndfile can't open it.
+	static double fileLength( const QString & _file );
+
+	~SampleStream();
+
+	inline f_cnt_t frames() const
+	{
+		return m_frames;
+	}
+
+	//! Copies _frames frames beginning at _start to _dst and marks _start as
+	//! the current read position. Realtime safe.
+	void read( sampleFrame * _dst, f_cnt_t _start, f_cnt_t _frames );
+
+	//! Requests the frames following _frame to be held in memory, so that
+	//! playback can jump there without a dropout.
+	void cue( Cues _cue, f_cnt_t _frame );
+
+	//! The peaks of the frames scanned so far, see SamplePeaks::frames().
+	inline const SamplePeaks * peaks() const
+	{
+		return m_peaks;
+	}
+
+
+private:
+	// 16384 frames are ~0.37 seconds at 44.1 kHz
+	static const f_cnt_t BlockFrames = 16384;
+	static const int HeadBlocks = 4;
+	static const int CueBlocks = 4;
+	static const int RingBlocks = 32;
+	// must be less than RingBlocks, so that the block being read is never
+	// overwritten
+	static const int ReadAheadBlocks = 24;
+	static const f_cnt_t InputFrames = 4096;
+
+	struct Block
+	{
+		Block();
+		~Block();
+
+		// index of the block in the file, -1 while empty or being written
+		AtomicInt index;
+		sampleFrame * frames;
+	} ;
+
+	struct Cue
+	{
+		Cue();
+
+		// first block of the window, -1 if unused
+		AtomicInt requested;
+		Block blocks[CueBlocks];
+	} ;
+
+	SampleStream( const QString & _file, sample_rate_t _sample_rate );
+
+	bool openFile();
+	bool copyFrom( Block & _block, int _index, f_cnt_t _offset,
+				sampleFrame * _dst, f_cnt_t _frames );
+	bool isLoaded( int _index );
+	inline int blockCount() const
+	{
+		return ( m_frames + BlockFrames - 1 ) / BlockFrames;
+	}
+
+	// the following is only called by the loader thread (and by open()
+	// before the stream has been handed to it)
+	bool service();
+	void loadBlock( Block & _block, int _index );
+	void seek( int _index );
+	f_cnt_t decode( sampleFrame * _dst, f_cnt_t _frames );
+	f_cnt_t readInput();
+
+	QString m_fileName;
+	QFile m_file;
+	SNDFILE * m_sndFile;
+	int m_channels;
+	sample_rate_t m_fileSampleRate;
+	sample_rate_t m_sampleRate;
+	f_cnt_t m_frames;
+
+	Block m_head[HeadBlocks];
+	Cue m_cues[NumCues];
+	Block m_ring[RingBlocks];
+	// only used for scanning the peaks, never read from
+	Block m_scan;
+	SamplePeaks * m_peaks;
+
+	// block read() has been called for the last time
+	AtomicInt m_readBlock;
+
+	// decoder state
+	SRC_STATE * m_srcState;
+	double m_ratio;
+	float * m_interleaved;
+	sampleFrame * m_input;
+	f_cnt_t m_inputFrames;
+	f_cnt_t m_inputPos;
+	bool m_eof;
+	int m_nextBlock;
+
+
+	friend class SampleStreamLoader;
+
+} ;
+
+
+#endif
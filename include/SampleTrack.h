@@ -77,6 +77,10 @@ public slots:
 
 
 private:
+	void cueSample();
+	// frame of the sample played at _time, -1 if outside of this TCO
+	f_cnt_t sampleFrameAt( const MidiTime & _time ) const;
+
 	SampleBuffer* m_sampleBuffer;
 	BoolModel m_recordModel;
 	bool m_isPlaying;
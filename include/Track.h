@@ -579,6 +579,10 @@ public:
 
 	BoolModel* getMutedModel();
 
+	// mutes or unmutes the track without adding an undo step, for muting
+	// tracks temporarily while rendering
+	void setMutedWithoutJournalling( bool muted );
+
 public slots:
 	virtual void setName( const QString & newName )
 	{
@@ -0,0 +1,74 @@
+/*
+ * TrackFreezer.h - renders an instrument track into its freeze cache
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#ifndef TRACK_FREEZER_H
+#define TRACK_FREEZER_H
+
+#include <QtCore/QThread>
+#include <QtCore/QVector>
+
+class FreezeCache;
+class InstrumentTrack;
+class Track;
+
+
+//! Renders the post-effect output of an instrument track across the whole
+//! song, the same way ProjectRenderer exports a project, and hands the
+//! result over to the track once done.
+class TrackFreezer : public QThread
+{
+	Q_OBJECT
+public:
+	TrackFreezer( InstrumentTrack * _track );
+	virtual ~TrackFreezer();
+
+
+public slots:
+	void startProcessing();
+	void abortProcessing();
+
+
+signals:
+	void progressChanged( int );
+	void freezeFinished();
+
+
+private slots:
+	void finishProcessing();
+
+
+private:
+	virtual void run();
+
+	InstrumentTrack * m_track;
+	FreezeCache * m_cache;
+
+	QVector<Track *> m_mutedTracks;
+	bool m_trackWasMuted;
+
+	volatile int m_progress;
+	volatile bool m_abort;
+
+} ;
+
+
+#endif
@@ -66,6 +66,7 @@ public:
 		m_syncData->m_playbackJumped = jumped;
 	}
 
+public slots:
 	void update();
 
 
@@ -52,6 +52,21 @@ public:
 		return object;
 	}
 
+	// like ref(), but returns NULL instead if the object is being deleted
+	// already, e.g. when looking it up in a cache not holding references
+	template<class T>
+	static T* refIfReferenced( T* object )
+	{
+		object->m_lock.lock();
+		const bool referenced = object->m_referenceCount > 0;
+		if( referenced )
+		{
+			++object->m_referenceCount;
+		}
+		object->m_lock.unlock();
+		return referenced ? object : NULL;
+	}
+
 	template<class T>
 	static void unref( T* object )
 	{
@@ -59,9 +59,9 @@ CrossoverEQEffect::CrossoverEQEffect( Model* parent, const Descriptor::SubPlugin
 	m_hp4( m_sampleRate ),
 	m_needsUpdate( true )
 {
-	m_tmp1 = MM_ALLOC( sampleFrame, Engine::mixer()->framesPerPeriod() );
-	m_tmp2 = MM_ALLOC( sampleFrame, Engine::mixer()->framesPerPeriod() );
-	m_work = MM_ALLOC( sampleFrame, Engine::mixer()->framesPerPeriod() );
+	m_tmp1 = MM_ALLOC( sampleFrame, DEFAULT_BUFFER_SIZE );
+	m_tmp2 = MM_ALLOC( sampleFrame, DEFAULT_BUFFER_SIZE );
+	m_work = MM_ALLOC( sampleFrame, DEFAULT_BUFFER_SIZE );
 }
 
 CrossoverEQEffect::~CrossoverEQEffect()
@@ -26,6 +26,7 @@
 
 #include "VstEffect.h"
 
+#include "BufferManager.h"
 #include "GuiApplication.h"
 #include "Song.h"
 #include "TextFloat.h"
@@ -59,8 +60,10 @@ VstEffect::VstEffect( Model * _parent,
 	Effect( &vsteffect_plugin_descriptor, _parent, _key ),
 	m_pluginMutex(),
 	m_key( *_key ),
+	m_delayDry( false ),
 	m_vstControls( this )
 {
+	BufferManager::clear( m_delayedDry, DEFAULT_BUFFER_SIZE );
 	if( !m_key.attributes["file"].isEmpty() )
 	{
 		openPlugin( m_key.attributes["file"] );
@@ -98,9 +101,22 @@ bool VstEffect::processAudioBuffer( sampleFrame * _buf, const fpp_t _frames )
 		if (m_pluginMutex.tryLock(Engine::getSong()->isExporting() ? -1 : 0))
 		{
 			m_plugin->process( buf, buf );
+			m_delayDry = m_plugin->latency() > 0;
 			m_pluginMutex.unlock();
 		}
 
+		// a pipelined plugin returns the previous period, so mix it
+		// with the dry signal of that period - the delayed signal has
+		// to move on even if the plugin was busy
+		if( m_delayDry )
+		{
+			for( fpp_t f = 0; f < _frames; ++f )
+			{
+				qSwap( _buf[f][0], m_delayedDry[f][0] );
+				qSwap( _buf[f][1], m_delayedDry[f][1] );
+			}
+		}
+
 		double out_sum = 0.0;
 		const float w = wetLevel();
 		for( fpp_t f = 0; f < _frames; ++f )
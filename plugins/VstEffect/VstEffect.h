@@ -63,6 +63,10 @@ private:
 	QMutex m_pluginMutex;
 	EffectKey m_key;
 
+	// dry input of the last period, see processAudioBuffer()
+	sampleFrame m_delayedDry[DEFAULT_BUFFER_SIZE];
+	bool m_delayDry;
+
 	VstEffectControls m_vstControls;
 
 
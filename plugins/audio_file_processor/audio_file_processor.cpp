@@ -213,9 +213,7 @@ void audioFileProcessor::saveSettings( QDomDocument & _doc,
 	_this.setAttribute( "src", m_sampleBuffer.audioFile() );
 	if( m_sampleBuffer.audioFile() == "" )
 	{
-		QString s;
-		_this.setAttribute( "sampledata",
-						m_sampleBuffer.toBase64( s ) );
+		m_sampleBuffer.saveSampleData( _doc, _this, "sampledata" );
 	}
 	m_reverseModel.saveSettings( _doc, _this, "reversed" );
 	m_loopModel.saveSettings( _doc, _this, "looped" );
@@ -245,9 +243,9 @@ void audioFileProcessor::loadSettings( const QDomElement & _this )
 			Engine::getSong()->collectError( message );
 		}
 	}
-	else if( _this.attribute( "sampledata" ) != "" )
+	else
 	{
-		m_sampleBuffer.loadFromBase64( _this.attribute( "srcdata" ) );
+		m_sampleBuffer.loadSampleData( _this, "sampledata" );
 	}
 
 	m_loopModel.loadSettings( _this, "looped" );
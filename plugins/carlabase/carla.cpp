@@ -183,6 +183,7 @@ CarlaInstrument::CarlaInstrument(InstrumentTrack* const instrumentTrack, const D
     Engine::mixer()->addPlayHandle( iph );
 
     connect(Engine::mixer(), SIGNAL(sampleRateChanged()), this, SLOT(sampleRateChanged()));
+    connect(Engine::mixer(), SIGNAL(framesPerPeriodChanged()), this, SLOT(bufferSizeChanged()));
 }
 
 CarlaInstrument::~CarlaInstrument()
@@ -457,6 +458,11 @@ void CarlaInstrument::sampleRateChanged()
     fDescriptor->dispatcher(fHandle, NATIVE_PLUGIN_OPCODE_SAMPLE_RATE_CHANGED, 0, 0, nullptr, handleGetSampleRate());
 }
 
+void CarlaInstrument::bufferSizeChanged()
+{
+    fDescriptor->dispatcher(fHandle, NATIVE_PLUGIN_OPCODE_BUFFER_SIZE_CHANGED, 0, handleGetBufferSize(), nullptr, 0.0f);
+}
+
 // -------------------------------------------------------------------
 
 CarlaInstrumentView::CarlaInstrumentView(CarlaInstrument* const instrument, QWidget* const parent)
@@ -79,6 +79,7 @@ signals:
 
 private slots:
     void sampleRateChanged();
+    void bufferSizeChanged();
 
 private:
     const bool kIsPatchbay;
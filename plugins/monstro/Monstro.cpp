@@ -1006,8 +1006,9 @@ MonstroInstrument::MonstroInstrument( InstrumentTrack * _instrument_track ) :
 // updateSampleRate
 
 	connect( Engine::mixer(), SIGNAL( sampleRateChanged() ), this, SLOT( updateSamplerate() ) );
+	connect( Engine::mixer(), SIGNAL( framesPerPeriodChanged() ), this, SLOT( updateFramesPerPeriod() ) );
 
-	m_fpp = Engine::mixer()->framesPerPeriod();
+	updateFramesPerPeriod();
 
 	updateSamplerate();
 	updateVolume1();
@@ -1430,6 +1431,12 @@ void MonstroInstrument::updateSamplerate()
 }
 
 
+void MonstroInstrument::updateFramesPerPeriod()
+{
+	m_fpp = Engine::mixer()->framesPerPeriod();
+}
+
+
 void MonstroInstrument::updateSlope1()
 {
 	const float slope = m_env1Slope.value();
@@ -367,6 +367,7 @@ public slots:
 	void updateEnvelope2();
 	void updateLFOAtts();
 	void updateSamplerate();
+	void updateFramesPerPeriod();
 	void updateSlope1();
 	void updateSlope2();
 	
@@ -155,9 +155,10 @@ opl2instrument::opl2instrument( InstrumentTrack * _instrument_track ) :
 
 	updatePatch();
 
-	// Can the buffer size change suddenly? I bet that would break lots of stuff
+	// the period size may change at runtime, so allocate for the largest
+	// one and look it up when playing
 	frameCount = Engine::mixer()->framesPerPeriod();
-	renderbuffer = new short[frameCount];
+	renderbuffer = new short[DEFAULT_BUFFER_SIZE];
 
 	// Some kind of sane defaults
 	pitchbend = 0;
@@ -293,7 +294,18 @@ int opl2instrument::pushVoice(int v) {
 
 bool opl2instrument::handleMidiEvent( const MidiEvent& event, const MidiTime& time, f_cnt_t offset )
 {
-	emulatorMutex.lock();
+	// play() applies the event at its offset into the period
+	if( !queueMidiEvent( event, offset ) )
+	{
+		emulatorMutex.lock();
+		processQueuedMidiEvent( event );
+		emulatorMutex.unlock();
+	}
+	return true;
+}
+
+void opl2instrument::processQueuedMidiEvent( const MidiEvent& event )
+{
 	int key, vel, voice, tmp_pb;
 
 	switch(event.type()) {
@@ -381,8 +393,6 @@ bool opl2instrument::handleMidiEvent( const MidiEvent& event, const MidiTime& ti
 #endif
 		break;
         }
-	emulatorMutex.unlock();
-	return true;
 }
 
 QString opl2instrument::nodeName() const
@@ -399,21 +409,27 @@ PluginView * opl2instrument::instantiateView( QWidget * _parent )
 void opl2instrument::play( sampleFrame * _working_buffer )
 {
 	emulatorMutex.lock();
-	theEmulator->update(renderbuffer, frameCount);
+	frameCount = Engine::mixer()->framesPerPeriod();
+	renderSplitAtEvents( _working_buffer, frameCount );
+	emulatorMutex.unlock();
 
-	for( fpp_t frame = 0; frame < frameCount; ++frame )
+	// Throw the data to the track...
+	instrumentTrack()->processAudioBuffer( _working_buffer, frameCount, NULL );
+
+}
+
+void opl2instrument::renderFrames( sampleFrame * _buf, const fpp_t _frames )
+{
+	theEmulator->update(renderbuffer, _frames);
+
+	for( fpp_t frame = 0; frame < _frames; ++frame )
         {
                 sample_t s = float(renderbuffer[frame]) / 8192.0;
                 for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
                 {
-                        _working_buffer[frame][ch] = s;
+                        _buf[frame][ch] = s;
                 }
 	}
-	emulatorMutex.unlock();
-
-	// Throw the data to the track...
-	instrumentTrack()->processAudioBuffer( _working_buffer, frameCount, NULL );
-
 }
 
 
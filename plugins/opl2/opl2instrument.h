@@ -132,6 +132,9 @@ private:
 	int popVoice();
 	int pushVoice(int v);
 
+	virtual void renderFrames( sampleFrame * _buf, const fpp_t _frames );
+	virtual void processQueuedMidiEvent( const MidiEvent& event );
+
 	int Hz2fnum(float Hz);
 	static QMutex emulatorMutex;
 	void setVoiceVelocity(int voice, int vel);
@@ -106,7 +106,8 @@ sf2Instrument::sf2Instrument( InstrumentTrack * _instrument_track ) :
 	m_chorusNum( FLUID_CHORUS_DEFAULT_N, 0, 10.0, 1.0, this, tr( "Chorus Lines" ) ),
 	m_chorusLevel( FLUID_CHORUS_DEFAULT_LEVEL, 0, 10.0, 0.01, this, tr( "Chorus Level" ) ),
 	m_chorusSpeed( FLUID_CHORUS_DEFAULT_SPEED, 0.29, 5.0, 0.01, this, tr( "Chorus Speed" ) ),
-	m_chorusDepth( FLUID_CHORUS_DEFAULT_DEPTH, 0, 46.0, 0.05, this, tr( "Chorus Depth" ) )
+	m_chorusDepth( FLUID_CHORUS_DEFAULT_DEPTH, 0, 46.0, 0.05, this, tr( "Chorus Depth" ) ),
+	m_renderedFrames( 0 )
 {
 	for( int i = 0; i < 128; ++i )
 	{
@@ -685,7 +686,8 @@ void sf2Instrument::play( sampleFrame * _working_buffer )
 {
 	const fpp_t frames = Engine::mixer()->framesPerPeriod();
 
-	// set midi pitch for this period
+	// set midi pitch for this period unless handleMidiEvent() got the
+	// change and applies it at its offset
 	const int currentMidiPitch = instrumentTrack()->midiPitch();
 	if( m_lastMidiPitch != currentMidiPitch )
 	{
@@ -704,17 +706,80 @@ void sf2Instrument::play( sampleFrame * _working_buffer )
 		fluid_synth_pitch_wheel_sens( m_synth, m_channel, m_lastMidiPitchRange );
 		m_synthMutex.unlock();
 	}
-	// if we have no new noteons/noteoffs, just render a period and call it a day
-	if( m_playingNotes.isEmpty() )
+
+	// queued pitch bends and controller changes split the period, note
+	// ons and offs split the parts in between in renderFrames()
+	m_renderedFrames = 0;
+	renderSplitAtEvents( _working_buffer, frames );
+
+	instrumentTrack()->processAudioBuffer( _working_buffer, frames, NULL );
+}
+
+
+
+
+bool sf2Instrument::handleMidiEvent( const MidiEvent& event,
+					const MidiTime&, f_cnt_t offset )
+{
+	switch( event.type() )
 	{
-		renderFrames( frames, _working_buffer );
-		instrumentTrack()->processAudioBuffer( _working_buffer, frames, NULL );
-		return;
+		case MidiPitchBend:
+			// keep play() from applying it at the start of the period
+			m_lastMidiPitch = event.pitchBend();
+			break;
+
+		case MidiControlChange:
+			// the track handles the sustain pedal and channel mode
+			// messages for our notes already
+			if( event.controllerNumber() == MidiControllerSustain ||
+				event.controllerNumber() >= MidiControllerAllSoundOff )
+			{
+				return true;
+			}
+			break;
+
+		default:
+			// notes reach us as NotePlayHandles
+			return true;
 	}
 
-	// processing loop
+	if( !queueMidiEvent( event, offset ) )
+	{
+		processQueuedMidiEvent( event );
+	}
+	return true;
+}
+
+
+
+
+void sf2Instrument::processQueuedMidiEvent( const MidiEvent& event )
+{
+	m_synthMutex.lock();
+	if( event.type() == MidiPitchBend )
+	{
+		fluid_synth_pitch_bend( m_synth, m_channel, event.pitchBend() );
+	}
+	else
+	{
+		fluid_synth_cc( m_synth, m_channel, event.controllerNumber(),
+						event.controllerValue() );
+	}
+	m_synthMutex.unlock();
+}
+
+
+
+
+void sf2Instrument::renderFrames( sampleFrame * _buf, const fpp_t _frames )
+{
+	// offsets are relative to the period, _buf isn't
+	sampleFrame * periodBuf = _buf - m_renderedFrames;
+	const f_cnt_t end = m_renderedFrames + _frames;
+	const bool lastPart = end >= Engine::mixer()->framesPerPeriod();
+
 	// go through noteplayhandles in processing order
-	f_cnt_t currentFrame = 0;
+	f_cnt_t currentFrame = m_renderedFrames;
 
 	while( ! m_playingNotes.isEmpty() )
 	{
@@ -730,13 +795,21 @@ void sf2Instrument::play( sampleFrame * _working_buffer )
 			}
 		}
 
+		// notes of later parts wait for them, the last part takes
+		// everything left
+		SF2PluginData * currentData = static_cast<SF2PluginData *>( currentNote->m_pluginData );
+		if( currentData->offset >= end && !lastPart )
+		{
+			break;
+		}
+
 		// process the current note:
 		// first see if we're synced in frame count
-		SF2PluginData * currentData = static_cast<SF2PluginData *>( currentNote->m_pluginData );
-		if( currentData->offset > currentFrame )
+		const f_cnt_t offset = qMin( currentData->offset, end );
+		if( offset > currentFrame )
 		{
-			renderFrames( currentData->offset - currentFrame, _working_buffer + currentFrame );
-			currentFrame = currentData->offset;
+			renderSynth( offset - currentFrame, periodBuf + currentFrame );
+			currentFrame = offset;
 		}
 		if( currentData->isNew )
 		{
@@ -762,15 +835,15 @@ void sf2Instrument::play( sampleFrame * _working_buffer )
 		}
 	}
 
-	if( currentFrame < frames )
+	if( currentFrame < end )
 	{
-		renderFrames( frames - currentFrame, _working_buffer + currentFrame );
+		renderSynth( end - currentFrame, periodBuf + currentFrame );
 	}
-	instrumentTrack()->processAudioBuffer( _working_buffer, frames, NULL );
+	m_renderedFrames = end;
 }
 
 
-void sf2Instrument::renderFrames( f_cnt_t frames, sampleFrame * buf )
+void sf2Instrument::renderSynth( f_cnt_t frames, sampleFrame * buf )
 {
 	m_synthMutex.lock();
 	if( m_internalSampleRate < Engine::mixer()->processingSampleRate() &&
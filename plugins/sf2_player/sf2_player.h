@@ -60,6 +60,9 @@ public:
 
 	virtual void play( sampleFrame * _working_buffer );
 
+	virtual bool handleMidiEvent( const MidiEvent& event,
+				const MidiTime& time, f_cnt_t offset = 0 );
+
 	virtual void playNote( NotePlayHandle * _n,
 						sampleFrame * _working_buffer );
 	virtual void deleteNotePluginData( NotePlayHandle * _n );
@@ -154,11 +157,17 @@ private:
 	QVector<NotePlayHandle *> m_playingNotes;
 	QMutex m_playingNotesMutex;
 
+	// how much of the current period has been rendered
+	f_cnt_t m_renderedFrames;
+
 private:
 	void freeFont();
 	void noteOn( SF2PluginData * n );
 	void noteOff( SF2PluginData * n );
-	void renderFrames( f_cnt_t frames, sampleFrame * buf );
+	void renderSynth( f_cnt_t frames, sampleFrame * buf );
+
+	virtual void renderFrames( sampleFrame * _buf, const fpp_t _frames );
+	virtual void processQueuedMidiEvent( const MidiEvent& event );
 
 	friend class sf2InstrumentView;
 
@@ -339,7 +339,7 @@ void WatsynInstrument::playNote( NotePlayHandle * _n,
 				&B2_wave[0],
 				m_amod.value(), m_bmod.value(),
 				Engine::mixer()->processingSampleRate(), _n,
-				Engine::mixer()->framesPerPeriod(), this );
+				DEFAULT_BUFFER_SIZE, this );
 
 		_n->m_pluginData = w;
 	}
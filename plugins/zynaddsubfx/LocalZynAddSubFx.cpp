@@ -142,11 +142,21 @@ void LocalZynAddSubFx::loadXML( const std::string & _filename )
 {
 	char * f = strdup( _filename.c_str() );
 
+	// reading and parsing the file doesn't touch the running instance
+	XMLwrapper * xml = new XMLwrapper();
+	const bool ok = xml->loadXMLfile( f ) >= 0 &&
+					xml->enterbranch( "MASTER" );
+
 	pthread_mutex_lock( &m_master->mutex );
 	m_master->defaults();
-	m_master->loadXML( f );
+	if( ok )
+	{
+		m_master->getfromXML( xml );
+	}
 	pthread_mutex_unlock( &m_master->mutex );
 
+	delete xml;
+
 	m_master->applyparameters();
 
 	unlink( f );
@@ -160,11 +170,20 @@ void LocalZynAddSubFx::loadPreset( const std::string & _filename, int _part )
 {
 	char * f = strdup( _filename.c_str() );
 
+	XMLwrapper * xml = new XMLwrapper();
+	const bool ok = xml->loadXMLfile( f ) >= 0 &&
+					xml->enterbranch( "INSTRUMENT" );
+
 	pthread_mutex_lock( &m_master->mutex );
 	m_master->part[_part]->defaultsinstrument();
-	m_master->part[_part]->loadXMLinstrument( f );
+	if( ok )
+	{
+		m_master->part[_part]->getfromXMLinstrument( xml );
+	}
 	pthread_mutex_unlock( &m_master->mutex );
 
+	delete xml;
+
 	m_master->applyparameters();
 
 	free( f );
@@ -275,3 +294,19 @@ void LocalZynAddSubFx::processAudio( sampleFrame * _out )
 }
 
 
+
+
+bool LocalZynAddSubFx::lockMaster( bool _wait )
+{
+	return m_master->mutexLock( _wait ? MUTEX_LOCK : MUTEX_TRYLOCK );
+}
+
+
+
+
+void LocalZynAddSubFx::unlockMaster()
+{
+	m_master->mutexLock( MUTEX_UNLOCK );
+}
+
+
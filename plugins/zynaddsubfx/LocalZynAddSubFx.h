@@ -56,6 +56,12 @@ public:
 
 	void processAudio( sampleFrame * _out );
 
+	// LMMS' audio thread holds the lock of the master while it processes
+	// MIDI events and renders - loadXML() and loadPreset() only take it
+	// for applying the parameters they've parsed already
+	bool lockMaster( bool _wait );
+	void unlockMaster();
+
 	inline Master * master()
 	{
 		return m_master;
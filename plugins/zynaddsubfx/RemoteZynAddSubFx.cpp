@@ -27,7 +27,10 @@
 #include <winsock2.h>
 #endif
 
+#include <list>
+#include <map>
 #include <queue>
+#include <vector>
 
 #define BUILD_REMOTE_PLUGIN_CLIENT
 #include "Note.h"
@@ -52,10 +55,15 @@ public:
 		RemotePluginClient( socketPath ),
 #endif
 		LocalZynAddSubFx(),
-		m_guiSleepTime( 100 ),
+		m_ui( NULL ),
+		m_exitProgram( 0 ),
 		m_guiExit( false )
 	{
-		Nio::start();
+		// the IO engines are shared by all instances of a process
+		if( s_instanceCount++ == 0 )
+		{
+			Nio::start();
+		}
 
 		setInputCount( 0 );
 		sendMessage( IdInitDone );
@@ -67,7 +75,27 @@ public:
 
 	virtual ~RemoteZynAddSubFx()
 	{
-		Nio::stop();
+		pthread_join( m_messageThreadHandle, NULL );
+
+		Fl::flush();
+		delete m_ui;
+
+		if( --s_instanceCount == 0 )
+		{
+			Nio::stop();
+		}
+	}
+
+	// creates an instance connecting to the channel given by the
+	// command line arguments of a dedicated process
+	static RemoteZynAddSubFx * create( const char * const * _args )
+	{
+#ifdef SYNC_WITH_SHM_FIFO
+		return new RemoteZynAddSubFx( atoi( _args[0] ),
+							atoi( _args[1] ) );
+#else
+		return new RemoteZynAddSubFx( _args[0] );
+#endif
 	}
 
 	virtual void updateSampleRate()
@@ -145,6 +173,18 @@ public:
 		LocalZynAddSubFx::processAudio( _out );
 	}
 
+	// renders a period the host got in a batch, called by its workers
+	void processBatched( const std::vector<MidiEvent> & _events )
+	{
+		pthread_mutex_lock( &m_master->mutex );
+		for( size_t i = 0; i < _events.size(); ++i )
+		{
+			LocalZynAddSubFx::processMidiEvent( _events[i] );
+		}
+		doProcessing();
+		pthread_mutex_unlock( &m_master->mutex );
+	}
+
 	static void * messageLoop( void * _arg )
 	{
 		RemoteZynAddSubFx * _this =
@@ -155,10 +195,22 @@ public:
 		return NULL;
 	}
 
+	inline bool hasUI() const
+	{
+		return m_ui != NULL;
+	}
+
+	// handles the messages for the GUI, returns false once LMMS
+	// disconnected
+	bool guiIteration();
+
 	void guiLoop();
 
 private:
-	const int m_guiSleepTime;
+	static int s_instanceCount;
+
+	MasterUI * m_ui;
+	int m_exitProgram;
 
 	pthread_t m_messageThreadHandle;
 	pthread_mutex_t m_guiMutex;
@@ -168,90 +220,425 @@ private:
 } ;
 
 
+int RemoteZynAddSubFx::s_instanceCount = 0;
 
+// how long the GUI thread sleeps between two iterations
+const int GuiSleepTime = 100;
 
-void RemoteZynAddSubFx::guiLoop()
+
+
+
+// the control channel of a process running several instances - LMMS asks
+// it to create an instance for every ZynAddSubFX track and, in pipelined
+// mode, hands it the periods of all of them at once
+class RemoteZynAddSubFxHost : public RemotePluginClient
 {
-	int exitProgram = 0;
-	MasterUI * ui = NULL;
+public:
+#ifdef SYNC_WITH_SHM_FIFO
+	RemoteZynAddSubFxHost( int _shm_in, int _shm_out, int _workers ) :
+		RemotePluginClient( _shm_in, _shm_out ),
+#else
+	RemoteZynAddSubFxHost( const char * socketPath, int _workers ) :
+		RemotePluginClient( socketPath ),
+#endif
+		m_nextJob( 0 ),
+		m_jobsDone( 0 ),
+		m_stopWorkers( false ),
+		m_quit( false )
+	{
+		sendMessage( IdInitDone );
+		waitForMessage( IdInitDone );
 
-	while( !m_guiExit )
+		pthread_mutex_init( &m_instanceMutex, NULL );
+		pthread_mutex_init( &m_jobMutex, NULL );
+		pthread_cond_init( &m_jobsAvailable, NULL );
+		pthread_cond_init( &m_jobsFinished, NULL );
+		for( int i = 0; i < std::max( _workers, 1 ); ++i )
+		{
+			pthread_t worker;
+			pthread_create( &worker, NULL, workerLoop, this );
+			m_workers.push_back( worker );
+		}
+
+		pthread_create( &m_messageThreadHandle, NULL, messageLoop,
+									this );
+	}
+
+	virtual ~RemoteZynAddSubFxHost()
 	{
-		if( ui )
+		pthread_join( m_messageThreadHandle, NULL );
+
+		pthread_mutex_lock( &m_jobMutex );
+		m_stopWorkers = true;
+		pthread_cond_broadcast( &m_jobsAvailable );
+		pthread_mutex_unlock( &m_jobMutex );
+		for( size_t i = 0; i < m_workers.size(); ++i )
 		{
-			Fl::wait( m_guiSleepTime / 1000.0 );
+			pthread_join( m_workers[i], NULL );
 		}
-		else
+
+		pthread_cond_destroy( &m_jobsFinished );
+		pthread_cond_destroy( &m_jobsAvailable );
+		pthread_mutex_destroy( &m_jobMutex );
+		pthread_mutex_destroy( &m_instanceMutex );
+	}
+
+	virtual void process( const sampleFrame *, sampleFrame * )
+	{
+	}
+
+	virtual bool processMessage( const message & _m )
+	{
+		if( _m.id == IdProcessInstances )
 		{
-#ifdef LMMS_BUILD_WIN32
-			Sleep( m_guiSleepTime );
+			processInstances( _m );
+			sendMessage( IdProcessingDone );
+			return true;
+		}
+
+		if( _m.id != IdAddInstance )
+		{
+			return RemotePluginClient::processMessage( _m );
+		}
+
+		const int argc = _m.getInt( 0 );
+		std::vector<std::string> args;
+		for( int i = 0; i < argc; ++i )
+		{
+			args.push_back( _m.getString( i + 1 ) );
+		}
+		pthread_mutex_lock( &m_instanceMutex );
+		m_pendingInstances.push( std::make_pair( _m.getInt( argc + 1 ),
+									args ) );
+		pthread_mutex_unlock( &m_instanceMutex );
+		return true;
+	}
+
+	// creates the instances requested since the last call - they have
+	// to be created by the GUI thread
+	void createInstances( std::list<RemoteZynAddSubFx *> & _instances )
+	{
+		pthread_mutex_lock( &m_instanceMutex );
+		while( !m_pendingInstances.empty() )
+		{
+			const int id = m_pendingInstances.front().first;
+			const std::vector<std::string> args =
+					m_pendingInstances.front().second;
+			m_pendingInstances.pop();
+			pthread_mutex_unlock( &m_instanceMutex );
+
+			std::vector<const char *> argv;
+			for( size_t i = 0; i < args.size(); ++i )
+			{
+				argv.push_back( args[i].c_str() );
+			}
+#ifdef SYNC_WITH_SHM_FIFO
+			if( argv.size() >= 2 )
 #else
-			usleep( m_guiSleepTime*1000 );
+			if( argv.size() >= 1 )
 #endif
+			{
+				RemoteZynAddSubFx * instance =
+					RemoteZynAddSubFx::create( &argv[0] );
+				_instances.push_back( instance );
+
+				// batches sent until now leave it out, LMMS
+				// gets a silent period then
+				pthread_mutex_lock( &m_instanceMutex );
+				m_instances[id] = instance;
+				pthread_mutex_unlock( &m_instanceMutex );
+			}
+
+			pthread_mutex_lock( &m_instanceMutex );
 		}
-		if( exitProgram == 1 )
+		pthread_mutex_unlock( &m_instanceMutex );
+	}
+
+	// has to be called before the instance is deleted
+	void removeInstance( RemoteZynAddSubFx * _instance )
+	{
+		pthread_mutex_lock( &m_instanceMutex );
+		std::map<int, RemoteZynAddSubFx *>::iterator it =
+							m_instances.begin();
+		while( it != m_instances.end() )
 		{
-			pthread_mutex_lock( &m_master->mutex );
-			sendMessage( IdHideUI );
-			exitProgram = 0;
-			pthread_mutex_unlock( &m_master->mutex );
+			if( it->second == _instance )
+			{
+				m_instances.erase( it++ );
+			}
+			else
+			{
+				++it;
+			}
+		}
+		pthread_mutex_unlock( &m_instanceMutex );
+	}
+
+	// LMMS only quits us after all instances are gone
+	inline bool quit() const
+	{
+		return m_quit;
+	}
+
+private:
+	struct Job
+	{
+		RemoteZynAddSubFx * instance;
+		std::vector<MidiEvent> events;
+	} ;
+
+	// renders the periods of all instances in an IdProcessInstances
+	// message and returns once all of them are done
+	void processInstances( const message & _m )
+	{
+		std::vector<Job> jobs;
+		int arg = 0;
+		const int count = _m.getInt( arg++ );
+
+		pthread_mutex_lock( &m_instanceMutex );
+		for( int i = 0; i < count; ++i )
+		{
+			const int id = _m.getInt( arg++ );
+			const int events = _m.getInt( arg++ );
+
+			Job job;
+			std::map<int, RemoteZynAddSubFx *>::const_iterator it =
+							m_instances.find( id );
+			job.instance = it != m_instances.end() ? it->second :
+									NULL;
+			for( int e = 0; e < events; ++e, arg += 5 )
+			{
+				job.events.push_back( MidiEvent(
+					static_cast<MidiEventTypes>(
+							_m.getInt( arg ) ),
+						_m.getInt( arg + 1 ),
+						_m.getInt( arg + 2 ),
+						_m.getInt( arg + 3 ) ) );
+			}
+			if( job.instance != NULL )
+			{
+				jobs.push_back( job );
+			}
+		}
+		pthread_mutex_unlock( &m_instanceMutex );
+
+		pthread_mutex_lock( &m_jobMutex );
+		m_jobs.swap( jobs );
+		m_nextJob = 0;
+		m_jobsDone = 0;
+		pthread_cond_broadcast( &m_jobsAvailable );
+		while( m_jobsDone < m_jobs.size() )
+		{
+			pthread_cond_wait( &m_jobsFinished, &m_jobMutex );
 		}
-		pthread_mutex_lock( &m_guiMutex );
-		while( m_guiMessages.size() )
+		m_jobs.clear();
+		pthread_mutex_unlock( &m_jobMutex );
+	}
+
+	static void * workerLoop( void * _arg )
+	{
+		RemoteZynAddSubFxHost * _this =
+				static_cast<RemoteZynAddSubFxHost *>( _arg );
+
+		pthread_mutex_lock( &_this->m_jobMutex );
+		while( true )
 		{
-			RemotePluginClient::message m = m_guiMessages.front();
-			m_guiMessages.pop();
-			switch( m.id )
+			while( !_this->m_stopWorkers &&
+				_this->m_nextJob >= _this->m_jobs.size() )
+			{
+				pthread_cond_wait( &_this->m_jobsAvailable,
+							&_this->m_jobMutex );
+			}
+			if( _this->m_stopWorkers )
 			{
-				case IdShowUI:
-					// we only create GUI
-					if( !ui )
-					{
-						Fl::scheme( "plastic" );
-						ui = new MasterUI( m_master, &exitProgram );
-					}
-					ui->showUI();
-					ui->refresh_master_ui();
-					break;
-
-				case IdLoadSettingsFromFile:
+				break;
+			}
+
+			// the jobs stay untouched until all of them are done
+			const Job & job = _this->m_jobs[_this->m_nextJob++];
+			pthread_mutex_unlock( &_this->m_jobMutex );
+
+			job.instance->processBatched( job.events );
+
+			pthread_mutex_lock( &_this->m_jobMutex );
+			if( ++_this->m_jobsDone == _this->m_jobs.size() )
+			{
+				pthread_cond_signal( &_this->m_jobsFinished );
+			}
+		}
+		pthread_mutex_unlock( &_this->m_jobMutex );
+
+		return NULL;
+	}
+
+	static void * messageLoop( void * _arg )
+	{
+		RemoteZynAddSubFxHost * _this =
+				static_cast<RemoteZynAddSubFxHost *>( _arg );
+
+		message m;
+		while( ( m = _this->receiveMessage() ).id != IdQuit &&
+						m.id != IdUndefined )
+		{
+			_this->processMessage( m );
+		}
+		_this->m_quit = true;
+
+		return NULL;
+	}
+
+	pthread_t m_messageThreadHandle;
+	pthread_mutex_t m_instanceMutex;
+	// the ID LMMS identifies an instance with in batches and its args
+	std::queue<std::pair<int, std::vector<std::string> > >
+							m_pendingInstances;
+	std::map<int, RemoteZynAddSubFx *> m_instances;
+
+	std::vector<pthread_t> m_workers;
+	pthread_mutex_t m_jobMutex;
+	pthread_cond_t m_jobsAvailable;
+	pthread_cond_t m_jobsFinished;
+	std::vector<Job> m_jobs;
+	size_t m_nextJob;
+	size_t m_jobsDone;
+	bool m_stopWorkers;
+
+	volatile bool m_quit;
+
+} ;
+
+
+
+
+bool RemoteZynAddSubFx::guiIteration()
+{
+	if( m_exitProgram == 1 )
+	{
+		pthread_mutex_lock( &m_master->mutex );
+		sendMessage( IdHideUI );
+		m_exitProgram = 0;
+		pthread_mutex_unlock( &m_master->mutex );
+	}
+	pthread_mutex_lock( &m_guiMutex );
+	while( m_guiMessages.size() )
+	{
+		RemotePluginClient::message m = m_guiMessages.front();
+		m_guiMessages.pop();
+		switch( m.id )
+		{
+			case IdShowUI:
+				// we only create GUI
+				if( !m_ui )
 				{
-					LocalZynAddSubFx::loadXML( m.getString() );
-					if( ui )
-					{
-						ui->refresh_master_ui();
-					}
-					pthread_mutex_lock( &m_master->mutex );
-					sendMessage( IdLoadSettingsFromFile );
-					pthread_mutex_unlock( &m_master->mutex );
-					break;
+					Fl::scheme( "plastic" );
+					m_ui = new MasterUI( m_master, &m_exitProgram );
 				}
+				m_ui->showUI();
+				m_ui->refresh_master_ui();
+				break;
 
-				case IdLoadPresetFile:
+			case IdLoadSettingsFromFile:
+			{
+				LocalZynAddSubFx::loadXML( m.getString() );
+				if( m_ui )
 				{
-					LocalZynAddSubFx::loadPreset( m.getString(), ui ?
-											ui->npartcounter->value()-1 : 0 );
-					if( ui )
-					{
-						ui->npartcounter->do_callback();
-						ui->updatepanel();
-						ui->refresh_master_ui();
-					}
-					pthread_mutex_lock( &m_master->mutex );
-					sendMessage( IdLoadPresetFile );
-					pthread_mutex_unlock( &m_master->mutex );
-					break;
+					m_ui->refresh_master_ui();
 				}
+				pthread_mutex_lock( &m_master->mutex );
+				sendMessage( IdLoadSettingsFromFile );
+				pthread_mutex_unlock( &m_master->mutex );
+				break;
+			}
 
-				default:
-					break;
+			case IdLoadPresetFile:
+			{
+				LocalZynAddSubFx::loadPreset( m.getString(), m_ui ?
+										m_ui->npartcounter->value()-1 : 0 );
+				if( m_ui )
+				{
+					m_ui->npartcounter->do_callback();
+					m_ui->updatepanel();
+					m_ui->refresh_master_ui();
+				}
+				pthread_mutex_lock( &m_master->mutex );
+				sendMessage( IdLoadPresetFile );
+				pthread_mutex_unlock( &m_master->mutex );
+				break;
 			}
+
+			default:
+				break;
 		}
-		pthread_mutex_unlock( &m_guiMutex );
 	}
-	Fl::flush();
+	pthread_mutex_unlock( &m_guiMutex );
 
-	delete ui;
+	return !m_guiExit;
+}
+
+
+
+
+static void guiSleep( bool _haveUI )
+{
+	if( _haveUI )
+	{
+		Fl::wait( GuiSleepTime / 1000.0 );
+	}
+	else
+	{
+#ifdef LMMS_BUILD_WIN32
+		Sleep( GuiSleepTime );
+#else
+		usleep( GuiSleepTime*1000 );
+#endif
+	}
+}
+
+
+
+
+void RemoteZynAddSubFx::guiLoop()
+{
+	while( !m_guiExit )
+	{
+		guiSleep( hasUI() );
+		guiIteration();
+	}
+}
+
+
+
+
+// runs all instances LMMS asks the host for in this process
+static void hostLoop( RemoteZynAddSubFxHost * _host )
+{
+	std::list<RemoteZynAddSubFx *> instances;
+	while( !_host->quit() || !instances.empty() )
+	{
+		bool haveUI = false;
+		for( RemoteZynAddSubFx * instance : instances )
+		{
+			haveUI = haveUI || instance->hasUI();
+		}
+		guiSleep( haveUI );
+
+		_host->createInstances( instances );
+
+		std::list<RemoteZynAddSubFx *>::iterator it = instances.begin();
+		while( it != instances.end() )
+		{
+			if( ( *it )->guiIteration() )
+			{
+				++it;
+			}
+			else
+			{
+				_host->removeInstance( *it );
+				delete *it;
+				it = instances.erase( it );
+			}
+		}
+	}
 }
 
 
@@ -279,15 +666,35 @@ int main( int _argc, char * * _argv )
 
 
 #ifdef SYNC_WITH_SHM_FIFO
-	RemoteZynAddSubFx * remoteZASF =
-		new RemoteZynAddSubFx( atoi( _argv[1] ), atoi( _argv[2] ) );
+	const int firstExtraArg = 3;
+#else
+	const int firstExtraArg = 2;
+#endif
+	if( _argc > firstExtraArg &&
+			strcmp( _argv[firstExtraArg], "--host" ) == 0 )
+	{
+		// LMMS passes the number of threads to render batches with
+		const int workers = _argc > firstExtraArg + 1 ?
+					atoi( _argv[firstExtraArg + 1] ) : 1;
+#ifdef SYNC_WITH_SHM_FIFO
+		RemoteZynAddSubFxHost * host = new RemoteZynAddSubFxHost(
+				atoi( _argv[1] ), atoi( _argv[2] ), workers );
 #else
-	RemoteZynAddSubFx * remoteZASF = new RemoteZynAddSubFx( _argv[1] );
+		RemoteZynAddSubFxHost * host =
+			new RemoteZynAddSubFxHost( _argv[1], workers );
 #endif
+		hostLoop( host );
+		delete host;
+	}
+	else
+	{
+		RemoteZynAddSubFx * remoteZASF =
+					RemoteZynAddSubFx::create( _argv + 1 );
 
-	remoteZASF->guiLoop();
+		remoteZASF->guiLoop();
 
-	delete remoteZASF;
+		delete remoteZASF;
+	}
 
 
 #ifdef LMMS_BUILD_WIN32
@@ -33,6 +33,7 @@
 #include <QPushButton>
 
 #include "ZynAddSubFx.h"
+#include "BufferManager.h"
 #include "ConfigManager.h"
 #include "Engine.h"
 #include "Knob.h"
@@ -73,9 +74,17 @@ Plugin::Descriptor PLUGIN_EXPORT zynaddsubfx_plugin_descriptor =
 
 
 
+// events handleMidiEvent() can queue until play() picks them up
+static const size_t MaxQueuedEvents = 1024;
+
+
+
+
 ZynAddSubFxRemotePlugin::ZynAddSubFxRemotePlugin() :
 	RemotePlugin()
 {
+	// RemoteZynAddSubFx can run several instances in one process
+	setSharedProcess( true );
 	init( "RemoteZynAddSubFx", false );
 }
 
@@ -119,7 +128,8 @@ ZynAddSubFxInstrument::ZynAddSubFxInstrument(
 	m_fmGainModel( 127, 0, 127, 1, this, tr( "FM Gain" ) ),
 	m_resCenterFreqModel( 64, 0, 127, 1, this, tr( "Resonance Center Frequency" ) ),
 	m_resBandwidthModel( 64, 0, 127, 1, this, tr( "Resonance Bandwidth" ) ),
-	m_forwardMidiCcModel( true, this, tr( "Forward MIDI Control Change Events" ) )
+	m_forwardMidiCcModel( true, this, tr( "Forward MIDI Control Change Events" ) ),
+	m_queuedEvents( MaxQueuedEvents )
 {
 	initPlugin();
 
@@ -144,6 +154,9 @@ ZynAddSubFxInstrument::ZynAddSubFxInstrument(
 
 	connect( Engine::mixer(), SIGNAL( sampleRateChanged() ),
 			this, SLOT( reloadPlugin() ) );
+	// ZynAddSubFX sizes its internal buffers when being created
+	connect( Engine::mixer(), SIGNAL( framesPerPeriodChanged() ),
+			this, SLOT( reloadPlugin() ) );
 
 	connect( instrumentTrack()->pitchRangeModel(), SIGNAL( dataChanged() ),
 			this, SLOT( updatePitchRange() ), Qt::DirectConnection );
@@ -256,19 +269,21 @@ void ZynAddSubFxInstrument::loadSettings( const QDomElement & _this )
 		tf.flush();
 
 		const std::string fn = QSTR_TO_STDSTR( QDir::toNativeSeparators( tf.fileName() ) );
-		m_pluginMutex.lock();
 		if( m_remotePlugin )
 		{
+			m_pluginMutex.lock();
 			m_remotePlugin->lock();
 			m_remotePlugin->sendMessage( RemotePlugin::message( IdLoadSettingsFromFile ).addString( fn ) );
 			m_remotePlugin->waitForMessage( IdLoadSettingsFromFile );
 			m_remotePlugin->unlock();
+			m_pluginMutex.unlock();
 		}
 		else
 		{
+			// only blocks the audio thread while applying the
+			// parsed settings
 			m_plugin->loadXML( fn );
 		}
-		m_pluginMutex.unlock();
 
 		m_modifiedControllers.clear();
 		for( const QString & c : _this.attribute( "modifiedcontrollers" ).split( ',' ) )
@@ -313,9 +328,7 @@ void ZynAddSubFxInstrument::loadFile( const QString & _file )
 	}
 	else
 	{
-		m_pluginMutex.lock();
 		m_plugin->loadPreset( fn );
-		m_pluginMutex.unlock();
 	}
 
 	instrumentTrack()->setName( QFileInfo( _file ).baseName().replace( QRegExp( "^[0-9]{4}-" ), QString() ) );
@@ -338,17 +351,38 @@ QString ZynAddSubFxInstrument::nodeName() const
 
 void ZynAddSubFxInstrument::play( sampleFrame * _buf )
 {
-	if (!m_pluginMutex.tryLock(Engine::getSong()->isExporting() ? -1 : 0)) {return;}
-	if( m_remotePlugin )
+	const fpp_t frames = Engine::mixer()->framesPerPeriod();
+	const bool exporting = Engine::getSong()->isExporting();
+	if( !m_pluginMutex.tryLock( exporting ? -1 : 0 ) )
 	{
-		m_remotePlugin->process( NULL, _buf );
+		// the plugin is being replaced - output silence and keep the
+		// events for the next period
+		BufferManager::clear( _buf, frames );
 	}
 	else
 	{
-		m_plugin->processAudio( _buf );
+		if( m_remotePlugin )
+		{
+			processQueuedEvents();
+			m_remotePlugin->process( NULL, _buf );
+		}
+		else if( m_plugin->lockMaster( exporting ) )
+		{
+			processQueuedEvents();
+			m_plugin->processAudio( _buf );
+			m_plugin->unlockMaster();
+		}
+		else
+		{
+			// loadXML()/loadPreset() apply the parsed settings
+			// while holding the master's lock, which can't be
+			// avoided without replacing the Master the UI points
+			// to - output silence and keep the events
+			BufferManager::clear( _buf, frames );
+		}
+		m_pluginMutex.unlock();
 	}
-	m_pluginMutex.unlock();
-	instrumentTrack()->processAudioBuffer( _buf, Engine::mixer()->framesPerPeriod(), NULL );
+	instrumentTrack()->processAudioBuffer( _buf, frames, NULL );
 }
 
 
@@ -367,18 +401,67 @@ bool ZynAddSubFxInstrument::handleMidiEvent( const MidiEvent& event, const MidiT
 
 	MidiEvent localEvent = event;
 	localEvent.setChannel( 0 );
-	m_pluginMutex.lock();
-	if( m_remotePlugin )
+	if( !m_queuedEvents.push( localEvent ) )
 	{
-		m_remotePlugin->processMidiEvent( localEvent, 0 );
+		// the plugin didn't play for a while, so hand over everything
+		// right now while keeping the order of the events - the caller
+		// may be the audio thread, so rather drop the event than wait
+		// for a plugin being reloaded or loading settings
+		if( !m_pluginMutex.tryLock() )
+		{
+			return true;
+		}
+		if( m_remotePlugin || m_plugin->lockMaster( false ) )
+		{
+			processQueuedEvents();
+			if( m_remotePlugin )
+			{
+				m_remotePlugin->processMidiEvent( localEvent, 0 );
+			}
+			else
+			{
+				m_plugin->processMidiEvent( localEvent );
+				m_plugin->unlockMaster();
+			}
+		}
+		m_pluginMutex.unlock();
 	}
-	else
+
+	return true;
+}
+
+
+
+
+void ZynAddSubFxInstrument::processQueuedEvents()
+{
+	typedef LocklessList<MidiEvent>::Element Element;
+
+	// the list has the latest event first
+	Element * first = NULL;
+	for( Element * e = m_queuedEvents.popList(); e; )
 	{
-		m_plugin->processMidiEvent( localEvent );
+		Element * next = e->next;
+		e->next = first;
+		first = e;
+		e = next;
 	}
-	m_pluginMutex.unlock();
 
-	return true;
+	for( Element * e = first; e; )
+	{
+		if( m_remotePlugin )
+		{
+			m_remotePlugin->processMidiEvent( e->value, 0 );
+		}
+		else
+		{
+			m_plugin->processMidiEvent( e->value );
+		}
+
+		Element * next = e->next;
+		m_queuedEvents.free( e );
+		e = next;
+	}
 }
 
 
@@ -31,6 +31,7 @@
 #include "AutomatableModel.h"
 #include "Instrument.h"
 #include "InstrumentView.h"
+#include "LocklessList.h"
 #include "RemotePlugin.h"
 #include "zynaddsubfx/src/globals.h"
 
@@ -105,12 +106,17 @@ private slots:
 private:
 	void initPlugin();
 	void sendControlChange( MidiControllers midiCtl, float value );
+	void processQueuedEvents();
 
 	bool m_hasGUI;
 	QMutex m_pluginMutex;
 	LocalZynAddSubFx * m_plugin;
 	ZynAddSubFxRemotePlugin * m_remotePlugin;
 
+	// MIDI events and controller changes are handed to the plugin by
+	// play() at the start of the next period
+	LocklessList<MidiEvent> m_queuedEvents;
+
 	FloatModel m_portamentoModel;
 	FloatModel m_filterFreqModel;
 	FloatModel m_filterQModel;
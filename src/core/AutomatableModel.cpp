@@ -58,6 +58,8 @@ AutomatableModel::AutomatableModel( DataType type,
 	m_hasSampleExactData( false )
 
 {
+	// the period size may grow at runtime, don't reallocate when rendering
+	m_valueBuffer.reserve( DEFAULT_BUFFER_SIZE );
 	m_value = fittedValue( val );
 	setInitValue( val );
 }
@@ -535,6 +537,13 @@ ValueBuffer * AutomatableModel::valueBuffer()
 			: NULL;
 	}
 
+	// follow period size changes
+	const int frames = Engine::mixer()->framesPerPeriod();
+	if( m_valueBuffer.length() != frames )
+	{
+		m_valueBuffer.resize( frames );
+	}
+
 	float val = m_value; // make sure our m_value doesn't change midway
 
 	ValueBuffer * vb;
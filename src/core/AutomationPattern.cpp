@@ -28,6 +28,7 @@
 
 #include "AutomationPatternView.h"
 #include "AutomationTrack.h"
+#include "DataFile.h"
 #include "LocaleHelper.h"
 #include "Note.h"
 #include "ProjectJournal.h"
@@ -585,6 +586,16 @@ void AutomationPattern::loadSettings( const QDomElement & _this )
 	setTension( _this.attribute( "tens" ) );
 	setMuted(_this.attribute( "mute", QString::number( false ) ).toInt() );
 
+	const QVector<DataFile::StreamedTimePoint> * streamed =
+					DataFile::streamedTimePoints( _this );
+	if( streamed != NULL )
+	{
+		for( const DataFile::StreamedTimePoint & point : *streamed )
+		{
+			m_timeMap[point.pos] = point.value;
+		}
+	}
+
 	for( QDomNode node = _this.firstChild(); !node.isNull();
 						node = node.nextSibling() )
 	{
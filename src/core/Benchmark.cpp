@@ -0,0 +1,252 @@
+/*
+ * Benchmark.cpp - renders synthetic projects and measures the mixer's speed
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "Effect.h"
+#include "EffectChain.h"
+#include "Engine.h"
+#include "InstrumentTrack.h"
+#include "Mixer.h"
+#include "MixerWorkerThread.h"
+#include "Pattern.h"
+#include "PluginFactory.h"
+#include "Song.h"
+
+
+// fixed seed for everything depending on rand() - noise generators,
+// randomized oscillator phases etc.
+static const unsigned int RandomSeed = 0x4c4d4d53;
+
+// periods rendered before measuring, so that all notes have been started
+// and buffers have been allocated
+static const int WarmupPeriods = 32;
+
+
+
+Benchmark::Benchmark( int _tracks, int _voices, const QString & _instrument,
+				const QStringList & _effects, int _periods ) :
+	m_tracks( qMax( _tracks, 1 ) ),
+	m_voices( qMax( _voices, 1 ) ),
+	m_instrument( _instrument ),
+	m_effects( _effects ),
+	m_periods( qMax( _periods, 1 ) )
+{
+}
+
+
+
+
+Benchmark::~Benchmark()
+{
+}
+
+
+
+
+bool Benchmark::createProject()
+{
+	if( pluginFactory->pluginInfo( m_instrument.toUtf8() ).isNull() )
+	{
+		fprintf( stderr, "Instrument plugin \"%s\" not found.\n",
+					m_instrument.toUtf8().constData() );
+		return false;
+	}
+	for( const QString & effect : m_effects )
+	{
+		if( pluginFactory->pluginInfo( effect.toUtf8() ).isNull() )
+		{
+			fprintf( stderr, "Effect plugin \"%s\" not found.\n",
+						effect.toUtf8().constData() );
+			return false;
+		}
+	}
+
+	srand( RandomSeed );
+
+	Song * song = Engine::getSong();
+	Mixer * mixer = Engine::mixer();
+
+	// let all notes last for the whole benchmark plus some spare time, so
+	// that every run measures the same steady state
+	const int noteLength = static_cast<int>( ( WarmupPeriods + m_periods ) *
+				mixer->framesPerPeriod() / Engine::framesPerTick() ) +
+						MidiTime::ticksPerTact();
+
+	for( int t = 0; t < m_tracks; ++t )
+	{
+		InstrumentTrack * it = dynamic_cast<InstrumentTrack *>(
+			Track::create( Track::InstrumentTrack, song ) );
+		it->loadInstrument( m_instrument );
+		it->setName( QString( "Track %1" ).arg( t + 1 ) );
+
+		Pattern * p = dynamic_cast<Pattern *>( it->createTCO( 0 ) );
+		p->movePosition( 0 );
+		for( int v = 0; v < m_voices; ++v )
+		{
+			// spread the chords across the keyboard so that
+			// instruments with key-dependent cost are measured fairly
+			const int key = 36 + ( t * 5 + v * 7 ) % 60;
+			p->addNote( Note( noteLength, 0, key ), false );
+		}
+
+		for( const QString & name : m_effects )
+		{
+			EffectChain * chain = it->audioPort()->effects();
+			Effect * effect = Effect::instantiate( name, chain, NULL );
+			if( effect == NULL )
+			{
+				fprintf( stderr, "Failed to load effect \"%s\".\n",
+							name.toUtf8().constData() );
+				return false;
+			}
+			chain->appendEffect( effect );
+		}
+		it->audioPort()->effects()->setEnabled( !m_effects.isEmpty() );
+	}
+
+	song->updateLength();
+
+	return true;
+}
+
+
+
+
+QByteArray Benchmark::run( QList<int> _threads )
+{
+	Mixer * mixer = Engine::mixer();
+	const int maxThreads = MixerWorkerThread::threadCount();
+
+	if( _threads.isEmpty() )
+	{
+		for( int n = 1; n < maxThreads; n *= 2 )
+		{
+			_threads << n;
+		}
+		_threads << maxThreads;
+	}
+
+	// render in this thread, just like ProjectRenderer does in its own one
+	mixer->stopProcessing();
+
+	QList<Result> results;
+	for( int threads : _threads )
+	{
+		fprintf( stderr, "Benchmarking %d thread(s)...\n",
+						qBound( 1, threads, maxThreads ) );
+		results << runWithThreads( threads );
+	}
+
+	MixerWorkerThread::setActiveThreadCount( maxThreads );
+	mixer->startProcessing();
+
+	QByteArray json = "{\n";
+	json += "\t\"tracks\": " + QByteArray::number( m_tracks ) + ",\n";
+	json += "\t\"voices\": " + QByteArray::number( m_voices ) + ",\n";
+	json += "\t\"instrument\": \"" + m_instrument.toUtf8() + "\",\n";
+	json += "\t\"effects\": [";
+	for( int i = 0; i < m_effects.size(); ++i )
+	{
+		json += ( i ? ", \"" : "\"" ) + m_effects[i].toUtf8() + "\"";
+	}
+	json += "],\n";
+	json += "\t\"sampleRate\": " +
+		QByteArray::number( mixer->processingSampleRate() ) + ",\n";
+	json += "\t\"framesPerPeriod\": " +
+		QByteArray::number( mixer->framesPerPeriod() ) + ",\n";
+	json += "\t\"periods\": " + QByteArray::number( m_periods ) + ",\n";
+	json += "\t\"results\": [\n";
+	for( int i = 0; i < results.size(); ++i )
+	{
+		const Result & r = results[i];
+		json += "\t\t{ \"threads\": " + QByteArray::number( r.threads ) +
+			", \"periodsPerSecond\": " +
+				QByteArray::number( r.periodsPerSecond, 'f', 1 ) +
+			", \"p50\": " + QByteArray::number( r.p50, 'f', 1 ) +
+			", \"p99\": " + QByteArray::number( r.p99, 'f', 1 ) +
+			", \"max\": " + QByteArray::number( r.max, 'f', 1 ) +
+			", \"realtimeFactor\": " +
+				QByteArray::number( r.realtimeFactor, 'f', 2 ) +
+			( i + 1 < results.size() ? " },\n" : " }\n" );
+	}
+	json += "\t]\n}\n";
+
+	return json;
+}
+
+
+
+
+Benchmark::Result Benchmark::runWithThreads( int _threads )
+{
+	typedef std::chrono::steady_clock Clock;
+
+	Song * song = Engine::getSong();
+	Mixer * mixer = Engine::mixer();
+
+	MixerWorkerThread::setActiveThreadCount( _threads );
+
+	srand( RandomSeed );
+	song->startExport();
+
+	for( int i = 0; i < WarmupPeriods; ++i )
+	{
+		mixer->nextBuffer();
+	}
+
+	// period times in microseconds
+	std::vector<double> times( m_periods );
+	const Clock::time_point start = Clock::now();
+	Clock::time_point last = start;
+	for( int i = 0; i < m_periods; ++i )
+	{
+		mixer->nextBuffer();
+		const Clock::time_point now = Clock::now();
+		times[i] = std::chrono::duration<double, std::micro>(
+							now - last ).count();
+		last = now;
+	}
+	const double seconds =
+		std::chrono::duration<double>( last - start ).count();
+
+	song->stopExport();
+
+	std::sort( times.begin(), times.end() );
+
+	const double audioSeconds = static_cast<double>( m_periods ) *
+				mixer->framesPerPeriod() /
+					mixer->processingSampleRate();
+
+	Result r;
+	r.threads = qBound( 1, _threads, MixerWorkerThread::threadCount() );
+	r.periodsPerSecond = seconds > 0 ? m_periods / seconds : 0;
+	r.p50 = times[m_periods / 2];
+	r.p99 = times[qMin( m_periods * 99 / 100, m_periods - 1 )];
+	r.max = times.back();
+	r.realtimeFactor = seconds > 0 ? audioSeconds / seconds : 0;
+	return r;
+}
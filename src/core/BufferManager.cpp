@@ -30,17 +30,11 @@
 #include "Mixer.h"
 #include "MemoryManager.h"
 
-static fpp_t framesPerPeriod;
-
-void BufferManager::init( fpp_t framesPerPeriod )
-{
-	::framesPerPeriod = framesPerPeriod;
-}
-
-
 sampleFrame * BufferManager::acquire()
 {
-	return MM_ALLOC( sampleFrame, ::framesPerPeriod );
+	// buffers are often held across periods, so make them large enough
+	// for any period size the mixer may switch to
+	return MM_ALLOC( sampleFrame, DEFAULT_BUFFER_SIZE );
 }
 
 void BufferManager::clear( sampleFrame *ab, const f_cnt_t frames, const f_cnt_t offset )
@@ -327,6 +327,7 @@ void ConfigManager::addRecentlyOpenedProject( const QString & file )
 	QFileInfo recentFile( file );
 	if( recentFile.suffix().toLower() == "mmp" ||
 		recentFile.suffix().toLower() == "mmpz" ||
+		recentFile.suffix().toLower() == "mmpb" ||
 		recentFile.suffix().toLower() == "mpt" )
 	{
 		m_recentlyOpenedProjects.removeAll( file );
@@ -395,6 +396,7 @@ void ConfigManager::setValue( const QString & cls,
 	}
 	// not in map yet, so we have to add it...
 	m_settings[cls].push_back( qMakePair( attribute, value ) );
+	emit valueChanged( cls, attribute, value );
 }
 
 
@@ -80,6 +80,8 @@ Controller::Controller( ControllerTypes _type, Model * _parent,
 			}
 		}
 	}
+	connect( Engine::mixer(), SIGNAL( framesPerPeriodChanged() ),
+			this, SLOT( updateFramesPerPeriod() ), Qt::DirectConnection );
 	updateValueBuffer();
 }
 
@@ -139,6 +141,14 @@ void Controller::updateValueBuffer()
 }
 
 
+void Controller::updateFramesPerPeriod()
+{
+	m_valueBuffer.resize( Engine::mixer()->framesPerPeriod() );
+	// refill on next access
+	m_bufferLastUpdated = -1;
+}
+
+
 // Get position in frames
 unsigned int Controller::runningFrames()
 {
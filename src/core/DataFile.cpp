@@ -31,16 +31,24 @@
 #include <QDebug>
 #include <QFile>
 #include <QFileInfo>
+#include <QHash>
 #include <QMessageBox>
+#include <QMutex>
+#include <QXmlStreamReader>
 
+#include "AtomicInt.h"
 #include "base64.h"
 #include "ConfigManager.h"
 #include "Effect.h"
 #include "embed.h"
 #include "GuiApplication.h"
 #include "LocaleHelper.h"
+#include "Note.h"
 #include "PluginFactory.h"
+#include "ProjectBundle.h"
 #include "ProjectVersion.h"
+#include "SampleData.h"
+#include "SampleDataCache.h"
 #include "SongEditor.h"
 #include "TextFloat.h"
 
@@ -48,6 +56,11 @@
 
 static void findIds(const QDomElement& elem, QList<jo_id_t>& idList);
 
+// DataFiles whose notes and automation points have been streamed, found
+// through the "streamed" attribute of their root element
+static QMutex s_streamedFilesMutex;
+static QHash<int, const DataFile *> s_streamedFiles;
+
 
 
 
@@ -71,7 +84,9 @@ DataFile::DataFile( Type type ) :
 	QDomDocument( "lmms-project" ),
 	m_content(),
 	m_head(),
-	m_type( type )
+	m_type( type ),
+	m_bundled( false ),
+	m_streamSerial( -1 )
 {
 	appendChild( createProcessingInstruction("xml", "version=\"1.0\""));
 	QDomElement root = createElement( "lmms-project" );
@@ -95,7 +110,9 @@ DataFile::DataFile( Type type ) :
 DataFile::DataFile( const QString & _fileName ) :
 	QDomDocument(),
 	m_content(),
-	m_head()
+	m_head(),
+	m_bundled( false ),
+	m_streamSerial( -1 )
 {
 	QFile inFile( _fileName );
 	if( !inFile.open( QIODevice::ReadOnly ) )
@@ -114,6 +131,13 @@ DataFile::DataFile( const QString & _fileName ) :
 		return;
 	}
 
+	if( ProjectBundle::isBundle( &inFile ) )
+	{
+		inFile.close();
+		loadBundle( _fileName );
+		return;
+	}
+
 	loadData( inFile.readAll(), _fileName );
 }
 
@@ -123,7 +147,9 @@ DataFile::DataFile( const QString & _fileName ) :
 DataFile::DataFile( const QByteArray & _data ) :
 	QDomDocument(),
 	m_content(),
-	m_head()
+	m_head(),
+	m_bundled( false ),
+	m_streamSerial( -1 )
 {
 	loadData( _data, "<internal data>" );
 }
@@ -133,6 +159,15 @@ DataFile::DataFile( const QByteArray & _data ) :
 
 DataFile::~DataFile()
 {
+	if( m_streamSerial >= 0 )
+	{
+		QMutexLocker lock( &s_streamedFilesMutex );
+		s_streamedFiles.remove( m_streamSerial );
+	}
+	for( SampleData * sampleData : m_sampleData )
+	{
+		sharedObject::unref( sampleData );
+	}
 }
 
 
@@ -143,7 +178,8 @@ bool DataFile::validate( QString extension )
 	switch( m_type )
 	{
 	case Type::SongProject:
-		if( extension == "mmp" || extension == "mmpz" )
+		if( extension == "mmp" || extension == "mmpz" ||
+					extension == ProjectBundle::Extension )
 		{
 			return true;
 		}
@@ -162,6 +198,7 @@ bool DataFile::validate( QString extension )
 		break;
 	case Type::UnknownType:
 		if (! ( extension == "mmp" || extension == "mpt" || extension == "mmpz" ||
+				extension == ProjectBundle::Extension ||
 				extension == "xpf" || extension == "xml" ||
 				( extension == "xiz" && ! pluginFactory->pluginSupportingExtension(extension).isNull()) ||
 				extension == "sf2" || extension == "pat" || extension == "mid" ||
@@ -192,7 +229,8 @@ QString DataFile::nameWithExtension( const QString & _fn ) const
 		case SongProject:
 			if( _fn.section( '.', -1 ) != "mmp" &&
 					_fn.section( '.', -1 ) != "mpt" &&
-					_fn.section( '.', -1 ) != "mmpz" )
+					_fn.section( '.', -1 ) != "mmpz" &&
+					!ProjectBundle::isBundleName( _fn ) )
 			{
 				if( ConfigManager::inst()->value( "app",
 						"nommpz" ).toInt() == 0 )
@@ -258,7 +296,20 @@ bool DataFile::writeFile( const QString& filename )
 		return false;
 	}
 
-	if( fullName.section( '.', -1 ) == "mmpz" )
+	if( ProjectBundle::isBundleName( fullName ) )
+	{
+		QString xml;
+		QTextStream ts( &xml );
+		write( ts );
+		if( !ProjectBundle::write( outfile, xml.toUtf8(), m_sampleData ) )
+		{
+			qWarning() << "Could not write" << outfile.fileName();
+			outfile.close();
+			QFile::remove( fullNameTemp );
+			return false;
+		}
+	}
+	else if( fullName.section( '.', -1 ) == "mmpz" )
 	{
 		QString xml;
 		QTextStream ts( &xml );
@@ -300,6 +351,45 @@ bool DataFile::writeFile( const QString& filename )
 
 
 
+static QString bundleKey( const QString & _bundle, const QString & _ref )
+{
+	return "bundle:" + _bundle + ":" + _ref;
+}
+
+
+
+
+QString DataFile::addSampleData( SampleData * _data )
+{
+	// SampleBuffers sharing their data share the entry as well
+	int index = m_sampleData.indexOf( _data );
+	if( index < 0 )
+	{
+		m_sampleData << sharedObject::ref( _data );
+		index = m_sampleData.size() - 1;
+	}
+	// entry 0 is the XML
+	return QString::number( index + 1 );
+}
+
+
+
+
+SampleData * DataFile::sampleData( const QDomElement & _element,
+							const QString & _ref )
+{
+	const QString bundle = _element.ownerDocument().documentElement().
+							attribute( "bundle" );
+	if( bundle.isEmpty() )
+	{
+		return NULL;
+	}
+	return SampleDataCache::acquire( bundleKey( bundle, _ref ) );
+}
+
+
+
+
 DataFile::Type DataFile::type( const QString& typeName )
 {
 	for( int i = 0; i < TypeCount; ++i )
@@ -1049,7 +1139,10 @@ void DataFile::loadData( const QByteArray & _data, const QString & _sourceFile )
 {
 	QString errorMsg;
 	int line = -1, col = -1;
-	if( !setContent( _data, &errorMsg, &line, &col ) )
+	// projects are streamed, which keeps their notes and automation points
+	// out of the DOM - everything else still goes through the DOM parser
+	if( !loadStreamed( _data ) &&
+			!setContent( _data, &errorMsg, &line, &col ) )
 	{
 		// parsing failed? then try to uncompress data
 		QByteArray uncompressed = qUncompress( _data );
@@ -1127,6 +1220,314 @@ void DataFile::loadData( const QByteArray & _data, const QString & _sourceFile )
 }
 
 
+
+
+void DataFile::loadBundle( const QString & _fileName )
+{
+	// every bundle loaded gets its own keys in the SampleDataCache, which
+	// sampleData() finds through the "bundle" attribute
+	static AtomicInt s_bundles;
+
+	QByteArray xml;
+	QList<SampleData *> samples;
+	ProjectBundle::read( _fileName, xml, samples );
+	loadData( xml, _fileName );
+
+	const QString bundle = QString::number(
+					s_bundles.fetchAndAddOrdered( 1 ) );
+	documentElement().setAttribute( "bundle", bundle );
+	for( int i = 0; i < samples.size(); ++i )
+	{
+		m_sampleData << SampleDataCache::insert( bundleKey( bundle,
+				QString::number( i + 1 ) ), samples[i] );
+	}
+}
+
+
+bool DataFile::loadStreamed( const QByteArray & _data )
+{
+	// .mmpz files are compressed XML
+	int start = 0;
+	while( start < _data.size() && QChar( _data[start] ).isSpace() )
+	{
+		++start;
+	}
+	const QByteArray xml = start < _data.size() && _data[start] != '<' ?
+						qUncompress( _data ) : _data;
+
+	QXmlStreamReader reader( xml );
+	QDomNode parent;
+	// files older than that have their positions scaled by upgrade()
+	bool scalePositions = false;
+
+	// notes and points are only known to have no children once their end
+	// is read, until then they are pending
+	enum PendingTypes
+	{
+		NothingPending,
+		NotePending,
+		TimePointPending
+	} pending = NothingPending;
+	QString pendingName;
+	QXmlStreamAttributes pendingAttributes;
+
+	// the element the last pending note or point belonged to
+	QDomNode owner;
+	int ownerIndex = -1;
+
+	while( !reader.atEnd() )
+	{
+		const QXmlStreamReader::TokenType token = reader.readNext();
+
+		if( pending != NothingPending )
+		{
+			if( token == QXmlStreamReader::Characters &&
+							reader.isWhitespace() )
+			{
+				continue;
+			}
+			if( token == QXmlStreamReader::EndElement &&
+							pending == NotePending )
+			{
+				const QXmlStreamAttributes & a = pendingAttributes;
+				StreamedNote note;
+				note.key = qMax( a.value( "tone" ).toString().toInt() +
+					a.value( "oct" ).toString().toInt() *
+								KeysPerOctave,
+					a.value( "key" ).toString().toInt() );
+				note.volume = a.value( "vol" ).toString().toInt();
+				note.panning = a.value( "pan" ).toString().toInt();
+				note.length = a.value( "len" ).toString().toInt();
+				note.pos = a.value( "pos" ).toString().toInt();
+				note.inDom = false;
+				if( scalePositions )
+				{
+					note.length *= 3;
+					note.pos *= 3;
+				}
+				m_streamedNotes[ownerIndex] << note;
+				pending = NothingPending;
+				continue;
+			}
+			if( token == QXmlStreamReader::EndElement )
+			{
+				StreamedTimePoint point;
+				point.pos = pendingAttributes.value( "pos" ).
+							toString().toInt();
+				point.value = LocaleHelper::toFloat(
+					pendingAttributes.value( "value" ).
+								toString() );
+				if( scalePositions )
+				{
+					point.pos *= 3;
+				}
+				m_streamedTimePoints[ownerIndex] << point;
+				pending = NothingPending;
+				continue;
+			}
+
+			// it has contents, so keep it in the DOM
+			QDomElement element = createElement( pendingName );
+			for( const QXmlStreamAttribute & a : pendingAttributes )
+			{
+				element.setAttribute( a.qualifiedName().toString(),
+							a.value().toString() );
+			}
+			parent.appendChild( element );
+			parent = element;
+			if( pending == NotePending )
+			{
+				StreamedNote note = { 0, 0, 0, 0, 0, true };
+				m_streamedNotes[ownerIndex] << note;
+			}
+			else
+			{
+				// AutomationPattern::loadSettings() doesn't
+				// expect points in both places
+				reader.raiseError( "time point with children" );
+			}
+			pending = NothingPending;
+		}
+
+		switch( token )
+		{
+		case QXmlStreamReader::StartDocument:
+			// start from scratch, this also creates the
+			// document if it has been null
+			static_cast<QDomDocument &>( *this ) =
+					QDomDocument( "lmms-project" );
+			appendChild( createProcessingInstruction( "xml",
+					"version=\"1.0\"" ) );
+			parent = *this;
+			break;
+
+		case QXmlStreamReader::StartElement:
+		{
+			const QString name = reader.name().toString();
+			const QXmlStreamAttributes attributes =
+						reader.attributes();
+			if( parent.isDocument() )
+			{
+				// the DOM works just as well for
+				// everything but projects
+				const Type t = type( attributes.value(
+					"type" ).toString() );
+				if( t != SongProject &&
+					t != SongProjectTemplate )
+				{
+					return false;
+				}
+				ProjectVersion version = attributes.value(
+					"creatorversion" ).toString().
+						replace( "svn", "" );
+				scalePositions = attributes.hasAttribute(
+						"creatorversion" ) &&
+					version < "0.4.0-20080409";
+			}
+
+			const QString parentName = parent.nodeName();
+			if( ( name == "note" && parentName == "pattern" &&
+				!attributes.hasAttribute( "metadata" ) ) ||
+				( name == "time" &&
+				parentName == "automationpattern" ) )
+			{
+				pending = name == "note" ? NotePending :
+						TimePointPending;
+				pendingName = name;
+				pendingAttributes = attributes;
+				if( parent != owner )
+				{
+					owner = parent;
+					QDomElement o = owner.toElement();
+					if( pending == NotePending )
+					{
+						ownerIndex = m_streamedNotes.size();
+						m_streamedNotes.resize( ownerIndex + 1 );
+						o.setAttribute( "streamednotes",
+							ownerIndex );
+					}
+					else
+					{
+						ownerIndex = m_streamedTimePoints.size();
+						m_streamedTimePoints.resize( ownerIndex + 1 );
+						o.setAttribute( "streamedpoints",
+							ownerIndex );
+					}
+				}
+				break;
+			}
+
+			QDomElement element = createElement( name );
+			for( const QXmlStreamAttribute & a : attributes )
+			{
+				element.setAttribute(
+					a.qualifiedName().toString(),
+						a.value().toString() );
+			}
+			parent.appendChild( element );
+			parent = element;
+			break;
+		}
+
+		case QXmlStreamReader::EndElement:
+			parent = parent.parentNode();
+			break;
+
+		case QXmlStreamReader::Characters:
+			if( reader.isCDATA() )
+			{
+				parent.appendChild( createCDATASection(
+					reader.text().toString() ) );
+			}
+			else if( !reader.isWhitespace() )
+			{
+				parent.appendChild( createTextNode(
+					reader.text().toString() ) );
+			}
+			break;
+
+		case QXmlStreamReader::Comment:
+			parent.appendChild( createComment(
+					reader.text().toString() ) );
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	if( reader.hasError() )
+	{
+		m_streamedNotes.clear();
+		m_streamedTimePoints.clear();
+		return false;
+	}
+
+	if( !m_streamedNotes.isEmpty() || !m_streamedTimePoints.isEmpty() )
+	{
+		static AtomicInt s_serials;
+		m_streamSerial = s_serials.fetchAndAddOrdered( 1 );
+		documentElement().setAttribute( "streamed", m_streamSerial );
+
+		QMutexLocker lock( &s_streamedFilesMutex );
+		s_streamedFiles[m_streamSerial] = this;
+	}
+	return true;
+}
+
+
+
+
+const DataFile * DataFile::streamedFile( const QDomElement & _element )
+{
+	bool ok;
+	const int serial = _element.ownerDocument().documentElement().
+					attribute( "streamed" ).toInt( &ok );
+	if( !ok )
+	{
+		return NULL;
+	}
+	QMutexLocker lock( &s_streamedFilesMutex );
+	return s_streamedFiles.value( serial, NULL );
+}
+
+
+
+
+const QVector<DataFile::StreamedNote> * DataFile::streamedNotes(
+						const QDomElement & _element )
+{
+	bool ok;
+	const int index = _element.attribute( "streamednotes" ).toInt( &ok );
+	const DataFile * file = ok ? streamedFile( _element ) : NULL;
+	if( file == NULL || index < 0 ||
+				index >= file->m_streamedNotes.size() )
+	{
+		return NULL;
+	}
+	return &file->m_streamedNotes[index];
+}
+
+
+
+
+const QVector<DataFile::StreamedTimePoint> * DataFile::streamedTimePoints(
+						const QDomElement & _element )
+{
+	bool ok;
+	const int index = _element.attribute( "streamedpoints" ).toInt( &ok );
+	const DataFile * file = ok ? streamedFile( _element ) : NULL;
+	if( file == NULL || index < 0 ||
+				index >= file->m_streamedTimePoints.size() )
+	{
+		return NULL;
+	}
+	return &file->m_streamedTimePoints[index];
+}
+
+
+
+
 void findIds(const QDomElement& elem, QList<jo_id_t>& idList)
 {
 	if(elem.hasAttribute("id"))
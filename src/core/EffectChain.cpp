@@ -29,6 +29,7 @@
 #include "EffectChain.h"
 #include "Effect.h"
 #include "DummyEffect.h"
+#include "MixerProfiler.h"
 #include "MixHelpers.h"
 #include "Song.h"
 
@@ -210,6 +211,7 @@ bool EffectChain::processAudioBuffer( sampleFrame * _buf, const fpp_t _frames, b
 	{
 		if( hasInputNoise || ( *it )->isRunning() )
 		{
+			MixerProfiler::Scope profilerScope( MixerProfiler::EffectJob, *it );
 			moreEffects |= ( *it )->processAudioBuffer( _buf, _frames );
 			MixHelpers::sanitize( _buf, _frames );
 		}
@@ -160,8 +160,8 @@ EnvelopeAndLfoParameters::EnvelopeAndLfoParameters(
 				this, SLOT( updateSampleVars() ) );
 
 
-	m_lfoShapeData =
-		new sample_t[Engine::mixer()->framesPerPeriod()];
+	// sized for the largest period so it survives period size changes
+	m_lfoShapeData = new sample_t[DEFAULT_BUFFER_SIZE];
 
 	updateSampleVars();
 }
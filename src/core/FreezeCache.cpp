@@ -0,0 +1,271 @@
+/*
+ * FreezeCache.cpp - memory-mapped audio cache holding the rendered output of
+ *                   a frozen track
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <cstring>
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QDomDocument>
+#include <QTemporaryFile>
+
+#include "FreezeCache.h"
+
+
+FreezeCache::FreezeCache() :
+	m_file( NULL ),
+	m_data( NULL ),
+	m_frames( 0 ),
+	m_writePos( 0 ),
+	m_readPos( 0 ),
+	m_sampleRate( 0 )
+{
+}
+
+
+
+
+FreezeCache::~FreezeCache()
+{
+	release();
+}
+
+
+
+
+bool FreezeCache::allocate( f_cnt_t _frames, sample_rate_t _sampleRate,
+					const QByteArray & _stateHash,
+					const QString & _fileName )
+{
+	release();
+
+	if( _frames <= 0 )
+	{
+		return false;
+	}
+
+	bool opened;
+	if( _fileName.isEmpty() )
+	{
+		QTemporaryFile * tmp = new QTemporaryFile(
+				QDir::tempPath() + "/lmms-freeze-XXXXXX" );
+		opened = tmp->open();
+		m_file = tmp;
+	}
+	else
+	{
+		m_file = new QFile( _fileName );
+		opened = m_file->open( QIODevice::ReadWrite |
+						QIODevice::Truncate );
+	}
+
+	const qint64 size = (qint64) _frames * sizeof( sampleFrame );
+	// resize() creates a sparse file, so all frames read as silence until
+	// the freeze render has written them
+	if( opened == false || m_file->resize( size ) == false )
+	{
+		fprintf( stderr, "FreezeCache: could not create cache file\n" );
+		release();
+		return false;
+	}
+
+	m_data = (sampleFrame *) m_file->map( 0, size );
+	if( m_data == NULL )
+	{
+		fprintf( stderr, "FreezeCache: could not map cache file\n" );
+		release();
+		return false;
+	}
+
+	m_frames = _frames;
+	m_writePos = 0;
+	m_readPos = 0;
+	m_sampleRate = _sampleRate;
+	m_stateHash = _stateHash;
+
+	return true;
+}
+
+
+
+
+bool FreezeCache::load( const QString & _fileName, sample_rate_t _sampleRate,
+						const QByteArray & _stateHash )
+{
+	release();
+
+	m_file = new QFile( _fileName );
+	const qint64 size = m_file->size();
+	if( m_file->open( QIODevice::ReadOnly ) == false ||
+					size < (qint64) sizeof( sampleFrame ) )
+	{
+		release();
+		return false;
+	}
+
+	m_data = (sampleFrame *) m_file->map( 0, size );
+	if( m_data == NULL )
+	{
+		fprintf( stderr, "FreezeCache: could not map %s\n",
+					_fileName.toUtf8().constData() );
+		release();
+		return false;
+	}
+
+	m_frames = size / sizeof( sampleFrame );
+	m_writePos = m_frames;
+	m_readPos = 0;
+	m_sampleRate = _sampleRate;
+	m_stateHash = _stateHash;
+
+	return true;
+}
+
+
+
+
+void FreezeCache::write( const sampleFrame * _src, const fpp_t _frames )
+{
+	if( m_data == NULL || m_writePos >= m_frames )
+	{
+		return;
+	}
+	const f_cnt_t todo = qMin<f_cnt_t>( _frames, m_frames - m_writePos );
+	memcpy( m_data + m_writePos, _src, todo * sizeof( sampleFrame ) );
+	m_writePos += todo;
+}
+
+
+
+
+void FreezeCache::markTick( tick_t _tick, f_cnt_t _offset )
+{
+	if( _tick < 0 )
+	{
+		return;
+	}
+	if( _tick >= m_tickFrames.size() )
+	{
+		const int rendered = m_tickFrames.size();
+		m_tickFrames.resize( _tick + 1 );
+		for( int t = rendered; t <= _tick; ++t )
+		{
+			m_tickFrames[t] = -1;
+		}
+	}
+	// the song is rendered once from start to end, keep the first visit
+	if( m_tickFrames[_tick] < 0 )
+	{
+		m_tickFrames[_tick] = m_writePos + _offset;
+	}
+}
+
+
+
+
+f_cnt_t FreezeCache::tickFrame( tick_t _tick, float _framesPerTick ) const
+{
+	if( _tick >= 0 && _tick < m_tickFrames.size() &&
+						m_tickFrames[_tick] >= 0 )
+	{
+		return m_tickFrames[_tick];
+	}
+
+	// continue from the closest tick rendered before
+	for( tick_t t = qMin<tick_t>( _tick, m_tickFrames.size() ) - 1;
+								t >= 0; --t )
+	{
+		if( m_tickFrames[t] >= 0 )
+		{
+			return m_tickFrames[t] + static_cast<f_cnt_t>(
+					( _tick - t ) * _framesPerTick );
+		}
+	}
+	return static_cast<f_cnt_t>( _tick * _framesPerTick );
+}
+
+
+
+
+void FreezeCache::read( f_cnt_t _pos, sampleFrame * _dst,
+						const fpp_t _frames ) const
+{
+	f_cnt_t done = 0;
+	if( _pos < 0 )
+	{
+		done = qMin<f_cnt_t>( -_pos, _frames );
+		memset( _dst, 0, done * sizeof( sampleFrame ) );
+		_pos = 0;
+	}
+
+	if( m_data != NULL && _pos < m_frames && done < _frames )
+	{
+		const f_cnt_t todo = qMin<f_cnt_t>( _frames - done,
+							m_frames - _pos );
+		memcpy( _dst + done, m_data + _pos,
+						todo * sizeof( sampleFrame ) );
+		done += todo;
+	}
+
+	if( done < _frames )
+	{
+		memset( _dst + done, 0, ( _frames - done ) * sizeof( sampleFrame ) );
+	}
+}
+
+
+
+
+QByteArray FreezeCache::hashState( QDomDocument & _doc )
+{
+	QDomNodeList journalNodes = _doc.elementsByTagName( "journallingObject" );
+	for( int i = journalNodes.count() - 1; i >= 0; --i )
+	{
+		QDomNode node = journalNodes.item( i );
+		node.parentNode().removeChild( node );
+	}
+
+	return QCryptographicHash::hash( _doc.toByteArray(),
+						QCryptographicHash::Sha1 );
+}
+
+
+
+
+void FreezeCache::release()
+{
+	if( m_file != NULL )
+	{
+		if( m_data != NULL )
+		{
+			m_file->unmap( (uchar *) m_data );
+		}
+		// QTemporaryFile removes the backing file on destruction
+		delete m_file;
+	}
+	m_file = NULL;
+	m_data = NULL;
+	m_frames = 0;
+	m_writePos = 0;
+	m_readPos = 0;
+	m_tickFrames.clear();
+}
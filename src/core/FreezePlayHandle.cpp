@@ -0,0 +1,118 @@
+/*
+ * FreezePlayHandle.cpp - play-handle streaming the cached output of a frozen
+ *                        instrument track
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "FreezePlayHandle.h"
+#include "Engine.h"
+#include "FreezeCache.h"
+#include "InstrumentTrack.h"
+#include "Mixer.h"
+
+
+FreezePlayHandle::FreezePlayHandle( InstrumentTrack * _track,
+							FreezeCache * _cache ) :
+	PlayHandle( TypeSamplePlayHandle ),
+	m_track( _track ),
+	m_cache( sharedObject::ref( _cache ) ),
+	m_position( _cache->frames() ),
+	m_numSeekPoints( 0 )
+{
+	setAudioPort( _track->audioPort() );
+}
+
+
+
+
+FreezePlayHandle::~FreezePlayHandle()
+{
+	m_track->freezePlayHandleDeleted( this );
+	sharedObject::unref( m_cache );
+}
+
+
+
+
+void FreezePlayHandle::seek( f_cnt_t _offset, f_cnt_t _cacheFrame )
+{
+	if( m_numSeekPoints < MaxSeekPoints )
+	{
+		m_seekPoints[m_numSeekPoints].offset = _offset;
+		m_seekPoints[m_numSeekPoints].frame = _cacheFrame;
+		++m_numSeekPoints;
+		return;
+	}
+
+	// out of seek points - let the last one lead to where this one goes,
+	// so that at least everything from here on plays at the right position
+	SeekPoint & last = m_seekPoints[MaxSeekPoints - 1];
+	last.frame = _cacheFrame - qMax<f_cnt_t>( _offset - last.offset, 0 );
+}
+
+
+
+
+void FreezePlayHandle::play( sampleFrame * _working_buffer )
+{
+	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+
+	// play linearly from the last known position and restart at every
+	// seek point, which also takes care of loops and jumps
+	f_cnt_t done = 0;
+	f_cnt_t pos = m_position;
+	for( int i = 0; i < m_numSeekPoints; ++i )
+	{
+		const f_cnt_t offset = qBound<f_cnt_t>( done,
+						m_seekPoints[i].offset, fpp );
+		if( offset > done )
+		{
+			m_cache->read( pos, _working_buffer + done, offset - done );
+			pos += offset - done;
+			done = offset;
+		}
+		pos = m_seekPoints[i].frame;
+	}
+	m_numSeekPoints = 0;
+
+	if( done < fpp )
+	{
+		m_cache->read( pos, _working_buffer + done, fpp - done );
+		pos += fpp - done;
+	}
+
+	m_position = pos;
+}
+
+
+
+
+bool FreezePlayHandle::isFinished() const
+{
+	return m_numSeekPoints == 0 && m_position >= m_cache->frames();
+}
+
+
+
+
+bool FreezePlayHandle::isFromTrack( const Track * _track ) const
+{
+	return m_track == _track;
+}
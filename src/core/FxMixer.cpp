@@ -27,9 +27,11 @@
 #include "BufferManager.h"
 #include "FxMixer.h"
 #include "Mixer.h"
+#include "MixerProfiler.h"
 #include "MixerWorkerThread.h"
 #include "MixHelpers.h"
 #include "Song.h"
+#include "FreezeCache.h"
 
 #include "InstrumentTrack.h"
 #include "BBTrackContainer.h"
@@ -63,7 +65,7 @@ FxChannel::FxChannel( int idx, Model * _parent ) :
 	m_stillRunning( false ),
 	m_peakLeft( 0.0f ),
 	m_peakRight( 0.0f ),
-	m_buffer( new sampleFrame[Engine::mixer()->framesPerPeriod()] ),
+	m_buffer( new sampleFrame[DEFAULT_BUFFER_SIZE] ),
 	m_muteModel( false, _parent ),
 	m_soloModel( false, _parent ),
 	m_volumeModel( 1.0, 0.0, 2.0, 0.001, _parent ),
@@ -71,6 +73,9 @@ FxChannel::FxChannel( int idx, Model * _parent ) :
 	m_lock(),
 	m_channelIndex( idx ),
 	m_queued( false ),
+	m_cachedOutput( NULL ),
+	m_outputCapture( NULL ),
+	m_skipped( false ),
 	m_dependenciesMet( 0 )
 {
 	BufferManager::clear( m_buffer, Engine::mixer()->framesPerPeriod() );
@@ -116,9 +121,25 @@ void FxChannel::unmuteForSolo()
 
 void FxChannel::doProcessing()
 {
+	MixerProfiler::Scope profilerScope( MixerProfiler::FxChannelJob, this );
+
 	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
 
-	if( m_muted == false )
+	if( m_muted == false && m_cachedOutput )
+	{
+		// the cache already holds what the block below would compute
+		m_cachedOutput->readNext( m_buffer, fpp );
+		m_hasInput = true;
+		m_stillRunning = false;
+
+		const float v = m_volumeModel.value();
+		float peakLeft = 0.;
+		float peakRight = 0.;
+		Engine::mixer()->getPeakValues( m_buffer, fpp, peakLeft, peakRight );
+		m_peakLeft = qMax( m_peakLeft, peakLeft * v );
+		m_peakRight = qMax( m_peakRight, peakRight * v );
+	}
+	else if( m_muted == false )
 	{
 		for( FxRoute * senderRoute : m_receives )
 		{
@@ -170,6 +191,11 @@ void FxChannel::doProcessing()
 
 		m_stillRunning = m_fxChain.processAudioBuffer( m_buffer, fpp, m_hasInput );
 
+		if( m_outputCapture )
+		{
+			m_outputCapture->write( m_buffer, fpp );
+		}
+
 		float peakLeft = 0.;
 		float peakRight = 0.;
 		Engine::mixer()->getPeakValues( m_buffer, fpp, peakLeft, peakRight );
@@ -577,7 +603,7 @@ void FxMixer::masterMix( sampleFrame * _buf )
 	MixerWorkerThread::resetJobQueue( MixerWorkerThread::JobQueue::Dynamic );
 	for( FxChannel * ch : m_fxChannels )
 	{
-		ch->m_muted = ch->m_muteModel.value();
+		ch->m_muted = ch->m_muteModel.value() || ch->m_skipped;
 		if( ch->m_muted ) // instantly "process" muted channels
 		{
 			ch->processed();
@@ -25,12 +25,28 @@
 #include "Instrument.h"
 #include "InstrumentTrack.h"
 #include "DummyInstrument.h"
+#include "LocklessList.h"
+#include "MidiEvent.h"
+
+
+struct Instrument::QueuedMidiEvent
+{
+	MidiEvent event;
+	f_cnt_t offset;
+} ;
+
+
+// events queueMidiEvent() can hold until the next renderSplitAtEvents()
+static const size_t MaxQueuedMidiEvents = 1024;
+
+
 
 
 Instrument::Instrument( InstrumentTrack * _instrument_track,
 					const Descriptor * _descriptor ) :
 	Plugin( _descriptor, NULL/* _instrument_track*/ ),
-	m_instrumentTrack( _instrument_track )
+	m_instrumentTrack( _instrument_track ),
+	m_midiEventQueue( NULL )
 {
 }
 
@@ -39,6 +55,11 @@ Instrument::Instrument( InstrumentTrack * _instrument_track,
 
 Instrument::~Instrument()
 {
+#if QT_VERSION >= 0x050000
+	delete m_midiEventQueue.loadAcquire();
+#else
+	delete m_midiEventQueue;
+#endif
 }
 
 
@@ -118,6 +139,94 @@ void Instrument::applyRelease( sampleFrame * buf, const NotePlayHandle * _n )
 
 
 
+bool Instrument::queueMidiEvent( const MidiEvent & _event,
+							f_cnt_t _offset )
+{
+#if QT_VERSION >= 0x050000
+	MidiEventQueue * queue = m_midiEventQueue.loadAcquire();
+#else
+	MidiEventQueue * queue = m_midiEventQueue;
+#endif
+	if( queue == NULL )
+	{
+		// events may come in from several threads at once, so only
+		// keep the queue of whoever got here first
+		queue = new MidiEventQueue( MaxQueuedMidiEvents );
+		if( !m_midiEventQueue.testAndSetOrdered( NULL, queue ) )
+		{
+			delete queue;
+#if QT_VERSION >= 0x050000
+			queue = m_midiEventQueue.loadAcquire();
+#else
+			queue = m_midiEventQueue;
+#endif
+		}
+	}
+
+	QueuedMidiEvent queued;
+	queued.event = _event;
+	queued.offset = _offset;
+	return queue->push( queued );
+}
+
+
+
+
+void Instrument::renderSplitAtEvents( sampleFrame * _buf, const fpp_t _frames )
+{
+	typedef MidiEventQueue::Element Element;
+
+#if QT_VERSION >= 0x050000
+	MidiEventQueue * queue = m_midiEventQueue.loadAcquire();
+#else
+	MidiEventQueue * queue = m_midiEventQueue;
+#endif
+
+	// sort the events by their offset - the list has the latest event
+	// first, so inserting each one in front of those with the same offset
+	// keeps such events in the order they came in
+	Element * first = NULL;
+	for( Element * e = queue ? queue->popList() : NULL; e; )
+	{
+		Element * next = e->next;
+		Element ** pos = &first;
+		while( *pos && ( *pos )->value.offset < e->value.offset )
+		{
+			pos = &( *pos )->next;
+		}
+		e->next = *pos;
+		*pos = e;
+		e = next;
+	}
+
+	fpp_t frame = 0;
+	for( Element * e = first; e; )
+	{
+		// events queued for a longer period than this one are
+		// applied at its end
+		const fpp_t offset = (fpp_t) qMin<f_cnt_t>( e->value.offset,
+								_frames );
+		if( offset > frame )
+		{
+			renderFrames( _buf + frame, offset - frame );
+			frame = offset;
+		}
+		processQueuedMidiEvent( e->value.event );
+
+		Element * next = e->next;
+		queue->free( e );
+		e = next;
+	}
+
+	if( frame < _frames )
+	{
+		renderFrames( _buf + frame, _frames - frame );
+	}
+}
+
+
+
+
 QString Instrument::fullDisplayName() const
 {
 	return instrumentTrack()->displayName();
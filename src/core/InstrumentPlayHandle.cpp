@@ -32,3 +32,11 @@ InstrumentPlayHandle::InstrumentPlayHandle( Instrument * instrument, InstrumentT
 {
 	setAudioPort( instrumentTrack->audioPort() );
 }
+
+
+
+
+bool InstrumentPlayHandle::requiresProcessing() const
+{
+	return !m_instrument->instrumentTrack()->isFrozen();
+}
@@ -26,7 +26,12 @@
 
 #include <cstdio>
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include "lmms_math.h"
+#include "Mixer.h"
 #include "ValueBuffer.h"
 
 
@@ -322,5 +327,45 @@ void multiplyAndAddMultipliedJoined( sampleFrame* dst,
 	run<>( dst, srcLeft, srcRight, frames, MultiplyAndAddMultipliedOp(coeffDst, coeffSrc) );
 }
 
+
+
+
+void convertToS16( int_sample_t* dst, const sample_t* src, float gain, int samples, bool swapBytes )
+{
+	int i = 0;
+
+#ifdef __SSE2__
+	// same results as the scalar loop: silence NaNs, clip, scale and
+	// truncate - packing saturates, which doesn't matter as everything is
+	// in range already
+	const __m128 vgain = _mm_set1_ps( gain );
+	const __m128 vmin = _mm_set1_ps( -1.0f );
+	const __m128 vmax = _mm_set1_ps( 1.0f );
+	const __m128 vscale = _mm_set1_ps( OUTPUT_SAMPLE_MULTIPLIER );
+	for( ; i + 8 <= samples; i += 8 )
+	{
+		__m128 lo = _mm_mul_ps( _mm_loadu_ps( src + i ), vgain );
+		__m128 hi = _mm_mul_ps( _mm_loadu_ps( src + i + 4 ), vgain );
+		lo = _mm_and_ps( lo, _mm_cmpord_ps( lo, lo ) );
+		hi = _mm_and_ps( hi, _mm_cmpord_ps( hi, hi ) );
+		lo = _mm_mul_ps( _mm_min_ps( _mm_max_ps( lo, vmin ), vmax ), vscale );
+		hi = _mm_mul_ps( _mm_min_ps( _mm_max_ps( hi, vmin ), vmax ), vscale );
+		__m128i out = _mm_packs_epi32( _mm_cvttps_epi32( lo ), _mm_cvttps_epi32( hi ) );
+		if( swapBytes )
+		{
+			out = _mm_or_si128( _mm_slli_epi16( out, 8 ), _mm_srli_epi16( out, 8 ) );
+		}
+		_mm_storeu_si128( (__m128i *)( dst + i ), out );
+	}
+#endif
+
+	for( ; i < samples; ++i )
+	{
+		const float v = src[i] * gain;
+		const int_sample_t s = static_cast<int_sample_t>( Mixer::clip( v == v ? v : 0.0f ) * OUTPUT_SAMPLE_MULTIPLIER );
+		dst[i] = swapBytes ? ( ( s & 0x00ff ) << 8 | ( s & 0xff00 ) >> 8 ) : s;
+	}
+}
+
 }
 
@@ -31,6 +31,7 @@
 #include "AudioPort.h"
 #include "FxMixer.h"
 #include "MixerWorkerThread.h"
+#include "RemotePlugin.h"
 #include "Song.h"
 #include "EnvelopeAndLfoParameters.h"
 #include "NotePlayHandle.h"
@@ -91,7 +92,9 @@ Mixer::Mixer( bool renderOnly ) :
 	m_changesSignal( false ),
 	m_changes( 0 ),
 	m_doChangesMutex( QMutex::Recursive ),
-	m_waitingForWrite( false )
+	m_waitingForWrite( false ),
+	m_changingThread( NULL ),
+	m_changeDepth( 0 )
 {
 	for( int i = 0; i < 2; ++i )
 	{
@@ -133,16 +136,15 @@ Mixer::Mixer( bool renderOnly ) :
 	// allocte the FIFO from the determined size
 	m_fifo = new fifo( fifoSize );
 
-	// now that framesPerPeriod is fixed initialize global BufferManager
-	BufferManager::init( m_framesPerPeriod );
-
+	// the period size may change later on, so allocate for the largest
+	// one we'll ever render
 	for( int i = 0; i < 3; i++ )
 	{
 		m_readBuf = (surroundSampleFrame*)
-			MemoryHelper::alignedMalloc( m_framesPerPeriod *
+			MemoryHelper::alignedMalloc( DEFAULT_BUFFER_SIZE *
 						sizeof( surroundSampleFrame ) );
 
-		BufferManager::clear( m_readBuf, m_framesPerPeriod );
+		BufferManager::clear( m_readBuf, DEFAULT_BUFFER_SIZE );
 		m_bufferPool.push_back( m_readBuf );
 	}
 
@@ -222,13 +224,16 @@ void Mixer::initDevices()
 
 void Mixer::startProcessing( bool _needs_fifo )
 {
-	if( _needs_fifo )
+	if( _needs_fifo && !m_audioDev->rendersInCallback() )
 	{
+		m_waitingForWrite = false;
 		m_fifoWriter = new fifoWriter( this, m_fifo );
 		m_fifoWriter->start( QThread::HighPriority );
 	}
 	else
 	{
+		// nothing renders until the device's first callback
+		m_waitingForWrite = _needs_fifo;
 		m_fifoWriter = NULL;
 	}
 
@@ -423,6 +428,9 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	FxMixer * fxMixer = Engine::fxMixer();
 	fxMixer->prepareMasterMix();
 
+	// play what has been received from MIDI devices during the last period
+	m_midiClient->processQueuedInEvents( m_framesPerPeriod );
+
 	// create play-handles for new notes, samples etc.
 	song->processNextBuffer();
 
@@ -438,6 +446,7 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 	// STAGE 1: run and render all play handles
 	MixerWorkerThread::fillJobQueue<PlayHandleList>( m_playHandles );
 	MixerWorkerThread::startAndWaitForJobs();
+	m_profiler.nameJobs();
 
 	// removed all play handles which are done
 	for( PlayHandleList::Iterator it = m_playHandles.begin();
@@ -472,6 +481,11 @@ const surroundSampleFrame * Mixer::renderNextBuffer()
 
 	// STAGE 3: do master mix in FX mixer
 	fxMixer->masterMix( m_writeBuf );
+	m_profiler.nameJobs();
+
+	// remote plugins sharing a process render the period they've been
+	// handed while we're outputting this one
+	RemotePluginHost::startProcessing();
 
 
 	emit nextAudioBuffer( m_readBuf );
@@ -575,6 +589,65 @@ void Mixer::changeQuality( const struct qualitySettings & _qs )
 
 
 
+void Mixer::setFramesPerPeriod( fpp_t _frames )
+{
+	if( m_oldAudioDev )
+	{
+		// we're exporting, leave the stored device alone
+		fprintf( stderr, "Mixer: can't change the period size while "
+							"exporting\n" );
+		return;
+	}
+
+	int fifoSize = 1;
+	if( _frames < MINIMUM_BUFFER_SIZE )
+	{
+		_frames = MINIMUM_BUFFER_SIZE;
+	}
+	else if( _frames > DEFAULT_BUFFER_SIZE )
+	{
+		fifoSize = _frames / DEFAULT_BUFFER_SIZE;
+		_frames = DEFAULT_BUFFER_SIZE;
+	}
+
+	stopProcessing();
+
+	// drop what has been rendered with the old period size
+	while( m_fifo->available() )
+	{
+		delete[] m_fifo->read();
+	}
+	delete m_fifo;
+	m_fifo = new fifo( fifoSize );
+
+	m_framesPerPeriod = _frames;
+	for( int i = 0; i < 3; i++ )
+	{
+		BufferManager::clear( m_bufferPool[i], m_framesPerPeriod );
+	}
+
+	// nothing renders right now, so everyone holding period-sized
+	// buffers can safely reallocate them
+	emit framesPerPeriodChanged();
+
+	// audio devices size their buffers and periods when being opened -
+	// we're not exporting, so the current device isn't stored anywhere
+	const sample_rate_t sampleRate = processingSampleRate();
+	delete m_audioDev;
+	m_audioDev = tryAudioDevices();
+	// resampling everything is only needed if the reopened device (or a
+	// fallback) settled on another rate
+	if( processingSampleRate() != sampleRate )
+	{
+		emit sampleRateChanged();
+	}
+
+	startProcessing();
+}
+
+
+
+
 void Mixer::doSetAudioDevice( AudioDevice * _dev )
 {
 	// TODO: Use shared_ptr here in the future.
@@ -792,6 +865,10 @@ void Mixer::requestChangeInModel()
 	m_changesMutex.unlock();
 
 	m_doChangesMutex.lock();
+	if( m_changeDepth++ == 0 )
+	{
+		m_changingThread = QThread::currentThread();
+	}
 	m_waitChangesMutex.lock();
 	if ( m_isProcessing && !m_waitingForWrite && !m_changesSignal )
 	{
@@ -818,6 +895,10 @@ void Mixer::doneChangeInModel()
 		m_changesSignal = false;
 		m_changesMixerCondition.wakeOne();
 	}
+	if( --m_changeDepth == 0 )
+	{
+		m_changingThread = NULL;
+	}
 	m_doChangesMutex.unlock();
 }
 
@@ -835,6 +916,34 @@ void Mixer::runChangesInModel()
 	}
 }
 
+
+
+
+bool Mixer::startCallbackRendering()
+{
+	// don't wait for a change to be done right in the callback
+	if( !m_doChangesMutex.tryLock() )
+	{
+		return false;
+	}
+	m_waitingForWrite = false;
+	m_doChangesMutex.unlock();
+	return true;
+}
+
+
+
+
+void Mixer::finishCallbackRendering()
+{
+	// like the FIFO writer does while waiting for the device, let changes
+	// happen right away until the next callback
+	m_waitChangesMutex.lock();
+	m_waitingForWrite = true;
+	m_waitChangesMutex.unlock();
+	runChangesInModel();
+}
+
 bool Mixer::isAudioDevNameValid(QString name)
 {
 #ifdef LMMS_HAVE_SDL
@@ -24,11 +24,30 @@
 
 #include "MixerProfiler.h"
 
+#include <chrono>
+
+#include "AudioPort.h"
+#include "Effect.h"
+#include "FxMixer.h"
+#include "InstrumentPlayHandle.h"
+#include "InstrumentTrack.h"
+#include "NotePlayHandle.h"
+
+
+MixerProfiler * MixerProfiler::s_tracer = NULL;
+
 
 MixerProfiler::MixerProfiler() :
 	m_periodTimer(),
 	m_cpuLoad( 0 ),
-	m_outputFile()
+	m_outputFile(),
+	m_tracing( false ),
+	m_traceStart( 0 ),
+	m_periodStart( 0 ),
+	m_traceEvents( NULL ),
+	m_traceEventCount( 0 ),
+	m_namedTraceEvents( 0 ),
+	m_firstTraceEvent( true )
 {
 }
 
@@ -36,6 +55,7 @@ MixerProfiler::MixerProfiler() :
 
 MixerProfiler::~MixerProfiler()
 {
+	closeOutputFile();
 }
 
 
@@ -46,7 +66,20 @@ void MixerProfiler::finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPerio
 	const float newCpuLoad = periodElapsed / 10000.0f * sampleRate / framesPerPeriod;
     m_cpuLoad = qBound<int>( 0, ( newCpuLoad * 0.1f + m_cpuLoad * 0.9f ), 100 );
 
-	if( m_outputFile.isOpen() )
+	if( m_tracing )
+	{
+		// the period has its slot reserved, so that it's never dropped
+		TraceEvent & period = m_traceEvents[PeriodTraceEvent];
+		period.type = PeriodJob;
+		period.job = NULL;
+		period.name = jobName( PeriodJob, NULL );
+		period.thread = currentThreadIndex();
+		period.start = m_periodStart;
+		period.duration = now() - m_periodStart;
+
+		writeTraceEvents();
+	}
+	else if( m_outputFile.isOpen() )
 	{
 		m_outputFile.write( QString( "%1\n" ).arg( periodElapsed ).toLatin1() );
 	}
@@ -56,8 +89,213 @@ void MixerProfiler::finishPeriod( sample_rate_t sampleRate, fpp_t framesPerPerio
 
 void MixerProfiler::setOutputFile( const QString& outputFile )
 {
-	m_outputFile.close();
+	closeOutputFile();
+
 	m_outputFile.setFileName( outputFile );
 	m_outputFile.open( QFile::WriteOnly | QFile::Truncate );
+
+	if( m_outputFile.isOpen() &&
+		outputFile.endsWith( ".json", Qt::CaseInsensitive ) )
+	{
+		m_traceEvents = new TraceEvent[MaxTraceEvents];
+		m_traceEventCount = PeriodTraceEvent + 1;
+		m_namedTraceEvents = PeriodTraceEvent + 1;
+		m_firstTraceEvent = true;
+		m_namedThreads.clear();
+		m_traceStart = 0;
+		m_traceStart = now();
+		m_tracing = true;
+		s_tracer = this;
+
+		m_outputFile.write( "[\n" );
+	}
+}
+
+
+
+qint64 MixerProfiler::now() const
+{
+	using namespace std::chrono;
+	return duration_cast<microseconds>(
+			steady_clock::now().time_since_epoch() ).count() -
+								m_traceStart;
 }
 
+
+
+void MixerProfiler::addJob( JobTypes type, void * job, qint64 start )
+{
+	const qint64 end = now();
+	const int index = m_traceEventCount.fetchAndAddOrdered( 1 );
+	if( index < MaxTraceEvents )
+	{
+		TraceEvent & event = m_traceEvents[index];
+		event.type = type;
+		event.job = job;
+		event.thread = currentThreadIndex();
+		event.start = start;
+		event.duration = end - start;
+	}
+}
+
+
+
+void MixerProfiler::nameTraceEvents()
+{
+	const int count = qMin<int>( m_traceEventCount, MaxTraceEvents );
+	for( ; m_namedTraceEvents < count; ++m_namedTraceEvents )
+	{
+		TraceEvent & event = m_traceEvents[m_namedTraceEvents];
+		event.name = jobName( event.type, event.job );
+	}
+}
+
+
+
+// writes all events of the current period - all jobs are done by now, so
+// nobody adds events while we're at it
+void MixerProfiler::writeTraceEvents()
+{
+	static const char * categories[] =
+	{
+		"playhandle", "audioport", "effect", "fxchannel", "period"
+	} ;
+
+	const int mixerThread = currentThreadIndex();
+	const int count = qMin<int>( m_traceEventCount, MaxTraceEvents );
+	const int dropped = m_traceEventCount - count;
+
+	QByteArray out;
+	for( int i = 0; i < count; ++i )
+	{
+		const TraceEvent & event = m_traceEvents[i];
+
+		// let the trace viewer know which thread is which
+		if( event.thread >= m_namedThreads.size() )
+		{
+			m_namedThreads.resize( event.thread + 1 );
+		}
+		if( m_namedThreads[event.thread] == false )
+		{
+			m_namedThreads[event.thread] = true;
+			out += m_firstTraceEvent ? "" : ",\n";
+			out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+				"\"tid\":" + QByteArray::number( event.thread ) +
+				",\"args\":{\"name\":\"" +
+				( event.thread == mixerThread ? QByteArray( "Mixer" ) :
+					"Worker " + QByteArray::number( event.thread ) ) +
+				"\"}}";
+			m_firstTraceEvent = false;
+		}
+
+		QByteArray name = event.name.toUtf8();
+		name.replace( '\\', "\\\\" ).replace( '"', "\\\"" );
+
+		out += m_firstTraceEvent ? "" : ",\n";
+		out += "{\"name\":\"" + name +
+			"\",\"cat\":\"" + categories[event.type] +
+			"\",\"ph\":\"X\",\"ts\":" + QByteArray::number( event.start ) +
+			",\"dur\":" + QByteArray::number( event.duration ) +
+			",\"pid\":1,\"tid\":" + QByteArray::number( event.thread ) +
+			"}";
+		m_firstTraceEvent = false;
+	}
+
+	// mark periods which had more jobs than we could record
+	if( dropped > 0 )
+	{
+		out += m_firstTraceEvent ? "" : ",\n";
+		out += "{\"name\":\"Dropped events\",\"ph\":\"i\",\"s\":\"g\","
+			"\"ts\":" + QByteArray::number( m_periodStart ) +
+			",\"pid\":1,\"tid\":" + QByteArray::number( mixerThread ) +
+			",\"args\":{\"count\":" + QByteArray::number( dropped ) +
+			"}}";
+		m_firstTraceEvent = false;
+	}
+
+	m_outputFile.write( out );
+
+	m_traceEventCount = PeriodTraceEvent + 1;
+	m_namedTraceEvents = PeriodTraceEvent + 1;
+}
+
+
+
+void MixerProfiler::closeOutputFile()
+{
+	if( m_tracing )
+	{
+		s_tracer = NULL;
+		m_tracing = false;
+		m_outputFile.write( "\n]\n" );
+		delete[] m_traceEvents;
+		m_traceEvents = NULL;
+	}
+	m_outputFile.close();
+}
+
+
+
+QString MixerProfiler::jobName( JobTypes type, void * job )
+{
+	switch( type )
+	{
+		case PlayHandleJob:
+		{
+			PlayHandle * handle = static_cast<PlayHandle *>( job );
+			const QString port = handle->audioPort() ?
+					handle->audioPort()->name() : QString();
+			switch( handle->type() )
+			{
+				case PlayHandle::TypeNotePlayHandle:
+				{
+					NotePlayHandle * n =
+						static_cast<NotePlayHandle *>( handle );
+					return QString( "%1 (%2)" ).arg( port ).arg(
+					n->instrumentTrack()->instrumentName() );
+				}
+				case PlayHandle::TypeInstrumentPlayHandle:
+				{
+					InstrumentPlayHandle * iph =
+					static_cast<InstrumentPlayHandle *>( handle );
+					return QString( "%1 (%2)" ).arg( port ).arg(
+						iph->instrument()->displayName() );
+				}
+				case PlayHandle::TypeSamplePlayHandle:
+					return QString( "%1 (sample)" ).arg( port );
+				default:
+					return QString( "%1 (preview)" ).arg( port );
+			}
+		}
+		case AudioPortJob:
+			return static_cast<AudioPort *>( job )->name();
+		case EffectJob:
+			return static_cast<Effect *>( job )->displayName();
+		case FxChannelJob:
+		{
+			FxChannel * ch = static_cast<FxChannel *>( job );
+			if( ch->m_name.isEmpty() )
+			{
+				return ch->m_channelIndex == 0 ? QString( "Master" ) :
+					QString( "FX %1" ).arg( ch->m_channelIndex );
+			}
+			return ch->m_name;
+		}
+		case PeriodJob:
+			break;
+	}
+	return "Period";
+}
+
+
+
+int MixerProfiler::currentThreadIndex()
+{
+	static AtomicInt threadCount;
+	static thread_local int threadIndex = -1;
+	if( threadIndex < 0 )
+	{
+		threadIndex = threadCount.fetchAndAddOrdered( 1 );
+	}
+	return threadIndex;
+}
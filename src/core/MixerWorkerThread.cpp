@@ -24,6 +24,18 @@
 
 #include "MixerWorkerThread.h"
 
+#include "lmmsconfig.h"
+
+#ifdef LMMS_HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+#ifdef LMMS_HAVE_SCHED_H
+#include <sched.h>
+#endif
+
+#include <cstdio>
+
 #include "denormals.h"
 #include <QDebug>
 #include <QMutex>
@@ -34,6 +46,8 @@
 MixerWorkerThread::JobQueue MixerWorkerThread::globalJobQueue;
 QWaitCondition * MixerWorkerThread::queueReadyWaitCond = NULL;
 QList<MixerWorkerThread *> MixerWorkerThread::workerThreads;
+volatile int MixerWorkerThread::s_activeWorkers = -1;
+volatile int MixerWorkerThread::s_realtimePriority = 0;
 
 
 
@@ -109,7 +123,9 @@ void MixerWorkerThread::JobQueue::wait()
 
 MixerWorkerThread::MixerWorkerThread( Mixer* mixer ) :
 	QThread( mixer ),
-	m_quit( false )
+	m_index( workerThreads.size() ),
+	m_quit( false ),
+	m_realtimePriority( 0 )
 {
 	// initialize global static data
 	if( queueReadyWaitCond == NULL )
@@ -158,6 +174,45 @@ void MixerWorkerThread::startAndWaitForJobs()
 
 
 
+void MixerWorkerThread::setActiveThreadCount( int _threads )
+{
+	// the mixer thread always processes jobs, so at least one thread is
+	// active and the remaining ones are started worker threads
+	s_activeWorkers = qBound( 1, _threads, qMax( threadCount(), 1 ) ) - 1;
+}
+
+
+
+
+void MixerWorkerThread::setRealtimePriority( int _priority )
+{
+	s_realtimePriority = _priority;
+}
+
+
+
+
+void MixerWorkerThread::applyRealtimePriority()
+{
+	m_realtimePriority = s_realtimePriority;
+	if( m_realtimePriority <= 0 )
+	{
+		return;
+	}
+#if defined(LMMS_HAVE_PTHREAD_H) && defined(LMMS_HAVE_SCHED_H)
+	struct sched_param param;
+	param.sched_priority = m_realtimePriority;
+	if( pthread_setschedparam( pthread_self(), SCHED_FIFO, &param ) != 0 )
+	{
+		fprintf( stderr, "MixerWorkerThread: could not set realtime "
+				"priority %d\n", m_realtimePriority );
+	}
+#endif
+}
+
+
+
+
 void MixerWorkerThread::run()
 {
 	MemoryManager::ThreadGuard mmThreadGuard; Q_UNUSED(mmThreadGuard);
@@ -168,7 +223,14 @@ void MixerWorkerThread::run()
 	{
 		m.lock();
 		queueReadyWaitCond->wait( &m );
-		globalJobQueue.run();
+		if( m_realtimePriority != s_realtimePriority )
+		{
+			applyRealtimePriority();
+		}
+		if( s_activeWorkers < 0 || m_index < s_activeWorkers )
+		{
+			globalJobQueue.run();
+		}
 		m.unlock();
 	}
 }
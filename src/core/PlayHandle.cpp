@@ -51,6 +51,8 @@ PlayHandle::~PlayHandle()
 
 void PlayHandle::doProcessing()
 {
+	MixerProfiler::Scope profilerScope( MixerProfiler::PlayHandleJob, this );
+
 	if( m_usesBuffer )
 	{
 		m_bufferReleased = false;
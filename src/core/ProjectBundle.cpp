@@ -0,0 +1,350 @@
+/*
+ * ProjectBundle.cpp - project file format storing samples as binary entries
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryFile>
+#include <QVector>
+
+#include "ProjectBundle.h"
+#include "SampleData.h"
+
+
+const char * ProjectBundle::Extension = "mmpb";
+
+// a bundle starts with the magic, the format version and the number of
+// entries, followed by the entry table and the entries themselves - the
+// first one always is the XML
+static const char Magic[8] = { 'L', 'M', 'M', 'S', 'P', 'R', 'J', 'B' };
+static const quint32 Version = 1;
+static const qint64 HeaderSize = 16;
+static const qint64 EntrySize = 32;
+
+// entries start at multiples of this, so mapped frames are aligned
+static const qint64 EntryAlignment = 16;
+
+// more entries than that are taken as a corrupt file
+static const quint32 MaxEntries = 1 << 20;
+
+// qCompress() works on QByteArrays, larger samples are always stored raw
+static const qint64 MaxCompressedSize = 1 << 30;
+
+// raw entries are copied to a temporary file in chunks of this size
+static const qint64 CopyChunkSize = 1 << 20;
+
+enum EntryTypes
+{
+	XmlEntry,
+	FramesEntry
+} ;
+
+enum EntryFlags
+{
+	Compressed = 1
+} ;
+
+struct BundleEntry
+{
+	quint32 type;
+	quint32 flags;
+	quint64 offset;
+	quint64 size;
+	// number of frames of FramesEntry entries
+	quint64 frames;
+} ;
+
+
+
+
+// puts byte i of every float into plane i - the exponent and upper mantissa
+// bytes of neighbouring samples are similar, the lower ones are mostly noise
+static QByteArray shuffle( const char * _data, qint64 _size )
+{
+	const qint64 floats = _size / sizeof( float );
+	QByteArray out( _size, 0 );
+	char * dst = out.data();
+	for( qint64 i = 0; i < floats; ++i )
+	{
+		for( int b = 0; b < (int) sizeof( float ); ++b )
+		{
+			dst[b * floats + i] = _data[i * sizeof( float ) + b];
+		}
+	}
+	return out;
+}
+
+
+
+
+static void unshuffle( const char * _data, qint64 _size, char * _dst )
+{
+	const qint64 floats = _size / sizeof( float );
+	for( qint64 i = 0; i < floats; ++i )
+	{
+		for( int b = 0; b < (int) sizeof( float ); ++b )
+		{
+			_dst[i * sizeof( float ) + b] = _data[b * floats + i];
+		}
+	}
+}
+
+
+
+
+static bool writeEntry( QFile & _file, BundleEntry & _entry,
+					const char * _data, qint64 _size )
+{
+	const qint64 padding = ( EntryAlignment -
+			_file.pos() % EntryAlignment ) % EntryAlignment;
+	static const char zeros[EntryAlignment] = { 0 };
+	if( _file.write( zeros, padding ) != padding )
+	{
+		return false;
+	}
+	_entry.offset = _file.pos();
+	_entry.size = _size;
+	return _file.write( _data, _size ) == _size;
+}
+
+
+
+
+static bool copyEntry( QFile & _from, QFile & _to, qint64 _size )
+{
+	QByteArray chunk;
+	while( _size > 0 )
+	{
+		chunk = _from.read( qMin( _size, CopyChunkSize ) );
+		if( chunk.isEmpty() || _to.write( chunk ) != chunk.size() )
+		{
+			return false;
+		}
+		_size -= chunk.size();
+	}
+	return _to.flush();
+}
+
+
+
+
+bool ProjectBundle::isBundleName( const QString & _fileName )
+{
+	return _fileName.section( '.', -1 ) == Extension;
+}
+
+
+
+
+bool ProjectBundle::isBundle( QIODevice * _device )
+{
+	return _device->peek( sizeof( Magic ) ) ==
+				QByteArray::fromRawData( Magic, sizeof( Magic ) );
+}
+
+
+
+
+bool ProjectBundle::write( QFile & _file, const QByteArray & _xml,
+				const QList<SampleData *> & _samples )
+{
+	QVector<BundleEntry> entries( _samples.size() + 1 );
+	memset( entries.data(), 0, entries.size() * sizeof( BundleEntry ) );
+
+	// leave room for the table, it's written once all offsets are known
+	const QByteArray table( HeaderSize + entries.size() * EntrySize, 0 );
+	if( _file.write( table ) != table.size() )
+	{
+		return false;
+	}
+
+	const QByteArray xml = qCompress( _xml );
+	entries[0].type = XmlEntry;
+	entries[0].flags = Compressed;
+	if( !writeEntry( _file, entries[0], xml.constData(), xml.size() ) )
+	{
+		return false;
+	}
+
+	for( int i = 0; i < _samples.size(); ++i )
+	{
+		BundleEntry & entry = entries[i + 1];
+		const char * data = (const char *) _samples[i]->data();
+		const qint64 size = _samples[i]->frames() * sizeof( sampleFrame );
+		entry.type = FramesEntry;
+		entry.frames = _samples[i]->frames();
+
+		// recordings hardly compress sometimes - rather keep them raw
+		// then, so they can be mapped when loading
+		const QByteArray packed = size <= MaxCompressedSize ?
+				qCompress( shuffle( data, size ) ) : QByteArray();
+		bool ok;
+		if( !packed.isEmpty() && packed.size() < size - size / 8 )
+		{
+			entry.flags = Compressed;
+			ok = writeEntry( _file, entry, packed.constData(),
+								packed.size() );
+		}
+		else
+		{
+			ok = writeEntry( _file, entry, data, size );
+		}
+		if( !ok )
+		{
+			return false;
+		}
+	}
+
+	_file.seek( 0 );
+	QDataStream out( &_file );
+	out.setByteOrder( QDataStream::LittleEndian );
+	out.writeRawData( Magic, sizeof( Magic ) );
+	out << Version << (quint32) entries.size();
+	for( const BundleEntry & entry : entries )
+	{
+		out << entry.type << entry.flags << entry.offset << entry.size
+							<< entry.frames;
+	}
+	return out.status() == QDataStream::Ok;
+}
+
+
+
+
+bool ProjectBundle::read( const QString & _fileName, QByteArray & _xml,
+					QList<SampleData *> & _samples )
+{
+	QFile file( _fileName );
+	if( !file.open( QIODevice::ReadOnly ) || !isBundle( &file ) )
+	{
+		return false;
+	}
+
+	QDataStream in( &file );
+	in.setByteOrder( QDataStream::LittleEndian );
+	in.skipRawData( sizeof( Magic ) );
+	quint32 version, count;
+	in >> version >> count;
+	if( version != Version || count == 0 || count > MaxEntries )
+	{
+		fprintf( stderr, "ProjectBundle: unsupported version or "
+			"corrupt header in %s\n", _fileName.toUtf8().constData() );
+		return false;
+	}
+
+	QVector<BundleEntry> entries( count );
+	for( BundleEntry & entry : entries )
+	{
+		in >> entry.type >> entry.flags >> entry.offset >> entry.size
+							>> entry.frames;
+		if( in.status() != QDataStream::Ok ||
+			entry.offset + entry.size > (quint64) file.size() )
+		{
+			fprintf( stderr, "ProjectBundle: corrupt entry table "
+				"in %s\n", _fileName.toUtf8().constData() );
+			return false;
+		}
+	}
+
+	file.seek( entries[0].offset );
+	_xml = qUncompress( file.read( entries[0].size ) );
+	if( entries[0].type != XmlEntry || _xml.isEmpty() )
+	{
+		return false;
+	}
+
+	bool ok = true;
+	for( int i = 1; i < entries.size() && ok; ++i )
+	{
+		const BundleEntry & entry = entries[i];
+		const qint64 size = entry.frames * sizeof( sampleFrame );
+		ok = entry.type == FramesEntry && entry.frames > 0;
+		SampleData * sampleData = NULL;
+
+		if( ok && entry.flags & Compressed )
+		{
+			file.seek( entry.offset );
+			const QByteArray shuffled =
+					qUncompress( file.read( entry.size ) );
+			ok = shuffled.size() == size;
+			if( ok )
+			{
+				sampleFrame * data = MM_ALLOC( sampleFrame,
+								entry.frames );
+				unshuffle( shuffled.constData(), size,
+							(char *) data );
+				sampleData = new SampleData( data, entry.frames );
+			}
+		}
+		else if( ok && (qint64) entry.size == size )
+		{
+			// raw frames are mapped rather than held in memory -
+			// from a copy, as saving replaces the bundle, which
+			// fails on Windows while parts of it are mapped
+			QTemporaryFile * copy = new QTemporaryFile(
+				QDir::tempPath() + "/lmms-bundle-XXXXXX" );
+			sampleFrame * data = NULL;
+			file.seek( entry.offset );
+			if( copy->open() && copyEntry( file, *copy, size ) )
+			{
+				data = (sampleFrame *) copy->map( 0, size );
+			}
+			if( data != NULL )
+			{
+				sampleData = new SampleData( copy, data,
+								entry.frames );
+			}
+			else
+			{
+				delete copy;
+				data = MM_ALLOC( sampleFrame, entry.frames );
+				file.seek( entry.offset );
+				ok = file.read( (char *) data, size ) == size;
+				sampleData = new SampleData( data, entry.frames );
+			}
+		}
+		else
+		{
+			ok = false;
+		}
+
+		if( sampleData != NULL )
+		{
+			_samples << sampleData;
+		}
+	}
+
+	if( !ok )
+	{
+		fprintf( stderr, "ProjectBundle: corrupt sample entry in %s\n",
+					_fileName.toUtf8().constData() );
+		for( SampleData * sampleData : _samples )
+		{
+			sharedObject::unref( sampleData );
+		}
+		_samples.clear();
+	}
+	return ok;
+}
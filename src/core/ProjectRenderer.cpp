@@ -26,6 +26,7 @@
 #include <QFile>
 
 #include "ProjectRenderer.h"
+#include "RenderCache.h"
 #include "Song.h"
 
 #include "AudioFileWave.h"
@@ -77,6 +78,7 @@ ProjectRenderer::ProjectRenderer( const Mixer::qualitySettings & qualitySettings
 	QThread( Engine::mixer() ),
 	m_fileDev( NULL ),
 	m_qualitySettings( qualitySettings ),
+	m_renderCache( NULL ),
 	m_progress( 0 ),
 	m_abort( false )
 {
@@ -102,6 +104,11 @@ ProjectRenderer::ProjectRenderer( const Mixer::qualitySettings & qualitySettings
 
 ProjectRenderer::~ProjectRenderer()
 {
+	if( m_renderCache )
+	{
+		m_renderCache->finish( !m_abort );
+		delete m_renderCache;
+	}
 }
 
 
@@ -148,6 +155,14 @@ void ProjectRenderer::startProcessing()
 		Engine::mixer()->setAudioDevice( m_fileDev,
 						m_qualitySettings, false, false );
 
+		// sets up which tracks and FX channels to take from the cache -
+		// this has to happen once the export's sample rate is known
+		if( RenderCache::isEnabled() )
+		{
+			m_renderCache = new RenderCache;
+			m_renderCache->prepare();
+		}
+
 		start(
 #ifndef LMMS_BUILD_WIN32
 			QThread::HighPriority
@@ -29,6 +29,7 @@
 #endif
 
 #include "BufferManager.h"
+#include "ConfigManager.h"
 #include "RemotePlugin.h"
 #include "Mixer.h"
 #include "Engine.h"
@@ -42,6 +43,10 @@
 #endif
 
 
+// MIDI events a batched plugin holds back until its next period
+static const int MaxQueuedMidiEvents = 1024;
+
+
 // simple helper thread monitoring our RemotePlugin - if process terminates
 // unexpectedly invalidate plugin so LMMS doesn't lock up
 ProcessWatcher::ProcessWatcher( RemotePlugin * _p ) :
@@ -93,7 +98,19 @@ RemotePlugin::RemotePlugin() :
 	m_shmSize( 0 ),
 	m_shm( NULL ),
 	m_inputCount( DEFAULT_CHANNELS ),
-	m_outputCount( DEFAULT_CHANNELS )
+	m_outputCount( DEFAULT_CHANNELS ),
+	m_pipelined( ConfigManager::inst()->value( "mixer",
+					"pipelineremoteplugins" ).toInt() ),
+	m_processing( false ),
+	m_batched( false ),
+	m_pendingOutput( false ),
+	m_channelCountsPending( false ),
+	m_pendingInputCount( DEFAULT_CHANNELS ),
+	m_pendingOutputCount( DEFAULT_CHANNELS ),
+	m_sharedProcess( false ),
+	m_host( NULL ),
+	m_hostInstanceId( -1 ),
+	m_queuedMidiEvents()
 {
 #ifndef SYNC_WITH_SHM_FIFO
 	struct sockaddr_un sa;
@@ -128,6 +145,11 @@ RemotePlugin::RemotePlugin() :
 		Qt::DirectConnection );
 	connect( &m_process, SIGNAL( finished( int, QProcess::ExitStatus ) ),
 		&m_watcher, SLOT( quit() ), Qt::DirectConnection );
+	connect( Engine::mixer(), SIGNAL( framesPerPeriodChanged() ),
+		this, SLOT( updateBufferSize() ), Qt::DirectConnection );
+	connect( ConfigManager::inst(),
+		SIGNAL( valueChanged( QString, QString, QString ) ),
+		this, SLOT( handleConfigChange( QString, QString, QString ) ) );
 }
 
 
@@ -143,13 +165,18 @@ RemotePlugin::~RemotePlugin()
 		if( isRunning() )
 		{
 			lock();
+			// a shared process must not render us while we go away
+			finishProcessing();
 			sendMessage( IdQuit );
 
-			m_process.waitForFinished( 1000 );
-			if( m_process.state() != QProcess::NotRunning )
+			if( m_host == NULL )
 			{
-				m_process.terminate();
-				m_process.kill();
+				m_process.waitForFinished( 1000 );
+				if( m_process.state() != QProcess::NotRunning )
+				{
+					m_process.terminate();
+					m_process.kill();
+				}
 			}
 			unlock();
 		}
@@ -167,6 +194,24 @@ RemotePlugin::~RemotePlugin()
 	}
 	remove( m_socketFile.toUtf8().constData() );
 #endif
+
+	RemotePluginHost::release( m_host, this );
+}
+
+
+
+
+bool RemotePlugin::isRunning()
+{
+#ifdef DEBUG_REMOTE_PLUGIN
+	return true;
+#else
+	if( m_host != NULL )
+	{
+		return m_host->isRunning();
+	}
+	return m_process.state() != QProcess::NotRunning;
+#endif
 }
 
 
@@ -182,7 +227,13 @@ bool RemotePlugin::init(const QString &pluginExecutable,
 		reset( new shmFifo(), new shmFifo() );
 #endif
 		m_failed = false;
+		m_processing = false;
+		m_batched = false;
+		m_pendingOutput = false;
+		m_channelCountsPending = false;
 	}
+	// the new process announces its protocol version again
+	setPeerProtocolVersion( RemoteProtocolTextMessages );
 	QString exec = QFileInfo(QDir("plugins:"), pluginExecutable).absoluteFilePath();
 #ifdef LMMS_BUILD_APPLE
 	// search current directory first
@@ -222,17 +273,34 @@ bool RemotePlugin::init(const QString &pluginExecutable,
 	args << m_socketFile;
 #endif
 	args << extraArgs;
+
+	if( m_sharedProcess )
+	{
+		// we only get here again if the previous instance died
+		RemotePluginHost::release( m_host, this );
+		m_host = RemotePluginHost::acquire( pluginExecutable, this );
+	}
+
+	if( m_host != NULL )
+	{
+		m_host->addInstance( this, args );
+	}
+	else
+	{
 #ifndef DEBUG_REMOTE_PLUGIN
-	m_process.setProcessChannelMode( QProcess::ForwardedChannels );
-	m_process.setWorkingDirectory( QCoreApplication::applicationDirPath() );
-	m_exec = exec;
-	m_args = args;
-	// we start the process on the watcher thread to work around QTBUG-8819
-	m_process.moveToThread( &m_watcher );
-	m_watcher.start( QThread::LowestPriority );
+		m_process.setProcessChannelMode( QProcess::ForwardedChannels );
+		m_process.setWorkingDirectory(
+				QCoreApplication::applicationDirPath() );
+		m_exec = exec;
+		m_args = args;
+		// we start the process on the watcher thread to work around
+		// QTBUG-8819
+		m_process.moveToThread( &m_watcher );
+		m_watcher.start( QThread::LowestPriority );
 #else
-	qDebug() << exec << args;
+		qDebug() << exec << args;
 #endif
+	}
 
 #ifndef SYNC_WITH_SHM_FIFO
 	struct pollfd pollin;
@@ -305,6 +373,29 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 		return false;
 	}
 
+	lock();
+
+	// the period handed out last time still owns the shared memory
+	finishProcessing();
+
+	bool rendered = false;
+	if( m_pipelined && _out_buf != NULL )
+	{
+		// hand out what has been rendered during the previous period
+		if( m_pendingOutput )
+		{
+			collectOutput( _out_buf, frames );
+			rendered = true;
+		}
+		else
+		{
+			BufferManager::clear( _out_buf, frames );
+		}
+		m_pendingOutput = false;
+	}
+
+	applyPendingChannelCounts();
+
 	memset( m_shm, 0, m_shmSize );
 
 	ch_cnt_t inputs = qMin<ch_cnt_t>( m_inputCount, DEFAULT_CHANNELS );
@@ -339,8 +430,20 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 		}
 	}
 
-	lock();
-	sendMessage( IdStartProcessing );
+	if( isBatched() )
+	{
+		// the host starts it along with the other instances once the
+		// mixer is done with this period
+		m_host->queueProcessing( this, m_queuedMidiEvents );
+		m_queuedMidiEvents.clear();
+		m_batched = true;
+	}
+	else
+	{
+		sendQueuedMidiEvents();
+		sendMessage( IdStartProcessing );
+	}
+	m_processing = true;
 
 	if( m_failed || _out_buf == NULL || m_outputCount == 0 )
 	{
@@ -348,9 +451,86 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 		return false;
 	}
 
+	if( m_pipelined )
+	{
+		// collect the output during the next period
+		m_pendingOutput = true;
+		unlock();
+		return rendered;
+	}
+
 	waitForMessage( IdProcessingDone );
+	m_processing = false;
+	collectOutput( _out_buf, frames );
+	applyPendingChannelCounts();
+	unlock();
+
+	return true;
+}
+
+
+
+
+void RemotePlugin::finishProcessing()
+{
+	if( !m_processing )
+	{
+		return;
+	}
+
+	if( m_batched )
+	{
+		m_host->finishProcessing( this );
+	}
+	else
+	{
+		waitForMessage( IdProcessingDone );
+	}
+	m_processing = false;
+	m_batched = false;
+}
+
+
+
+
+void RemotePlugin::sendQueuedMidiEvents()
+{
+	for( int i = 0; i + 4 < m_queuedMidiEvents.size(); i += 5 )
+	{
+		message m( IdMidiEvent );
+		for( int j = 0; j < 5; ++j )
+		{
+			m.addInt( m_queuedMidiEvents[i + j] );
+		}
+		sendMessage( m );
+	}
+	m_queuedMidiEvents.clear();
+}
+
+
+
+
+void RemotePlugin::setPipelined( bool _on )
+{
+	lock();
+	m_pipelined = _on;
+	m_pendingOutput = false;
 	unlock();
+}
+
+
+
+
+f_cnt_t RemotePlugin::latency() const
+{
+	return m_pipelined ? Engine::mixer()->framesPerPeriod() : 0;
+}
+
 
+
+
+void RemotePlugin::collectOutput( sampleFrame * _out_buf, const fpp_t frames )
+{
 	const ch_cnt_t outputs = qMin<ch_cnt_t>( m_outputCount,
 							DEFAULT_CHANNELS );
 	if( m_splitChannels )
@@ -385,8 +565,6 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 			}
 		}
 	}
-
-	return true;
 }
 
 
@@ -395,14 +573,26 @@ bool RemotePlugin::process( const sampleFrame * _in_buf,
 void RemotePlugin::processMidiEvent( const MidiEvent & _e,
 							const f_cnt_t _offset )
 {
-	message m( IdMidiEvent );
-	m.addInt( _e.type() );
-	m.addInt( _e.channel() );
-	m.addInt( _e.param( 0 ) );
-	m.addInt( _e.param( 1 ) );
-	m.addInt( _offset );
 	lock();
-	sendMessage( m );
+	// a frozen track doesn't process, so don't collect its events forever
+	if( isBatched() && m_queuedMidiEvents.size() < MaxQueuedMidiEvents * 5 )
+	{
+		// sending it right away could let the host render the period
+		// before the instance's own thread got to the event
+		m_queuedMidiEvents << _e.type() << _e.channel() <<
+				_e.param( 0 ) << _e.param( 1 ) << _offset;
+	}
+	else
+	{
+		sendQueuedMidiEvents();
+		message m( IdMidiEvent );
+		m.addInt( _e.type() );
+		m.addInt( _e.channel() );
+		m.addInt( _e.param( 0 ) );
+		m.addInt( _e.param( 1 ) );
+		m.addInt( _offset );
+		sendMessage( m );
+	}
 	unlock();
 }
 
@@ -423,8 +613,45 @@ void RemotePlugin::hideUI()
 
 
 
+void RemotePlugin::setChannelCounts( int _inputs, int _outputs )
+{
+	m_pendingInputCount = _inputs;
+	m_pendingOutputCount = _outputs;
+	m_channelCountsPending = true;
+
+	// the client may change them while processing, e.g. a VST plugin
+	// calling audioMasterIOChanged from processReplacing() - process()
+	// is waiting for IdProcessingDone then and has to collect the output
+	// first, so don't pull the memory away from under its feet
+	if( !m_processing )
+	{
+		applyPendingChannelCounts();
+	}
+}
+
+
+
+
+void RemotePlugin::applyPendingChannelCounts()
+{
+	if( m_channelCountsPending )
+	{
+		m_channelCountsPending = false;
+		m_inputCount = m_pendingInputCount;
+		m_outputCount = m_pendingOutputCount;
+		resizeSharedProcessingMemory();
+	}
+}
+
+
+
+
 void RemotePlugin::resizeSharedProcessingMemory()
 {
+	// callers make sure the client isn't processing - output which
+	// hasn't been collected yet has the old layout
+	m_pendingOutput = false;
+
 	const size_t s = ( m_inputCount+m_outputCount ) *
 				Engine::mixer()->framesPerPeriod() *
 							sizeof( float );
@@ -474,6 +701,44 @@ void RemotePlugin::processFinished( int exitCode,
 
 
 
+void RemotePlugin::updateBufferSize()
+{
+	if( m_failed || !isRunning() )
+	{
+		return;
+	}
+
+	// the mixer doesn't render while the period size changes, so let the
+	// client reconfigure itself before handing out the resized memory
+	lock();
+	// the period handed out last time still owns the shared memory
+	finishProcessing();
+	sendMessage( message( IdChangeBufferSize ).
+				addInt( Engine::mixer()->framesPerPeriod() ) );
+	waitForMessage( IdInformationUpdated, true );
+	if( m_shm != NULL )
+	{
+		resizeSharedProcessingMemory();
+	}
+	unlock();
+}
+
+
+
+
+void RemotePlugin::handleConfigChange( QString _cls, QString _attribute,
+							QString _value )
+{
+	// running plugins follow the setup dialog right away
+	if( _cls == "mixer" && _attribute == "pipelineremoteplugins" )
+	{
+		setPipelined( _value.toInt() );
+	}
+}
+
+
+
+
 bool RemotePlugin::processMessage( const message & _m )
 {
 	lock();
@@ -489,6 +754,14 @@ bool RemotePlugin::processMessage( const message & _m )
 			reply = true;
 			break;
 
+		case IdProtocolVersion:
+			// switch before replying, the client knows how to
+			// decode binary messages already
+			setPeerProtocolVersion( _m.getInt() );
+			reply = true;
+			reply_message.addInt( RemoteProtocolVersion );
+			break;
+
 		case IdSampleRateInformation:
 			reply = true;
 			reply_message.addInt( Engine::mixer()->processingSampleRate() );
@@ -500,19 +773,18 @@ bool RemotePlugin::processMessage( const message & _m )
 			break;
 
 		case IdChangeInputCount:
-			m_inputCount = _m.getInt( 0 );
-			resizeSharedProcessingMemory();
+			setChannelCounts( _m.getInt( 0 ), m_channelCountsPending ?
+					m_pendingOutputCount : m_outputCount );
 			break;
 
 		case IdChangeOutputCount:
-			m_outputCount = _m.getInt( 0 );
-			resizeSharedProcessingMemory();
+			setChannelCounts( m_channelCountsPending ?
+					m_pendingInputCount : m_inputCount,
+							_m.getInt( 0 ) );
 			break;
 
 		case IdChangeInputOutputCount:
-			m_inputCount = _m.getInt( 0 );
-			m_outputCount = _m.getInt( 1 );
-			resizeSharedProcessingMemory();
+			setChannelCounts( _m.getInt( 0 ), _m.getInt( 1 ) );
 			break;
 
 		case IdDebugMessage:
@@ -521,6 +793,9 @@ bool RemotePlugin::processMessage( const message & _m )
 			break;
 
 		case IdProcessingDone:
+			m_processing = false;
+			break;
+
 		case IdQuit:
 		default:
 			break;
@@ -533,3 +808,217 @@ bool RemotePlugin::processMessage( const message & _m )
 
 	return true;
 }
+
+
+
+
+
+
+QList<RemotePluginHost *> RemotePluginHost::s_hosts;
+QMutex RemotePluginHost::s_hostsMutex;
+
+
+RemotePluginHost::RemotePluginHost( const QString & _exec ) :
+	RemotePlugin(),
+	m_executable( _exec ),
+	m_plugins(),
+	m_queued(),
+	m_batch(),
+	m_batchInFlight( false ),
+	m_nextInstanceId( 0 )
+{
+	// the host renders batched periods with as many threads as the mixer
+	init( _exec, true, QStringList() << "--host" <<
+			QString::number( QThread::idealThreadCount() ) );
+}
+
+
+
+
+RemotePluginHost::~RemotePluginHost()
+{
+	// make sure processFinished() doesn't run while our members go away
+	m_watcher.stop();
+	m_watcher.wait();
+}
+
+
+
+
+RemotePluginHost * RemotePluginHost::acquire( const QString & _exec,
+							RemotePlugin * _plugin )
+{
+	s_hostsMutex.lock();
+	for( RemotePluginHost * host : s_hosts )
+	{
+		if( host->m_executable == _exec &&
+				host->m_plugins.size() < MaxInstances )
+		{
+			host->m_plugins.push_back( _plugin );
+			s_hostsMutex.unlock();
+			return host;
+		}
+	}
+	s_hostsMutex.unlock();
+
+	// starting the process processes events, so don't hold the mutex
+	RemotePluginHost * host = new RemotePluginHost( _exec );
+	if( host->failed() )
+	{
+		delete host;
+		return NULL;
+	}
+
+	s_hostsMutex.lock();
+	host->m_plugins.push_back( _plugin );
+	s_hosts.push_back( host );
+	s_hostsMutex.unlock();
+
+	return host;
+}
+
+
+
+
+void RemotePluginHost::release( RemotePluginHost * _host,
+							RemotePlugin * _plugin )
+{
+	if( _host == NULL )
+	{
+		return;
+	}
+
+	s_hostsMutex.lock();
+	_host->m_plugins.removeAll( _plugin );
+	const bool unused = _host->m_plugins.isEmpty();
+	if( unused )
+	{
+		s_hosts.removeAll( _host );
+	}
+	s_hostsMutex.unlock();
+
+	// processFinished() might be waiting for the mutex while the
+	// destructor waits for it to return
+	if( unused )
+	{
+		delete _host;
+	}
+}
+
+
+
+
+void RemotePluginHost::startProcessing()
+{
+	s_hostsMutex.lock();
+	for( RemotePluginHost * host : s_hosts )
+	{
+		host->lock();
+		if( !host->m_queued.isEmpty() )
+		{
+			host->sendBatch();
+		}
+		host->unlock();
+	}
+	s_hostsMutex.unlock();
+}
+
+
+
+
+void RemotePluginHost::addInstance( RemotePlugin * _plugin,
+						const QStringList & _args )
+{
+	message m( IdAddInstance );
+	m.addInt( _args.size() );
+	for( const QString & arg : _args )
+	{
+		m.addString( QSTR_TO_STDSTR( arg ) );
+	}
+
+	lock();
+	_plugin->m_hostInstanceId = m_nextInstanceId++;
+	m.addInt( _plugin->m_hostInstanceId );
+	sendMessage( m );
+	unlock();
+}
+
+
+
+
+void RemotePluginHost::queueProcessing( RemotePlugin * _plugin,
+					const QVector<int> & _midiEvents )
+{
+	lock();
+	m_queued.push_back( _plugin );
+	m_batch << _plugin->m_hostInstanceId << _midiEvents.size() / 5;
+	m_batch << _midiEvents;
+	unlock();
+}
+
+
+
+
+void RemotePluginHost::finishProcessing( RemotePlugin * _plugin )
+{
+	lock();
+	// the mixer didn't get to start the batch, e.g. because the instance
+	// is going away in between two periods
+	if( m_queued.contains( _plugin ) )
+	{
+		sendBatch();
+	}
+	waitForBatch();
+	unlock();
+}
+
+
+
+
+void RemotePluginHost::sendBatch()
+{
+	waitForBatch();
+
+	message m( IdProcessInstances );
+	m.addInt( m_queued.size() );
+	for( int value : m_batch )
+	{
+		m.addInt( value );
+	}
+	sendMessage( m );
+
+	m_queued.clear();
+	m_batch.clear();
+	m_batchInFlight = true;
+}
+
+
+
+
+void RemotePluginHost::waitForBatch()
+{
+	if( m_batchInFlight )
+	{
+		waitForMessage( IdProcessingDone );
+		m_batchInFlight = false;
+	}
+}
+
+
+
+
+void RemotePluginHost::processFinished( int exitCode,
+					QProcess::ExitStatus exitStatus )
+{
+	RemotePlugin::processFinished( exitCode, exitStatus );
+
+	// the instances died along with the process - make sure nobody keeps
+	// waiting for them and let new instances start another process
+	s_hostsMutex.lock();
+	s_hosts.removeAll( this );
+	for( RemotePlugin * plugin : m_plugins )
+	{
+		plugin->invalidate();
+	}
+	s_hostsMutex.unlock();
+}
@@ -0,0 +1,565 @@
+/*
+ * RenderCache.cpp - reuses rendered tracks and FX channels across exports
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <QDir>
+#include <QDomDocument>
+#include <QFileInfo>
+
+#include "RenderCache.h"
+#include "AutomationTrack.h"
+#include "BBTrackContainer.h"
+#include "ConfigManager.h"
+#include "Controller.h"
+#include "Engine.h"
+#include "FreezeCache.h"
+#include "FxMixer.h"
+#include "InstrumentTrack.h"
+#include "Mixer.h"
+#include "Song.h"
+
+
+static const qint64 DefaultSizeLimit = 2048; // MB
+
+QString RenderCache::s_directory;
+bool RenderCache::s_directorySet = false;
+qint64 RenderCache::s_sizeLimit = -1;
+
+
+
+
+static bool lastUsedAfter( const QFileInfo & _a, const QFileInfo & _b )
+{
+	return qMax( _a.lastRead(), _a.lastModified() ) >
+				qMax( _b.lastRead(), _b.lastModified() );
+}
+
+
+
+
+RenderCache::RenderCache() :
+	m_active( false ),
+	m_endTick( 0 ),
+	m_frames( 0 ),
+	m_requiredFrames( 0 )
+{
+}
+
+
+
+
+RenderCache::~RenderCache()
+{
+	finish( false );
+}
+
+
+
+
+bool RenderCache::isEnabled()
+{
+	return directory().isEmpty() == false;
+}
+
+
+
+
+void RenderCache::setDirectory( const QString & _dir )
+{
+	s_directory = _dir;
+	s_directorySet = true;
+}
+
+
+
+
+void RenderCache::setSizeLimit( qint64 _bytes )
+{
+	s_sizeLimit = _bytes;
+}
+
+
+
+
+QString RenderCache::directory()
+{
+	if( s_directorySet )
+	{
+		return s_directory;
+	}
+	return ConfigManager::inst()->value( "rendercache", "dir" );
+}
+
+
+
+
+qint64 RenderCache::sizeLimit()
+{
+	if( s_sizeLimit >= 0 )
+	{
+		return s_sizeLimit;
+	}
+	bool ok;
+	const qint64 mb = ConfigManager::inst()->value( "rendercache",
+						"sizelimit" ).toLongLong( &ok );
+	return ( ok ? mb : DefaultSizeLimit ) * 1024 * 1024;
+}
+
+
+
+
+void RenderCache::prepare()
+{
+	Song * song = Engine::getSong();
+	FxMixer * fxMixer = Engine::fxMixer();
+	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
+
+	song->updateLength();
+	const std::pair<MidiTime, MidiTime> endpoints =
+						song->getExportEndpoints();
+
+	// cache entries always start at the beginning of the song
+	if( endpoints.first.getTicks() != 0 ||
+				QDir().mkpath( directory() ) == false )
+	{
+		return;
+	}
+
+	m_active = true;
+	m_endTick = endpoints.second.getTicks();
+	m_requiredFrames = static_cast<f_cnt_t>(
+				m_endTick * Engine::framesPerTick() );
+	// ProjectRenderer renders one period before the actual export starts,
+	// plus the last period may exceed the end of the song
+	m_frames = m_requiredFrames + 2 * fpp;
+	m_globalKey = globalKey();
+
+	// collect what's feeding into each FX channel
+	for( Track * track : song->tracks() )
+	{
+		if( track->isMuted() )
+		{
+			continue;
+		}
+		if( track->type() == Track::InstrumentTrack )
+		{
+			TrackEntry e;
+			e.track = dynamic_cast<InstrumentTrack *>( track );
+			e.key = trackKey( track );
+			e.cache = NULL;
+			e.hit = false;
+			m_channelInputs[e.track->effectChannelModel()->value()] +=
+									e.key;
+			m_tracks.push_back( e );
+		}
+		else if( track->type() == Track::SampleTrack )
+		{
+			// sample tracks always play into the master channel
+			m_channelInputs[0] += trackKey( track );
+		}
+	}
+
+	m_channels.resize( fxMixer->numChannels() );
+	for( int i = 0; i < m_channels.size(); ++i )
+	{
+		m_channels[i].cache = NULL;
+		m_channels[i].hit = false;
+		m_channels[i].needed = false;
+		m_channels[i].neededValid = false;
+	}
+
+	for( int i = 0; i < m_channels.size(); ++i )
+	{
+		const QByteArray key = channelKey( i );
+		if( fxMixer->effectChannel( i )->m_muteModel.value() == false )
+		{
+			m_channels[i].cache = loadEntry( key, key );
+			m_channels[i].hit = m_channels[i].cache != NULL;
+		}
+	}
+
+	for( int i = 0; i < m_channels.size(); ++i )
+	{
+		FxChannel * ch = fxMixer->effectChannel( i );
+		ChannelEntry & e = m_channels[i];
+		if( isChannelNeeded( i ) == false )
+		{
+			// nothing we render depends on this channel
+			ch->m_skipped = true;
+		}
+		else if( e.hit )
+		{
+			ch->m_cachedOutput = e.cache;
+		}
+		else if( isChannelRendered( i ) )
+		{
+			e.cache = createEntry( e.key );
+			ch->m_outputCapture = e.cache;
+		}
+	}
+
+	for( TrackEntry & e : m_tracks )
+	{
+		if( isChannelRendered( e.track->effectChannelModel()->value() ) ==
+									false )
+		{
+			// the track's output would be dropped anyway
+			e.track->setMutedWithoutJournalling( true );
+			m_mutedTracks.push_back( e.track );
+			continue;
+		}
+
+		// frozen tracks are cheap already
+		if( e.track->isFrozen() )
+		{
+			continue;
+		}
+
+		e.cache = loadEntry( e.key, e.track->freezeStateHash() );
+		if( e.cache )
+		{
+			e.hit = true;
+			e.track->setFreezeCache( e.cache );
+		}
+		else
+		{
+			e.cache = createEntry( e.key );
+			e.track->audioPort()->setFreezeCapture( e.cache );
+		}
+	}
+}
+
+
+
+
+void RenderCache::finish( bool _completed )
+{
+	if( m_active == false )
+	{
+		return;
+	}
+	m_active = false;
+
+	FxMixer * fxMixer = Engine::fxMixer();
+	for( int i = 0; i < m_channels.size() &&
+					i < fxMixer->numChannels(); ++i )
+	{
+		FxChannel * ch = fxMixer->effectChannel( i );
+		ch->m_cachedOutput = NULL;
+		ch->m_outputCapture = NULL;
+		ch->m_skipped = false;
+
+		ChannelEntry & e = m_channels[i];
+		if( e.cache == NULL )
+		{
+			continue;
+		}
+		if( e.hit )
+		{
+			sharedObject::unref( e.cache );
+		}
+		else
+		{
+			commitEntry( e.key, e.cache, _completed );
+		}
+	}
+
+	for( TrackEntry & e : m_tracks )
+	{
+		if( e.cache == NULL )
+		{
+			continue;
+		}
+		if( e.hit )
+		{
+			e.track->unfreeze();
+			sharedObject::unref( e.cache );
+		}
+		else
+		{
+			e.track->audioPort()->setFreezeCapture( NULL );
+			commitEntry( e.key, e.cache, _completed );
+		}
+	}
+
+	for( Track * track : m_mutedTracks )
+	{
+		track->setMutedWithoutJournalling( false );
+	}
+
+	m_tracks.clear();
+	m_channels.clear();
+	m_channelInputs.clear();
+	m_mutedTracks.clear();
+
+	enforceSizeLimit();
+}
+
+
+
+
+QString RenderCache::fileName( const QByteArray & _key ) const
+{
+	return directory() + "/" + QString( _key.toHex() ) + ".cache";
+}
+
+
+
+
+QByteArray RenderCache::globalKey() const
+{
+	Song * song = Engine::getSong();
+	Mixer * mixer = Engine::mixer();
+
+	QDomDocument doc;
+	QDomElement element = doc.createElement( "rendercache" );
+	doc.appendChild( element );
+
+	element.setAttribute( "bpm", song->getTempo() );
+	element.setAttribute( "timesig_numerator",
+				song->getTimeSigModel().getNumerator() );
+	element.setAttribute( "timesig_denominator",
+				song->getTimeSigModel().getDenominator() );
+	element.setAttribute( "masterpitch", song->masterPitch() );
+	element.setAttribute( "samplerate", mixer->processingSampleRate() );
+	element.setAttribute( "interpolation",
+			mixer->currentQualitySettings().interpolation );
+	element.setAttribute( "oversampling",
+			mixer->currentQualitySettings().oversampling );
+	element.setAttribute( "fpp", mixer->framesPerPeriod() );
+	element.setAttribute( "endtick", m_endTick );
+
+	// everything that can influence tracks and channels from the outside:
+	// automation, beat/bassline tracks and controllers
+	for( Track * track : song->tracks() )
+	{
+		if( track->type() != Track::InstrumentTrack &&
+				track->type() != Track::SampleTrack )
+		{
+			QDomElement trackElement = doc.createElement( "track" );
+			element.appendChild( trackElement );
+			track->saveSettings( doc, trackElement );
+		}
+	}
+
+	QDomElement globalAutomation = doc.createElement( "track" );
+	element.appendChild( globalAutomation );
+	song->globalAutomationTrack()->saveSettings( doc, globalAutomation );
+
+	QDomElement bbElement = doc.createElement( "bbtrackcontainer" );
+	element.appendChild( bbElement );
+	Engine::getBBTrackContainer()->saveSettings( doc, bbElement );
+
+	for( Controller * controller : song->controllers() )
+	{
+		QDomElement controllerElement =
+				doc.createElement( controller->nodeName() );
+		element.appendChild( controllerElement );
+		controller->saveSettings( doc, controllerElement );
+	}
+
+	return FreezeCache::hashState( doc );
+}
+
+
+
+
+QByteArray RenderCache::trackKey( Track * _track ) const
+{
+	QDomDocument doc;
+	QDomElement element = doc.createElement( "track" );
+	doc.appendChild( element );
+	_track->saveSettings( doc, element );
+
+	// these don't change what the track sounds like
+	element.removeAttribute( "name" );
+	element.removeAttribute( "muted" );
+	element.removeAttribute( "solo" );
+	element.removeAttribute( "height" );
+
+	element.setAttribute( "global", QString( m_globalKey.toHex() ) );
+
+	return FreezeCache::hashState( doc );
+}
+
+
+
+
+QByteArray RenderCache::channelKey( int _ch )
+{
+	if( m_channels[_ch].key.isEmpty() == false )
+	{
+		return m_channels[_ch].key;
+	}
+
+	FxChannel * ch = Engine::fxMixer()->effectChannel( _ch );
+
+	QDomDocument doc;
+	QDomElement element = doc.createElement( "fxchannel" );
+	doc.appendChild( element );
+	element.setAttribute( "global", QString( m_globalKey.toHex() ) );
+
+	QDomElement chainElement = doc.createElement( ch->m_fxChain.nodeName() );
+	element.appendChild( chainElement );
+	ch->m_fxChain.saveSettings( doc, chainElement );
+
+	// the order tracks are mixed in doesn't matter
+	QVector<QByteArray> inputs = m_channelInputs.value( _ch );
+	qSort( inputs );
+	for( const QByteArray & input : inputs )
+	{
+		QDomElement inputElement = doc.createElement( "track" );
+		element.appendChild( inputElement );
+		inputElement.setAttribute( "key", QString( input.toHex() ) );
+	}
+
+	// FX routing can't contain loops, so this recursion terminates
+	for( FxRoute * route : ch->m_receives )
+	{
+		FxChannel * sender = route->sender();
+		QDomElement receiveElement = doc.createElement( "receive" );
+		element.appendChild( receiveElement );
+		receiveElement.setAttribute( "key",
+			QString( channelKey( route->senderIndex() ).toHex() ) );
+		sender->m_volumeModel.saveSettings( doc, receiveElement, "volume" );
+		sender->m_muteModel.saveSettings( doc, receiveElement, "muted" );
+		route->amount()->saveSettings( doc, receiveElement, "amount" );
+	}
+
+	m_channels[_ch].key = FreezeCache::hashState( doc );
+	return m_channels[_ch].key;
+}
+
+
+
+
+bool RenderCache::isChannelNeeded( int _ch )
+{
+	if( m_channels[_ch].neededValid == false )
+	{
+		bool needed = _ch == 0;
+		for( FxRoute * route :
+			Engine::fxMixer()->effectChannel( _ch )->m_sends )
+		{
+			if( isChannelRendered( route->receiverIndex() ) )
+			{
+				needed = true;
+			}
+		}
+		m_channels[_ch].needed = needed;
+		m_channels[_ch].neededValid = true;
+	}
+	return m_channels[_ch].needed;
+}
+
+
+
+
+bool RenderCache::isChannelRendered( int _ch )
+{
+	return isChannelNeeded( _ch ) && m_channels[_ch].hit == false &&
+		Engine::fxMixer()->effectChannel( _ch )->m_muteModel.value() ==
+									false;
+}
+
+
+
+
+FreezeCache * RenderCache::loadEntry( const QByteArray & _key,
+						const QByteArray & _stateHash )
+{
+	const QString file = fileName( _key );
+	if( QFileInfo( file ).exists() == false )
+	{
+		return NULL;
+	}
+
+	FreezeCache * cache = new FreezeCache;
+	if( cache->load( file, Engine::mixer()->processingSampleRate(),
+							_stateHash ) == false ||
+						cache->frames() != m_frames )
+	{
+		sharedObject::unref( cache );
+		QFile::remove( file );
+		return NULL;
+	}
+	return cache;
+}
+
+
+
+
+FreezeCache * RenderCache::createEntry( const QByteArray & _key )
+{
+	FreezeCache * cache = new FreezeCache;
+	if( cache->allocate( m_frames, Engine::mixer()->processingSampleRate(),
+				_key, fileName( _key ) + ".part" ) == false )
+	{
+		sharedObject::unref( cache );
+		return NULL;
+	}
+	return cache;
+}
+
+
+
+
+void RenderCache::commitEntry( const QByteArray & _key, FreezeCache * _cache,
+							bool _completed )
+{
+	const bool complete = _completed &&
+				_cache->framesWritten() >= m_requiredFrames;
+
+	// closes the file
+	sharedObject::unref( _cache );
+
+	const QString file = fileName( _key );
+	if( complete )
+	{
+		QFile::remove( file );
+		QFile::rename( file + ".part", file );
+	}
+	else
+	{
+		QFile::remove( file + ".part" );
+	}
+}
+
+
+
+
+void RenderCache::enforceSizeLimit()
+{
+	QFileInfoList files = QDir( directory() ).entryInfoList(
+				QStringList( "*.cache" ), QDir::Files );
+	qSort( files.begin(), files.end(), lastUsedAfter );
+
+	const qint64 limit = sizeLimit();
+	qint64 total = 0;
+	for( const QFileInfo & file : files )
+	{
+		total += file.size();
+		if( total > limit )
+		{
+			QFile::remove( file.absoluteFilePath() );
+		}
+	}
+}
@@ -37,6 +37,7 @@ RingBuffer::RingBuffer( f_cnt_t size ) :
 	m_buffer = new sampleFrame[ m_size ];
 	memset( m_buffer, 0, m_size * sizeof( sampleFrame ) );
 	m_position = 0;
+	connect( Engine::mixer(), SIGNAL( framesPerPeriodChanged() ), this, SLOT( updateFramesPerPeriod() ) );
 }
 
 
@@ -49,6 +50,7 @@ RingBuffer::RingBuffer( float size ) :
 	memset( m_buffer, 0, m_size * sizeof( sampleFrame ) );
 	m_position = 0;
 	setSamplerateAware( true );
+	connect( Engine::mixer(), SIGNAL( framesPerPeriodChanged() ), this, SLOT( updateFramesPerPeriod() ) );
 	//qDebug( "m_size %d, m_position %d", m_size, m_position );
 }
 
@@ -314,3 +316,10 @@ void RingBuffer::updateSamplerate()
 }
 
 
+void RingBuffer::updateFramesPerPeriod()
+{
+	// the buffer always holds one period more than requested
+	const f_cnt_t size = m_size - m_fpp;
+	m_fpp = Engine::mixer()->framesPerPeriod();
+	changeSize( size );
+}
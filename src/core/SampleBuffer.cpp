@@ -29,7 +29,9 @@
 #include <QFile>
 #include <QFileInfo>
 #include <QMessageBox>
+#include <QMutex>
 #include <QPainter>
+#include <QVector>
 
 
 #include <sndfile.h>
@@ -50,11 +52,14 @@
 
 #include "base64.h"
 #include "ConfigManager.h"
+#include "DataFile.h"
 #include "DrumSynth.h"
 #include "endian_handling.h"
 #include "Engine.h"
 #include "GuiApplication.h"
 #include "Mixer.h"
+#include "SampleDataCache.h"
+#include "SampleDiskCache.h"
 
 #include "FileDialog.h"
 
@@ -63,9 +68,8 @@ SampleBuffer::SampleBuffer( const QString & _audio_file,
 							bool _is_base64_data ) :
 	m_audioFile( ( _is_base64_data == true ) ? "" : _audio_file ),
 	m_origData( NULL ),
-	m_origFrames( 0 ),
-	m_data( NULL ),
-	m_frames( 0 ),
+	m_sampleData( NULL ),
+	m_streamingEnabled( false ),
 	m_startFrame( 0 ),
 	m_endFrame( 0 ),
 	m_loopStartFrame( 0 ),
@@ -89,9 +93,8 @@ SampleBuffer::SampleBuffer( const QString & _audio_file,
 SampleBuffer::SampleBuffer( const sampleFrame * _data, const f_cnt_t _frames ) :
 	m_audioFile( "" ),
 	m_origData( NULL ),
-	m_origFrames( 0 ),
-	m_data( NULL ),
-	m_frames( 0 ),
+	m_sampleData( NULL ),
+	m_streamingEnabled( false ),
 	m_startFrame( 0 ),
 	m_endFrame( 0 ),
 	m_loopStartFrame( 0 ),
@@ -101,12 +104,7 @@ SampleBuffer::SampleBuffer( const sampleFrame * _data, const f_cnt_t _frames ) :
 	m_frequency( BaseFreq ),
 	m_sampleRate( mixerSampleRate () )
 {
-	if( _frames > 0 )
-	{
-		m_origData = MM_ALLOC( sampleFrame, _frames );
-		memcpy( m_origData, _data, _frames * BYTES_PER_FRAME );
-		m_origFrames = _frames;
-	}
+	setOrigData( _data, _frames );
 	connect( Engine::mixer(), SIGNAL( sampleRateChanged() ), this, SLOT( sampleRateChanged() ) );
 	update();
 }
@@ -117,9 +115,8 @@ SampleBuffer::SampleBuffer( const sampleFrame * _data, const f_cnt_t _frames ) :
 SampleBuffer::SampleBuffer( const f_cnt_t _frames ) :
 	m_audioFile( "" ),
 	m_origData( NULL ),
-	m_origFrames( 0 ),
-	m_data( NULL ),
-	m_frames( 0 ),
+	m_sampleData( NULL ),
+	m_streamingEnabled( false ),
 	m_startFrame( 0 ),
 	m_endFrame( 0 ),
 	m_loopStartFrame( 0 ),
@@ -131,9 +128,9 @@ SampleBuffer::SampleBuffer( const f_cnt_t _frames ) :
 {
 	if( _frames > 0 )
 	{
-		m_origData = MM_ALLOC( sampleFrame, _frames );
-		memset( m_origData, 0, _frames * BYTES_PER_FRAME );
-		m_origFrames = _frames;
+		sampleFrame * data = MM_ALLOC( sampleFrame, _frames );
+		memset( data, 0, _frames * BYTES_PER_FRAME );
+		m_origData = new SampleData( data, _frames );
 	}
 	connect( Engine::mixer(), SIGNAL( sampleRateChanged() ), this, SLOT( sampleRateChanged() ) );
 	update();
@@ -144,8 +141,14 @@ SampleBuffer::SampleBuffer( const f_cnt_t _frames ) :
 
 SampleBuffer::~SampleBuffer()
 {
-	MM_FREE( m_origData );
-	MM_FREE( m_data );
+	if( m_origData )
+	{
+		sharedObject::unref( m_origData );
+	}
+	if( sampleData() )
+	{
+		sharedObject::unref( sampleData() );
+	}
 }
 
 
@@ -163,129 +166,52 @@ sample_rate_t SampleBuffer::mixerSampleRate()
 
 void SampleBuffer::update( bool _keep_settings )
 {
-	const bool lock = ( m_data != NULL );
-	if( lock )
-	{
-		Engine::mixer()->requestChangeInModel();
-		m_varLock.lockForWrite();
-		MM_FREE( m_data );
-	}
-
-	// File size and sample length limits
-	const int fileSizeMax = 300; // MB
-	const int sampleLengthMax = 90; // Minutes
+	// the sample is decoded into new data without locking anything, so the
+	// mixer keeps playing the current data meanwhile
+	SampleData * sampleData = NULL;
 
 	bool fileLoadError = false;
-	if( m_audioFile.isEmpty() && m_origData != NULL && m_origFrames > 0 )
+	if( m_audioFile.isEmpty() && m_origData != NULL )
 	{
 		// TODO: reverse- and amplification-property is not covered
 		// by following code...
-		m_data = MM_ALLOC( sampleFrame, m_origFrames );
-		memcpy( m_data, m_origData, m_origFrames * BYTES_PER_FRAME );
-		if( _keep_settings == false )
-		{
-			m_frames = m_origFrames;
-			m_loopStartFrame = m_startFrame = 0;
-			m_loopEndFrame = m_endFrame = m_frames;
-		}
+		sampleData = sharedObject::ref( m_origData );
 	}
 	else if( !m_audioFile.isEmpty() )
 	{
-		QString file = tryToMakeAbsolute( m_audioFile );
-		int_sample_t * buf = NULL;
-		sample_t * fbuf = NULL;
-		ch_cnt_t channels = DEFAULT_CHANNELS;
-		sample_rate_t samplerate = mixerSampleRate();
-		m_frames = 0;
-
-		const QFileInfo fileInfo( file );
-		if( fileInfo.size() > fileSizeMax * 1024 * 1024 )
-		{
-			fileLoadError = true;
-		}
-		else
-		{
-			// Use QFile to handle unicode file names on Windows
-			QFile f(file);
-			f.open(QIODevice::ReadOnly);
-			SNDFILE * snd_file;
-			SF_INFO sf_info;
-			sf_info.format = 0;
-			if( ( snd_file = sf_open_fd( f.handle(), SFM_READ, &sf_info, false ) ) != NULL )
-			{
-				f_cnt_t frames = sf_info.frames;
-				int rate = sf_info.samplerate;
-				if( frames / rate > sampleLengthMax * 60 )
-				{
-					fileLoadError = true;
-				}
-				sf_close( snd_file );
-			}
-			f.close();
-		}
+		const QString file = tryToMakeAbsolute( m_audioFile );
 
-		if( !fileLoadError )
+		// long files are played from disk, so neither their size nor
+		// their length matters
+		if( m_streamingEnabled && streamsFile( file ) )
 		{
-#ifdef LMMS_HAVE_OGGVORBIS
-			// workaround for a bug in libsndfile or our libsndfile decoder
-			// causing some OGG files to be distorted -> try with OGG Vorbis
-			// decoder first if filename extension matches "ogg"
-			if( m_frames == 0 && fileInfo.suffix() == "ogg" )
+			SampleStream * stream = SampleStream::open( file,
+							mixerSampleRate() );
+			if( stream != NULL )
 			{
-				m_frames = decodeSampleOGGVorbis( file, buf, channels, samplerate );
-			}
-#endif
-			if( m_frames == 0 )
-			{
-				m_frames = decodeSampleSF( file, fbuf, channels,
-									samplerate );
-			}
-#ifdef LMMS_HAVE_OGGVORBIS
-			if( m_frames == 0 )
-			{
-				m_frames = decodeSampleOGGVorbis( file, buf, channels,
-									samplerate );
-			}
-#endif
-			if( m_frames == 0 )
-			{
-				m_frames = decodeSampleDS( file, buf, channels,
-									samplerate );
+				sampleData = new SampleData( stream );
 			}
 		}
-
-		if ( m_frames == 0 || fileLoadError )  // if still no frames, bail
+		if( sampleData == NULL )
 		{
-			// sample couldn't be decoded, create buffer containing
-			// one sample-frame
-			m_data = MM_ALLOC( sampleFrame, 1 );
-			memset( m_data, 0, sizeof( *m_data ) );
-			m_frames = 1;
-			m_loopStartFrame = m_startFrame = 0;
-			m_loopEndFrame = m_endFrame = 1;
-		}
-		else // otherwise normalize sample rate
-		{
-			normalizeSampleRate( samplerate, _keep_settings );
+			sampleData = decodeFile( file, mixerSampleRate(),
+						m_reversed, &fileLoadError );
 		}
 	}
-	else
-	{
-		// neither an audio-file nor a buffer to copy from, so create
-		// buffer containing one sample-frame
-		m_data = MM_ALLOC( sampleFrame, 1 );
-		memset( m_data, 0, sizeof( *m_data ) );
-		m_frames = 1;
-		m_loopStartFrame = m_startFrame = 0;
-		m_loopEndFrame = m_endFrame = 1;
-	}
 
-	if( lock )
+	if( sampleData == NULL )
 	{
-		m_varLock.unlock();
-		Engine::mixer()->doneChangeInModel();
+		// sample couldn't be decoded or there's neither an audio-file
+		// nor a buffer to copy from, so create buffer containing one
+		// sample-frame
+		sampleFrame * data = MM_ALLOC( sampleFrame, 1 );
+		memset( data, 0, sizeof( *data ) );
+		sampleData = new SampleData( data, 1 );
+		_keep_settings = false;
 	}
 
+	setSampleData( sampleData, _keep_settings );
+
 	emit sampleUpdated();
 
 	if( fileLoadError )
@@ -293,7 +219,7 @@ void SampleBuffer::update( bool _keep_settings )
 		QString title = tr( "Fail to open file" );
 		QString message = tr( "Audio files are limited to %1 MB "
 				"in size and %2 minutes of playing time"
-				).arg( fileSizeMax ).arg( sampleLengthMax );
+				).arg( FileSizeMax ).arg( SampleLengthMax );
 		if( gui )
 		{
 			QMessageBox::information( NULL,
@@ -307,24 +233,204 @@ void SampleBuffer::update( bool _keep_settings )
 }
 
 
-void SampleBuffer::convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames, int _channels)
+
+
+SampleData * SampleBuffer::decodeFile( const QString & _file,
+					sample_rate_t _sample_rate, bool _reversed,
+						bool * _limit_exceeded )
+{
+	// other SampleBuffers may have decoded the file already
+	const QString cacheKey = SampleDataCache::fileKey( _file, _sample_rate,
+								_reversed );
+	SampleData * cached = SampleDataCache::acquire( cacheKey );
+	if( cached != NULL )
+	{
+		return cached;
+	}
+
+	// ... or in a previous session
+	SampleData * stored = SampleDiskCache::load( _file, _sample_rate,
+								_reversed );
+	if( stored != NULL )
+	{
+		return SampleDataCache::insert( cacheKey, stored );
+	}
+
+	bool limitExceeded = false;
+	const QFileInfo fileInfo( _file );
+	if( fileInfo.size() > FileSizeMax * 1024 * 1024 )
+	{
+		limitExceeded = true;
+	}
+	else
+	{
+		// Use QFile to handle unicode file names on Windows
+		QFile f(_file);
+		f.open(QIODevice::ReadOnly);
+		SNDFILE * snd_file;
+		SF_INFO sf_info;
+		sf_info.format = 0;
+		if( ( snd_file = sf_open_fd( f.handle(), SFM_READ, &sf_info, false ) ) != NULL )
+		{
+			f_cnt_t frames = sf_info.frames;
+			int rate = sf_info.samplerate;
+			if( frames / rate > SampleLengthMax * 60 )
+			{
+				limitExceeded = true;
+			}
+			sf_close( snd_file );
+		}
+		f.close();
+	}
+	if( _limit_exceeded )
+	{
+		*_limit_exceeded = limitExceeded;
+	}
+	if( limitExceeded )
+	{
+		return NULL;
+	}
+
+	sampleFrame * data = NULL;
+	f_cnt_t frames = 0;
+	ch_cnt_t channels = DEFAULT_CHANNELS;
+	sample_rate_t samplerate = _sample_rate;
+
+#ifdef LMMS_HAVE_OGGVORBIS
+	// workaround for a bug in libsndfile or our libsndfile decoder
+	// causing some OGG files to be distorted -> try with OGG Vorbis
+	// decoder first if filename extension matches "ogg"
+	if( frames == 0 && fileInfo.suffix() == "ogg" )
+	{
+		frames = decodeSampleOGGVorbis( _file, data, channels, samplerate,
+								_reversed );
+	}
+#endif
+	if( frames == 0 )
+	{
+		frames = decodeSampleSF( _file, data, channels, samplerate,
+								_reversed );
+	}
+#ifdef LMMS_HAVE_OGGVORBIS
+	if( frames == 0 )
+	{
+		frames = decodeSampleOGGVorbis( _file, data, channels, samplerate,
+								_reversed );
+	}
+#endif
+	if( frames == 0 )
+	{
+		frames = decodeSampleDS( _file, data, channels, samplerate,
+								_reversed );
+	}
+
+	if( frames == 0 )
+	{
+		MM_FREE( data );
+		return NULL;
+	}
+
+	// do samplerate-conversion to our default-samplerate
+	if( samplerate != _sample_rate )
+	{
+		const f_cnt_t dst_frames = static_cast<f_cnt_t>( frames /
+				(float) samplerate * (float) _sample_rate );
+		sampleFrame * resampled = MM_ALLOC( sampleFrame, dst_frames );
+		resampleFrames( data, frames, resampled, dst_frames,
+						samplerate, _sample_rate );
+		MM_FREE( data );
+		data = resampled;
+		frames = dst_frames;
+	}
+
+	SampleData * sampleData = new SampleData( data, frames );
+	SampleDiskCache::store( _file, _sample_rate, _reversed, sampleData );
+
+	return SampleDataCache::insert( cacheKey, sampleData );
+}
+
+
+
+
+bool SampleBuffer::streamsFile( const QString & _file )
+{
+	return SampleStream::fileLength( _file ) > StreamingThreshold;
+}
+
+
+
+
+void SampleBuffer::setOrigData( const sampleFrame * _data, f_cnt_t _frames )
+{
+	if( m_origData )
+	{
+		sharedObject::unref( m_origData );
+		m_origData = NULL;
+	}
+	if( _frames <= 0 )
+	{
+		return;
+	}
+
+	// identical frames, e.g. the same embedded sample or patch loaded
+	// several times, are only held once
+	const QString key = SampleDataCache::dataKey( _data, _frames );
+	m_origData = SampleDataCache::acquire( key );
+	if( m_origData == NULL )
+	{
+		sampleFrame * data = MM_ALLOC( sampleFrame, _frames );
+		memcpy( data, _data, _frames * BYTES_PER_FRAME );
+		m_origData = SampleDataCache::insert( key,
+					new SampleData( data, _frames ) );
+	}
+}
+
+
+
+
+void SampleBuffer::setSampleData( SampleData * _data, bool _keep_settings )
+{
+	// GUI readers hold the read lock while accessing the data
+	m_varLock.lockForWrite();
+	SampleData * old = m_sampleData.fetchAndStoreOrdered( _data );
+	if( _keep_settings == false )
+	{
+		// update frame-variables
+		m_loopStartFrame = m_startFrame = 0;
+		m_loopEndFrame = m_endFrame = _data->frames();
+	}
+	m_varLock.unlock();
+
+	if( old != NULL )
+	{
+		// the mixer doesn't lock anything while playing, so it might
+		// still read the old data in the current period - once it has
+		// finished that period, nobody can hold a pointer to it anymore
+		Engine::mixer()->requestChangeInModel();
+		Engine::mixer()->doneChangeInModel();
+		sharedObject::unref( old );
+	}
+}
+
+
+sampleFrame * SampleBuffer::convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames, int _channels, bool _reversed )
 {
 	// following code transforms int-samples into
 	// float-samples and does amplifying & reversing
 	const float fac = 1 / OUTPUT_SAMPLE_MULTIPLIER;
-	m_data = MM_ALLOC( sampleFrame, _frames );
+	sampleFrame * data = MM_ALLOC( sampleFrame, _frames );
 	const int ch = ( _channels > 1 ) ? 1 : 0;
 
 	// if reversing is on, we also reverse when
 	// scaling
-	if( m_reversed )
+	if( _reversed )
 	{
 		int idx = ( _frames - 1 ) * _channels;
 		for( f_cnt_t frame = 0; frame < _frames;
 						++frame )
 		{
-			m_data[frame][0] = _ibuf[idx+0] * fac;
-			m_data[frame][1] = _ibuf[idx+ch] * fac;
+			data[frame][0] = _ibuf[idx+0] * fac;
+			data[frame][1] = _ibuf[idx+ch] * fac;
 			idx -= _channels;
 		}
 	}
@@ -334,32 +440,34 @@ void SampleBuffer::convertIntToFloat ( int_sample_t * & _ibuf, f_cnt_t _frames,
 		for( f_cnt_t frame = 0; frame < _frames;
 						++frame )
 		{
-			m_data[frame][0] = _ibuf[idx+0] * fac;
-			m_data[frame][1] = _ibuf[idx+ch] * fac;
+			data[frame][0] = _ibuf[idx+0] * fac;
+			data[frame][1] = _ibuf[idx+ch] * fac;
 			idx += _channels;
 		}
 	}
 
 	delete[] _ibuf;
+
+	return data;
 }
 
-void SampleBuffer::directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _channels)
+sampleFrame * SampleBuffer::directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _channels, bool _reversed )
 
 {
 
-	m_data = MM_ALLOC( sampleFrame, _frames );
+	sampleFrame * data = MM_ALLOC( sampleFrame, _frames );
 	const int ch = ( _channels > 1 ) ? 1 : 0;
 
 	// if reversing is on, we also reverse when
 	// scaling
-	if( m_reversed )
+	if( _reversed )
 	{
 		int idx = ( _frames - 1 ) * _channels;
 		for( f_cnt_t frame = 0; frame < _frames;
 						++frame )
 		{
-			m_data[frame][0] = _fbuf[idx+0];
-			m_data[frame][1] = _fbuf[idx+ch];
+			data[frame][0] = _fbuf[idx+0];
+			data[frame][1] = _fbuf[idx+ch];
 			idx -= _channels;
 		}
 	}
@@ -369,37 +477,38 @@ void SampleBuffer::directFloatWrite ( sample_t * & _fbuf, f_cnt_t _frames, int _
 		for( f_cnt_t frame = 0; frame < _frames;
 						++frame )
 		{
-			m_data[frame][0] = _fbuf[idx+0];
-			m_data[frame][1] = _fbuf[idx+ch];
+			data[frame][0] = _fbuf[idx+0];
+			data[frame][1] = _fbuf[idx+ch];
 			idx += _channels;
 		}
 	}
 
 	delete[] _fbuf;
+
+	return data;
 }
 
 
 void SampleBuffer::normalizeSampleRate( const sample_rate_t _src_sr,
 							bool _keep_settings )
 {
-	// do samplerate-conversion to our default-samplerate
-	if( _src_sr != mixerSampleRate() )
+	// do samplerate-conversion to our default-samplerate - streams are
+	// decoded at that rate already
+	if( _src_sr != mixerSampleRate() && !isStreamed() )
 	{
 		SampleBuffer * resampled = resample( _src_sr,
 					mixerSampleRate() );
-		MM_FREE( m_data );
-		m_frames = resampled->frames();
-		m_data = MM_ALLOC( sampleFrame, m_frames );
-		memcpy( m_data, resampled->data(), m_frames *
+		const f_cnt_t frames = resampled->frames();
+		sampleFrame * data = MM_ALLOC( sampleFrame, frames );
+		memcpy( data, resampled->data(), frames *
 							sizeof( sampleFrame ) );
-		delete resampled;
+		sharedObject::unref( resampled );
+		setSampleData( new SampleData( data, frames ), _keep_settings );
 	}
-
-	if( _keep_settings == false )
+	else if( _keep_settings == false )
 	{
-		// update frame-variables
 		m_loopStartFrame = m_startFrame = 0;
-		m_loopEndFrame = m_endFrame = m_frames;
+		m_loopEndFrame = m_endFrame = frames();
 	}
 }
 
@@ -407,10 +516,12 @@ void SampleBuffer::normalizeSampleRate( const sample_rate_t _src_sr,
 
 
 f_cnt_t SampleBuffer::decodeSampleSF(QString _f,
-					sample_t * & _buf,
+					sampleFrame * & _data,
 					ch_cnt_t & _channels,
-					sample_rate_t & _samplerate )
+					sample_rate_t & _samplerate,
+						bool _reversed )
 {
+	sample_t * buf = NULL;
 	SNDFILE * snd_file;
 	SF_INFO sf_info;
 	sf_info.format = 0;
@@ -425,8 +536,8 @@ f_cnt_t SampleBuffer::decodeSampleSF(QString _f,
 	{
 		frames = sf_info.frames;
 
-		_buf = new sample_t[sf_info.channels * frames];
-		sf_rr = sf_read_float( snd_file, _buf, sf_info.channels * frames );
+		buf = new sample_t[sf_info.channels * frames];
+		sf_rr = sf_read_float( snd_file, buf, sf_info.channels * frames );
 
 		if( sf_rr < sf_info.channels * frames )
 		{
@@ -451,9 +562,9 @@ f_cnt_t SampleBuffer::decodeSampleSF(QString _f,
 
 	//write down either directly or convert i->f depending on file type
 
-	if ( frames > 0 && _buf != NULL )
+	if ( frames > 0 && buf != NULL )
 	{
-		directFloatWrite ( _buf, frames, _channels);
+		_data = directFloatWrite ( buf, frames, _channels, _reversed );
 	}
 
 	return frames;
@@ -515,9 +626,10 @@ long qfileTellCallback( void * _udata )
 
 
 f_cnt_t SampleBuffer::decodeSampleOGGVorbis( QString _f,
-						int_sample_t * & _buf,
+						sampleFrame * & _data,
 						ch_cnt_t & _channels,
-						sample_rate_t & _samplerate )
+						sample_rate_t & _samplerate,
+						bool _reversed )
 {
 	static ov_callbacks callbacks =
 	{
@@ -576,13 +688,13 @@ f_cnt_t SampleBuffer::decodeSampleOGGVorbis( QString _f,
 
 	ogg_int64_t total = ov_pcm_total( &vf, -1 );
 
-	_buf = new int_sample_t[total * _channels];
+	int_sample_t * buf = new int_sample_t[total * _channels];
 	int bitstream = 0;
 	long bytes_read = 0;
 
 	do
 	{
-		bytes_read = ov_read( &vf, (char *) &_buf[frames * _channels],
+		bytes_read = ov_read( &vf, (char *) &buf[frames * _channels],
 					( total - frames ) * _channels *
 							BYTES_PER_INT_SAMPLE,
 					isLittleEndian() ? 0 : 1,
@@ -598,9 +710,13 @@ f_cnt_t SampleBuffer::decodeSampleOGGVorbis( QString _f,
 	ov_clear( &vf );
 	// if buffer isn't empty, convert it to float and write it down
 
-	if ( frames > 0 && _buf != NULL )
+	if ( frames > 0 && buf != NULL )
 	{
-		convertIntToFloat ( _buf, frames, _channels);
+		_data = convertIntToFloat ( buf, frames, _channels, _reversed );
+	}
+	else
+	{
+		delete[] buf;
 	}
 
 	return frames;
@@ -611,16 +727,23 @@ f_cnt_t SampleBuffer::decodeSampleOGGVorbis( QString _f,
 
 
 f_cnt_t SampleBuffer::decodeSampleDS( QString _f,
-						int_sample_t * & _buf,
+						sampleFrame * & _data,
 						ch_cnt_t & _channels,
-						sample_rate_t & _samplerate )
+						sample_rate_t & _samplerate,
+						bool _reversed )
 {
+	// DrumSynth keeps its state in global variables, so only one file
+	// can be decoded at a time
+	static QMutex dsMutex;
+	QMutexLocker lock( &dsMutex );
+
+	int_sample_t * buf = NULL;
 	DrumSynth ds;
-	f_cnt_t frames = ds.GetDSFileSamples( _f, _buf, _channels, _samplerate );
+	f_cnt_t frames = ds.GetDSFileSamples( _f, buf, _channels, _samplerate );
 
-	if ( frames > 0 && _buf != NULL )
+	if ( frames > 0 && buf != NULL )
 	{
-		convertIntToFloat ( _buf, frames, _channels);
+		_data = convertIntToFloat ( buf, frames, _channels, _reversed );
 	}
 
 	return frames;
@@ -635,10 +758,16 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 					const float _freq,
 					const LoopMode _loopmode )
 {
-	f_cnt_t startFrame = m_startFrame;
-	f_cnt_t endFrame = m_endFrame;
-	f_cnt_t loopStartFrame = m_loopStartFrame;
-	f_cnt_t loopEndFrame = m_loopEndFrame;
+	// the data may be replaced at any time, but not before this period is
+	// over - the frame-variables may still refer to the previous data
+	// though, so keep them within bounds
+	const SampleData * sampleData = this->sampleData();
+	const f_cnt_t frames = sampleData->frames();
+
+	f_cnt_t endFrame = qMin( m_endFrame, frames );
+	f_cnt_t startFrame = qMin( m_startFrame, endFrame );
+	f_cnt_t loopEndFrame = qMin( m_loopEndFrame, frames );
+	f_cnt_t loopStartFrame = qMin( m_loopStartFrame, loopEndFrame );
 
 	if( endFrame == 0 || _frames == 0 )
 	{
@@ -682,17 +811,55 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 		play_frame = getPingPongIndex( play_frame, loopStartFrame, loopEndFrame );
 	}
 
-	f_cnt_t fragment_size = (f_cnt_t)( _frames * freq_factor ) + MARGIN[ _state->interpolationMode() ];
+	// check whether we have to change pitch...
+	if( ( freq_factor != 1.0 || _state->m_varyingPitch ) &&
+					_state->m_resamplingData == NULL )
+	{
+		// the built-in interpolator reads a few frames before the
+		// current position, which are kept in the handle state - put
+		// them in front of the fragment
+		const SampleInterpolator::Qualities quality =
+					_state->m_interpolatorQuality;
+		const f_cnt_t history =
+				SampleInterpolator::historyFrames( quality );
+		const f_cnt_t fragment_frames =
+			SampleInterpolator::inputFrames( quality, _frames,
+				freq_factor, _state->m_interpolatorPosition );
+		sampleFrame * buf = _state->fragmentBuffer( history +
+							fragment_frames );
+		memcpy( buf, _state->m_interpolatorHistory,
+						history * BYTES_PER_FRAME );
+
+		const sampleFrame * fragment = getSampleFragment( sampleData,
+				play_frame, fragment_frames, _loopmode,
+				buf + history, &is_backwards, loopStartFrame,
+						loopEndFrame, endFrame );
+		if( history > 0 && fragment != buf + history )
+		{
+			memcpy( buf + history, fragment,
+					fragment_frames * BYTES_PER_FRAME );
+			fragment = buf + history;
+		}
 
-	sampleFrame * tmp = NULL;
+		const f_cnt_t used = SampleInterpolator::process( quality,
+					fragment, _ab, _frames, freq_factor,
+					&_state->m_interpolatorPosition );
+		memcpy( _state->m_interpolatorHistory, fragment + used - history,
+						history * BYTES_PER_FRAME );
 
-	// check whether we have to change pitch...
-	if( freq_factor != 1.0 || _state->m_varyingPitch )
+		play_frame = advance( play_frame, used, _loopmode,
+					_state->isBackwards(), loopStartFrame,
+								loopEndFrame );
+	}
+	else if( freq_factor != 1.0 || _state->m_varyingPitch )
 	{
+		f_cnt_t fragment_size = (f_cnt_t)( _frames * freq_factor ) + MARGIN[ _state->interpolationMode() ];
+
 		SRC_DATA src_data;
 		// Generate output
 		src_data.data_in =
-			getSampleFragment( play_frame, fragment_size, _loopmode, &tmp, &is_backwards,
+			getSampleFragment( sampleData, play_frame, fragment_size, _loopmode,
+			_state->fragmentBuffer( fragment_size ), &is_backwards,
 			loopStartFrame, loopEndFrame, endFrame )[0];
 		src_data.data_out = _ab[0];
 		src_data.input_frames = fragment_size;
@@ -711,78 +878,28 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 			printf( "SampleBuffer: not enough frames: %ld / %d\n",
 					src_data.output_frames_gen, _frames );
 		}
-		// Advance
-		switch( _loopmode )
-		{
-			case LoopOff:
-				play_frame += src_data.input_frames_used;
-				break;
-			case LoopOn:
-				play_frame += src_data.input_frames_used;
-				play_frame = getLoopedIndex( play_frame, loopStartFrame, loopEndFrame );
-				break;
-			case LoopPingPong:
-			{
-				f_cnt_t left = src_data.input_frames_used;
-				if( _state->isBackwards() )
-				{
-					play_frame -= src_data.input_frames_used;
-					if( play_frame < loopStartFrame )
-					{
-						left -= ( loopStartFrame - play_frame );
-						play_frame = loopStartFrame;
-					}
-					else left = 0;
-				}
-				play_frame += left;
-				play_frame = getPingPongIndex( play_frame, loopStartFrame, loopEndFrame  );
-				break;
-			}
-		}
+		play_frame = advance( play_frame, src_data.input_frames_used,
+					_loopmode, _state->isBackwards(),
+					loopStartFrame, loopEndFrame );
 	}
 	else
 	{
 		// we don't have to pitch, so we just copy the sample-data
-		// as is into pitched-copy-buffer
+		// as is into pitched-copy-buffer - fragments crossing a loop
+		// boundary are assembled in the output buffer directly
 
 		// Generate output
-		memcpy( _ab,
-			getSampleFragment( play_frame, _frames, _loopmode, &tmp, &is_backwards,
-						loopStartFrame, loopEndFrame, endFrame ),
-						_frames * BYTES_PER_FRAME );
-		// Advance
-		switch( _loopmode )
+		const sampleFrame * fragment = getSampleFragment( sampleData,
+					play_frame, _frames, _loopmode, _ab,
+					&is_backwards, loopStartFrame, loopEndFrame,
+								endFrame );
+		if( fragment != _ab )
 		{
-			case LoopOff:
-				play_frame += _frames;
-				break;
-			case LoopOn:
-				play_frame += _frames;
-				play_frame = getLoopedIndex( play_frame, loopStartFrame, loopEndFrame  );
-				break;
-			case LoopPingPong:
-			{
-				f_cnt_t left = _frames;
-				if( _state->isBackwards() )
-				{
-					play_frame -= _frames;
-					if( play_frame < loopStartFrame )
-					{
-						left -= ( loopStartFrame - play_frame );
-						play_frame = loopStartFrame;
-					}
-					else left = 0;
-				}
-				play_frame += left;
-				play_frame = getPingPongIndex( play_frame, loopStartFrame, loopEndFrame  );
-				break;
-			}
+			memcpy( _ab, fragment, _frames * BYTES_PER_FRAME );
 		}
-	}
-
-	if( tmp != NULL ) 
-	{
-		MM_FREE( tmp );
+		play_frame = advance( play_frame, _frames, _loopmode,
+					_state->isBackwards(), loopStartFrame,
+								loopEndFrame );
 	}
 
 	_state->setBackwards( is_backwards );
@@ -800,50 +917,61 @@ bool SampleBuffer::play( sampleFrame * _ab, handleState * _state,
 
 
 
-sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
-		f_cnt_t _frames, LoopMode _loopmode, sampleFrame * * _tmp, bool * _backwards,
+const sampleFrame * SampleBuffer::getSampleFragment( const SampleData * _sampleData,
+		f_cnt_t _index,
+		f_cnt_t _frames, LoopMode _loopmode, sampleFrame * _dst, bool * _backwards,
 		f_cnt_t _loopstart, f_cnt_t _loopend, f_cnt_t _end ) const
 {
+	if( _sampleData->stream() != NULL )
+	{
+		// streamed samples don't support loops, see setStreamingEnabled()
+		const f_cnt_t available = qBound<f_cnt_t>( 0, _end - _index, _frames );
+		_sampleData->stream()->read( _dst, _index, available );
+		memset( _dst + available, 0, ( _frames - available ) *
+							BYTES_PER_FRAME );
+		return _dst;
+	}
+
+	const sampleFrame * data = _sampleData->data();
+
 	if( _loopmode == LoopOff )
 	{
 		if( _index + _frames <= _end )
 		{
-			return m_data + _index;
+			return data + _index;
 		}
 	}
 	else if( _loopmode == LoopOn )
 	{
 		if( _index + _frames <= _loopend )
 		{
-			return m_data + _index;
+			return data + _index;
 		}
 	}
 	else
 	{
 		if( ! *_backwards && _index + _frames < _loopend )
 		{
-			return m_data + _index;
+			return data + _index;
 		}
 	}
 
-	*_tmp = MM_ALLOC( sampleFrame, _frames );
-
 	if( _loopmode == LoopOff )
 	{
 		f_cnt_t available = _end - _index;
-		memcpy( *_tmp, m_data + _index, available * BYTES_PER_FRAME );
-		memset( *_tmp + available, 0, ( _frames - available ) *
+		memcpy( _dst, data + _index, available * BYTES_PER_FRAME );
+		memset( _dst + available, 0, ( _frames - available ) *
 							BYTES_PER_FRAME );
 	}
 	else if( _loopmode == LoopOn )
 	{
 		f_cnt_t copied = qMin( _frames, _loopend - _index );
-		memcpy( *_tmp, m_data + _index, copied * BYTES_PER_FRAME );
+		memcpy( _dst, data + _index, copied * BYTES_PER_FRAME );
 		f_cnt_t loop_frames = _loopend - _loopstart;
 		while( copied < _frames )
 		{
 			f_cnt_t todo = qMin( _frames - copied, loop_frames );
-			memcpy( *_tmp + copied, m_data + _loopstart, todo * BYTES_PER_FRAME );
+			memcpy( _dst + copied, data + _loopstart, todo * BYTES_PER_FRAME );
 			copied += todo;
 		}
 	}
@@ -861,8 +989,8 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 			copied = qMin( _frames, pos - _loopstart );
 			for( int i=0; i < copied; i++ )
 			{
-				(*_tmp)[i][0] = m_data[ pos - i ][0];
-				(*_tmp)[i][1] = m_data[ pos - i ][1];
+				_dst[i][0] = data[ pos - i ][0];
+				_dst[i][1] = data[ pos - i ][1];
 			}
 			pos -= copied;
 			if( pos == _loopstart ) backwards = false;
@@ -870,7 +998,7 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 		else
 		{
 			copied = qMin( _frames, _loopend - pos );
-			memcpy( *_tmp, m_data + pos, copied * BYTES_PER_FRAME );
+			memcpy( _dst, data + pos, copied * BYTES_PER_FRAME );
 			pos += copied;
 			if( pos == _loopend ) backwards = true;
 		}
@@ -882,8 +1010,8 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 				f_cnt_t todo = qMin( _frames - copied, pos - _loopstart );
 				for ( int i=0; i < todo; i++ )
 				{
-					(*_tmp)[ copied + i ][0] = m_data[ pos - i ][0];
-					(*_tmp)[ copied + i ][1] = m_data[ pos - i ][1];
+					_dst[ copied + i ][0] = data[ pos - i ][0];
+					_dst[ copied + i ][1] = data[ pos - i ][1];
 				}
 				pos -= todo;
 				copied += todo;
@@ -892,7 +1020,7 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 			else
 			{
 				f_cnt_t todo = qMin( _frames - copied, _loopend - pos );
-				memcpy( *_tmp + copied, m_data + pos, todo * BYTES_PER_FRAME );
+				memcpy( _dst + copied, data + pos, todo * BYTES_PER_FRAME );
 				pos += todo;
 				copied += todo;
 				if( pos >= _loopend ) backwards = true;
@@ -901,7 +1029,40 @@ sampleFrame * SampleBuffer::getSampleFragment( f_cnt_t _index,
 		*_backwards = backwards;
 	}
 
-	return *_tmp;
+	return _dst;
+}
+
+
+
+
+f_cnt_t SampleBuffer::advance( f_cnt_t _index, f_cnt_t _frames,
+				LoopMode _loopmode, bool _backwards,
+				f_cnt_t _loopstart, f_cnt_t _loopend ) const
+{
+	switch( _loopmode )
+	{
+		case LoopOff:
+			return _index + _frames;
+		case LoopOn:
+			return getLoopedIndex( _index + _frames, _loopstart, _loopend );
+		case LoopPingPong:
+		{
+			f_cnt_t left = _frames;
+			if( _backwards )
+			{
+				_index -= _frames;
+				if( _index < _loopstart )
+				{
+					left -= ( _loopstart - _index );
+					_index = _loopstart;
+				}
+				else left = 0;
+			}
+			_index += left;
+			return getPingPongIndex( _index, _loopstart, _loopend );
+		}
+	}
+	return _index;
 }
 
 
@@ -936,38 +1097,77 @@ f_cnt_t SampleBuffer::getPingPongIndex( f_cnt_t _index, f_cnt_t _startf, f_cnt_t
 void SampleBuffer::visualize( QPainter & _p, const QRect & _dr,
 							const QRect & _clip, f_cnt_t _from_frame, f_cnt_t _to_frame )
 {
-	if( m_frames == 0 ) return;
-
-	const bool focus_on_range = _to_frame <= m_frames
+	m_varLock.lockForRead();
+	const SampleData * sampleData = this->sampleData();
+	const sampleFrame * data = sampleData->data();
+	const f_cnt_t frames = sampleData->frames();
+	if( frames == 0 )
+	{
+		m_varLock.unlock();
+		return;
+	}
+	const bool focus_on_range = _to_frame <= frames
 					&& 0 <= _from_frame && _from_frame < _to_frame;
-	//_p.setClipRect( _clip );
 	const int w = _dr.width();
 	const int h = _dr.height();
 
 	const int yb = h / 2 + _dr.y();
-	const float y_space = h*0.5f;
-	const int nb_frames = focus_on_range ? _to_frame - _from_frame : m_frames;
+	const float y_space = h*0.5f * m_amplification;
+	const f_cnt_t nb_frames = focus_on_range ? _to_frame - _from_frame : frames;
 
-	const int fpp = tLimit<int>( nb_frames / w, 1, 20 );
-	QPointF * l = new QPointF[nb_frames / fpp + 1];
-	QPointF * r = new QPointF[nb_frames / fpp + 1];
-	int n = 0;
 	const int xb = _dr.x();
-	const int first = focus_on_range ? _from_frame : 0;
-	const int last = focus_on_range ? _to_frame : m_frames;
-	for( int frame = first; frame < last; frame += fpp )
+	const f_cnt_t first = focus_on_range ? _from_frame : 0;
+
+	// only the pixels within the clip rect have to be drawn
+	const int x0 = qMax( _clip.left() - xb, 0 );
+	const int x1 = qMin( _clip.right() + 1 - xb, w );
+
+	_p.setRenderHint( QPainter::Antialiasing );
+
+	// streamed samples aren't in memory, so they're always drawn from
+	// their peaks
+	if( nb_frames <= w && data != NULL )
+	{
+		// less than a frame per pixel - connect the frames
+		const f_cnt_t f0 = qMax<f_cnt_t>( x0 * nb_frames / w - 1, 0 );
+		const f_cnt_t f1 = qMin<f_cnt_t>( x1 * nb_frames / w + 2,
+								nb_frames );
+		QVector<QPointF> l( qMax<f_cnt_t>( f1 - f0, 0 ) );
+		QVector<QPointF> r( l.size() );
+		for( f_cnt_t f = f0; f < f1; ++f )
+		{
+			const double x = xb + f * double( w ) / nb_frames;
+			l[f - f0] = QPointF( x, yb - data[first + f][0] * y_space );
+			r[f - f0] = QPointF( x, yb - data[first + f][1] * y_space );
+		}
+		_p.drawPolyline( l.constData(), l.size() );
+		_p.drawPolyline( r.constData(), r.size() );
+	}
+	else
 	{
-		l[n] = QPointF( xb + ( (frame - first) * double( w ) / nb_frames ),
-			( yb - ( m_data[frame][0] * y_space * m_amplification ) ) );
-		r[n] = QPointF( xb + ( (frame - first) * double( w ) / nb_frames ),
-			( yb - ( m_data[frame][1] * y_space * m_amplification ) ) );
-		++n;
+		// a vertical line per pixel and channel, covering the peaks of
+		// all frames drawn at that pixel
+		const SamplePeaks * peaks = sampleData->peaks();
+		QVector<QLineF> lines;
+		lines.reserve( qMax( x1 - x0, 0 ) * DEFAULT_CHANNELS );
+		for( int x = x0; x < x1; ++x )
+		{
+			// at least a frame per pixel when zoomed into streams
+			const f_cnt_t f0 = first +
+				(f_cnt_t)( x * double( nb_frames ) / w );
+			const f_cnt_t f1 = qMax( f0 + 1, first +
+				(f_cnt_t)( ( x + 1 ) * double( nb_frames ) / w ) );
+			const SamplePeaks::Peak peak = peaks->peak( f0, f1 );
+			const double px = xb + x + 0.5;
+			for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+			{
+				lines << QLineF( px, yb - peak.max[ch] * y_space,
+					px, yb - peak.min[ch] * y_space );
+			}
+		}
+		_p.drawLines( lines );
 	}
-	_p.setRenderHint( QPainter::Antialiasing );
-	_p.drawPolyline( l, nb_frames / fpp );
-	_p.drawPolyline( r, nb_frames / fpp );
-	delete[] l;
-	delete[] r;
+	m_varLock.unlock();
 }
 
 
@@ -1115,6 +1315,16 @@ void flacStreamEncoderMetadataCallback( const FLAC__StreamEncoder *,
 
 QString & SampleBuffer::toBase64( QString & _dst ) const
 {
+	const SampleData * sampleData = this->sampleData();
+	const sampleFrame * data = sampleData->data();
+	const f_cnt_t frames = sampleData->frames();
+	if( data == NULL )
+	{
+		// streamed samples always have a file, which is saved instead
+		_dst = QString();
+		return _dst;
+	}
+
 #ifdef LMMS_HAVE_FLAC_STREAM_ENCODER_H
 	const f_cnt_t FRAMES_PER_BUF = 1152;
 
@@ -1138,17 +1348,17 @@ QString & SampleBuffer::toBase64( QString & _dst ) const
 		printf( "error within FLAC__stream_encoder_init()!\n" );
 	}
 	f_cnt_t frame_cnt = 0;
-	while( frame_cnt < m_frames )
+	while( frame_cnt < frames )
 	{
 		f_cnt_t remaining = qMin<f_cnt_t>( FRAMES_PER_BUF,
-							m_frames - frame_cnt );
+							frames - frame_cnt );
 		FLAC__int32 buf[FRAMES_PER_BUF * DEFAULT_CHANNELS];
 		for( f_cnt_t f = 0; f < remaining; ++f )
 		{
 			for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
 			{
 				buf[f*DEFAULT_CHANNELS+ch] = (FLAC__int32)(
-					Mixer::clip( m_data[f+frame_cnt][ch] ) *
+					Mixer::clip( data[f+frame_cnt][ch] ) *
 						OUTPUT_SAMPLE_MULTIPLIER );
 			}
 		}
@@ -1167,8 +1377,8 @@ QString & SampleBuffer::toBase64( QString & _dst ) const
 
 #else	/* LMMS_HAVE_FLAC_STREAM_ENCODER_H */
 
-	base64::encode( (const char *) m_data,
-					m_frames * sizeof( sampleFrame ), _dst );
+	base64::encode( (const char *) data,
+					frames * sizeof( sampleFrame ), _dst );
 
 #endif	/* LMMS_HAVE_FLAC_STREAM_ENCODER_H */
 
@@ -1178,16 +1388,102 @@ QString & SampleBuffer::toBase64( QString & _dst ) const
 
 
 
+void SampleBuffer::saveSampleData( QDomDocument & _doc, QDomElement & _this,
+						const QString & _name ) const
+{
+	DataFile * dataFile = dynamic_cast<DataFile *>( &_doc );
+	SampleData * sampleData = this->sampleData();
+	if( dataFile && dataFile->isBundled() && sampleData->data() )
+	{
+		_this.setAttribute( _name + "ref",
+				dataFile->addSampleData( sampleData ) );
+		return;
+	}
+
+	QString s;
+	_this.setAttribute( _name, toBase64( s ) );
+}
+
+
+
+
+bool SampleBuffer::loadSampleData( const QDomElement & _this,
+							const QString & _name )
+{
+	if( _this.hasAttribute( _name + "ref" ) )
+	{
+		SampleData * sampleData = DataFile::sampleData( _this,
+					_this.attribute( _name + "ref" ) );
+		if( sampleData == NULL )
+		{
+			return false;
+		}
+		if( m_origData )
+		{
+			sharedObject::unref( m_origData );
+		}
+		m_origData = sampleData;
+		m_audioFile = QString();
+		update();
+		return true;
+	}
+
+	if( _this.attribute( _name ).isEmpty() )
+	{
+		return false;
+	}
+	loadFromBase64( _this.attribute( _name ) );
+	return true;
+}
+
+
+
+
 SampleBuffer * SampleBuffer::resample( const sample_rate_t _src_sr,
 						const sample_rate_t _dst_sr )
 {
-	sampleFrame * data = m_data;
-	const f_cnt_t frames = m_frames;
+	const SampleData * sampleData = this->sampleData();
+	if( sampleData->stream() != NULL )
+	{
+		// the frames of streams aren't in memory, so decode the whole
+		// file at the requested rate instead
+		SampleData * decoded = decodeFile(
+				tryToMakeAbsolute( m_audioFile ), _dst_sr,
+								m_reversed );
+		if( decoded == NULL )
+		{
+			fprintf( stderr, "SampleBuffer: can't resample %s, it is "
+					"too long to be decoded\n",
+					m_audioFile.toUtf8().constData() );
+			return new SampleBuffer( f_cnt_t( 1 ) );
+		}
+		SampleBuffer * dst_sb = new SampleBuffer( decoded->data(),
+							decoded->frames() );
+		sharedObject::unref( decoded );
+		return dst_sb;
+	}
+
+	const f_cnt_t frames = sampleData->frames();
 	const f_cnt_t dst_frames = static_cast<f_cnt_t>( frames /
 					(float) _src_sr * (float) _dst_sr );
-	SampleBuffer * dst_sb = new SampleBuffer( dst_frames );
-	sampleFrame * dst_buf = dst_sb->m_origData;
+	sampleFrame * dst = MM_ALLOC( sampleFrame, dst_frames );
+	resampleFrames( sampleData->data(), frames, dst, dst_frames,
+							_src_sr, _dst_sr );
+	SampleBuffer * dst_sb = new SampleBuffer( dst, dst_frames );
+	MM_FREE( dst );
+	return dst_sb;
+}
+
 
+
+
+void SampleBuffer::resampleFrames( const sampleFrame * _src,
+					const f_cnt_t _src_frames,
+					sampleFrame * _dst,
+					const f_cnt_t _dst_frames,
+					const sample_rate_t _src_sr,
+					const sample_rate_t _dst_sr )
+{
 	// yeah, libsamplerate, let's rock with sinc-interpolation!
 	int error;
 	SRC_STATE * state;
@@ -1196,10 +1492,10 @@ SampleBuffer * SampleBuffer::resample( const sample_rate_t _src_sr,
 	{
 		SRC_DATA src_data;
 		src_data.end_of_input = 1;
-		src_data.data_in = data[0];
-		src_data.data_out = dst_buf[0];
-		src_data.input_frames = frames;
-		src_data.output_frames = dst_frames;
+		src_data.data_in = _src[0];
+		src_data.data_out = _dst[0];
+		src_data.input_frames = _src_frames;
+		src_data.output_frames = _dst_frames;
 		src_data.src_ratio = (double) _dst_sr / _src_sr;
 		if( ( error = src_process( state, &src_data ) ) )
 		{
@@ -1212,8 +1508,6 @@ SampleBuffer * SampleBuffer::resample( const sample_rate_t _src_sr,
 	{
 		printf( "Error: src_new() failed in sample_buffer.cpp!\n" );
 	}
-	dst_sb->update();
-	return dst_sb;
 }
 
 
@@ -1227,6 +1521,18 @@ void SampleBuffer::setAudioFile( const QString & _audio_file )
 
 
 
+
+void SampleBuffer::cue( SampleStream::Cues _cue, f_cnt_t _frame )
+{
+	const SampleData * d = sampleData();
+	if( d && d->stream() )
+	{
+		d->stream()->cue( _cue, _frame );
+	}
+}
+
+
+
 #ifdef LMMS_HAVE_FLAC_STREAM_DECODER_H
 
 struct flacStreamDecoderClientData
@@ -1361,17 +1667,12 @@ void SampleBuffer::loadFromBase64( const QString & _data )
 	orig_data = ba_writer.buffer();
 	printf("%d\n", (int) orig_data.size() );
 
-	m_origFrames = orig_data.size() / sizeof( sampleFrame );
-	MM_FREE( m_origData );
-	m_origData = MM_ALLOC( sampleFrame, m_origFrames );
-	memcpy( m_origData, orig_data.data(), orig_data.size() );
+	setOrigData( (const sampleFrame *) orig_data.constData(),
+				orig_data.size() / sizeof( sampleFrame ) );
 
 #else /* LMMS_HAVE_FLAC_STREAM_DECODER_H */
 
-	m_origFrames = dsize / sizeof( sampleFrame );
-	MM_FREE( m_origData );
-	m_origData = MM_ALLOC( sampleFrame, m_origFrames );
-	memcpy( m_origData, dst, dsize );
+	setOrigData( (const sampleFrame *) dst, dsize / sizeof( sampleFrame ) );
 
 #endif
 
@@ -1483,15 +1784,41 @@ QString SampleBuffer::tryToMakeAbsolute(const QString& file)
 SampleBuffer::handleState::handleState( bool _varying_pitch, int interpolation_mode ) :
 	m_frameIndex( 0 ),
 	m_varyingPitch( _varying_pitch ),
-	m_isBackwards( false )
+	m_isBackwards( false ),
+	m_resamplingData( NULL ),
+	m_interpolatorQuality( SampleInterpolator::Linear ),
+	m_interpolatorPosition( 0 ),
+	m_fragment( NULL ),
+	m_fragmentFrames( 0 )
 {
 	int error;
 	m_interpolationMode = interpolation_mode;
-	
-	if( ( m_resamplingData = src_new( interpolation_mode, DEFAULT_CHANNELS, &error ) ) == NULL )
+
+	memset( m_interpolatorHistory, 0, sizeof( m_interpolatorHistory ) );
+
+	// libsamplerate is only needed if the built-in interpolator is
+	// disabled or has no counterpart for the converter
+	f_cnt_t margin;
+	if( SampleInterpolator::isEnabled() &&
+		SampleInterpolator::fromConverter( interpolation_mode,
+						&m_interpolatorQuality ) )
+	{
+		margin = SampleInterpolator::historyFrames( m_interpolatorQuality ) +
+			SampleInterpolator::lookaheadFrames( m_interpolatorQuality ) + 1;
+	}
+	else
 	{
-		qDebug( "Error: src_new() failed in sample_buffer.cpp!\n" );
+		margin = MARGIN[interpolation_mode];
+		if( ( m_resamplingData = src_new( interpolation_mode, DEFAULT_CHANNELS, &error ) ) == NULL )
+		{
+			qDebug( "Error: src_new() failed in sample_buffer.cpp!\n" );
+		}
 	}
+
+	// allocate the fragment for pitched playback now rather than in the
+	// first period of a note - it covers pitching up an octave at the
+	// largest period, only higher pitches make play() reallocate it
+	fragmentBuffer( DEFAULT_BUFFER_SIZE * 2 + margin );
 }
 
 
@@ -1500,4 +1827,21 @@ SampleBuffer::handleState::handleState( bool _varying_pitch, int interpolation_m
 SampleBuffer::handleState::~handleState()
 {
 	src_delete( m_resamplingData );
+	MM_FREE( m_fragment );
+}
+
+
+
+
+sampleFrame * SampleBuffer::handleState::fragmentBuffer( f_cnt_t _frames )
+{
+	if( _frames > m_fragmentFrames )
+	{
+		// leave some headroom, so that slight changes of pitch don't
+		// cause another reallocation
+		MM_FREE( m_fragment );
+		m_fragmentFrames = _frames + _frames / 2;
+		m_fragment = MM_ALLOC( sampleFrame, m_fragmentFrames );
+	}
+	return m_fragment;
 }
@@ -0,0 +1,113 @@
+/*
+ * SampleDataCache.cpp - shares decoded samples between all SampleBuffers
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SampleDataCache.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+
+#include "SampleData.h"
+
+
+static QMutex s_cacheMutex;
+static QHash<QString, SampleData *> s_cache;
+
+
+
+SampleData * SampleDataCache::acquire( const QString & _key )
+{
+	QMutexLocker lock( &s_cacheMutex );
+	SampleData * data = s_cache.value( _key, NULL );
+	// the data might be about to be deleted by another thread, which
+	// removes it from the cache right after
+	return data ? sharedObject::refIfReferenced( data ) : NULL;
+}
+
+
+
+
+SampleData * SampleDataCache::insert( const QString & _key,
+							SampleData * _data )
+{
+	s_cacheMutex.lock();
+	SampleData * data = s_cache.value( _key, NULL );
+	if( data && sharedObject::refIfReferenced( data ) )
+	{
+		s_cacheMutex.unlock();
+		sharedObject::unref( _data );
+		return data;
+	}
+	_data->m_cacheKey = _key;
+	s_cache[_key] = _data;
+	s_cacheMutex.unlock();
+
+	return _data;
+}
+
+
+
+
+void SampleDataCache::remove( SampleData * _data )
+{
+	if( _data->m_cacheKey.isEmpty() )
+	{
+		return;
+	}
+
+	QMutexLocker lock( &s_cacheMutex );
+	// the entry may already have been replaced by newer data
+	if( s_cache.value( _data->m_cacheKey, NULL ) == _data )
+	{
+		s_cache.remove( _data->m_cacheKey );
+	}
+}
+
+
+
+
+QString SampleDataCache::fileKey( const QString & _file,
+				sample_rate_t _sample_rate, bool _reversed )
+{
+	const QFileInfo fileInfo( _file );
+	return QString( "file:%1:%2:%3:%4:%5" ).
+			arg( fileInfo.absoluteFilePath() ).
+			arg( fileInfo.lastModified().toMSecsSinceEpoch() ).
+			arg( fileInfo.size() ).
+			arg( _sample_rate ).
+			arg( _reversed ? 1 : 0 );
+}
+
+
+
+
+QString SampleDataCache::dataKey( const sampleFrame * _data, f_cnt_t _frames )
+{
+	const QByteArray hash = QCryptographicHash::hash(
+		QByteArray::fromRawData( (const char *) _data,
+					_frames * sizeof( sampleFrame ) ),
+						QCryptographicHash::Sha1 );
+	return QString( "data:%1:%2" ).arg( QString( hash.toHex() ) ).
+								arg( _frames );
+}
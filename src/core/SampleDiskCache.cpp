@@ -0,0 +1,228 @@
+/*
+ * SampleDiskCache.cpp - keeps decoded samples on disk between sessions
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <utime.h>
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutex>
+#include <QTemporaryFile>
+
+#include "SampleDiskCache.h"
+#include "ConfigManager.h"
+#include "SampleData.h"
+
+
+static const qint64 DefaultSizeLimit = 4096; // MB
+static const int DefaultMaxAge = 30; // days
+
+// every entry starts with a header, followed by the frames
+static const char Magic[8] = { 'L', 'M', 'M', 'S', 'S', 'M', 'P', '1' };
+static const qint64 HeaderSize = 32;
+
+struct SampleDiskCacheHeader
+{
+	char magic[8];
+	qint64 frames;
+	quint32 sampleRate;
+} ;
+
+static QMutex s_limitsMutex;
+static bool s_limitsEnforced = false;
+static qint64 s_bytesStored = 0;
+
+
+
+
+// load() touches the entries it maps, so the modification time tells when
+// an entry was used last - access times aren't kept up to date on most
+// mounts
+static bool lastUsedAfter( const QFileInfo & _a, const QFileInfo & _b )
+{
+	return _a.lastModified() > _b.lastModified();
+}
+
+
+
+
+bool SampleDiskCache::isEnabled()
+{
+	return directory().isEmpty() == false;
+}
+
+
+
+
+SampleData * SampleDiskCache::load( const QString & _file,
+				sample_rate_t _sample_rate, bool _reversed )
+{
+	if( isEnabled() == false )
+	{
+		return NULL;
+	}
+	enforceLimits();
+
+	QFile * file = new QFile( fileName( _file, _sample_rate, _reversed ) );
+	SampleDiskCacheHeader header;
+	if( file->open( QIODevice::ReadOnly ) == false ||
+		file->read( (char *) &header, sizeof( header ) ) !=
+						(qint64) sizeof( header ) ||
+		memcmp( header.magic, Magic, sizeof( Magic ) ) != 0 ||
+		header.sampleRate != _sample_rate || header.frames <= 0 ||
+		file->size() != HeaderSize +
+				header.frames * (qint64) sizeof( sampleFrame ) )
+	{
+		delete file;
+		return NULL;
+	}
+
+	sampleFrame * data = (sampleFrame *) file->map( HeaderSize,
+				header.frames * sizeof( sampleFrame ) );
+	if( data == NULL )
+	{
+		delete file;
+		return NULL;
+	}
+	utime( QFile::encodeName( file->fileName() ).constData(), NULL );
+
+	return new SampleData( file, data, header.frames );
+}
+
+
+
+
+void SampleDiskCache::store( const QString & _file, sample_rate_t _sample_rate,
+				bool _reversed, const SampleData * _data )
+{
+	if( isEnabled() == false || _data->data() == NULL ||
+						QDir().mkpath( directory() ) == false )
+	{
+		return;
+	}
+
+	SampleDiskCacheHeader header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, Magic, sizeof( Magic ) );
+	header.frames = _data->frames();
+	header.sampleRate = _sample_rate;
+
+	char padding[HeaderSize];
+	memset( padding, 0, sizeof( padding ) );
+	memcpy( padding, &header, sizeof( header ) );
+
+	// write to a temporary file first, so that nobody ever maps an
+	// incomplete entry - if another thread stored the same entry in the
+	// meantime, renaming fails and the temporary file is removed
+	QTemporaryFile tmp( directory() + "/XXXXXX.tmp" );
+	const qint64 size = header.frames * sizeof( sampleFrame );
+	if( tmp.open() == false ||
+		tmp.write( padding, HeaderSize ) != HeaderSize ||
+		tmp.write( (const char *) _data->data(), size ) != size ||
+								!tmp.flush() )
+	{
+		fprintf( stderr, "SampleDiskCache: could not write %s\n",
+				tmp.fileName().toUtf8().constData() );
+		return;
+	}
+	if( tmp.rename( fileName( _file, _sample_rate, _reversed ) ) == false )
+	{
+		return;
+	}
+	tmp.setAutoRemove( false );
+
+	s_limitsMutex.lock();
+	s_bytesStored += HeaderSize + size;
+	s_limitsMutex.unlock();
+	enforceLimits();
+}
+
+
+
+
+QString SampleDiskCache::directory()
+{
+	return ConfigManager::inst()->value( "samplecache", "dir" );
+}
+
+
+
+
+QString SampleDiskCache::fileName( const QString & _file,
+				sample_rate_t _sample_rate, bool _reversed )
+{
+	const QFileInfo fileInfo( _file );
+	QCryptographicHash hash( QCryptographicHash::Sha1 );
+	hash.addData( fileInfo.absoluteFilePath().toUtf8() );
+	hash.addData( QByteArray::number( fileInfo.size() ) );
+	hash.addData( QByteArray::number(
+			fileInfo.lastModified().toMSecsSinceEpoch() ) );
+	hash.addData( _reversed ? "r" : "f" );
+
+	return QString( "%1/%2-%3.samples" ).arg( directory() ).
+			arg( QString( hash.result().toHex() ) ).
+			arg( _sample_rate );
+}
+
+
+
+
+void SampleDiskCache::enforceLimits()
+{
+	bool ok;
+	qint64 limit = ConfigManager::inst()->value( "samplecache",
+					"sizelimit" ).toLongLong( &ok );
+	limit = ( ok ? limit : DefaultSizeLimit ) * 1024 * 1024;
+	int maxAge = ConfigManager::inst()->value( "samplecache",
+						"maxage" ).toInt( &ok );
+	maxAge = ok ? maxAge : DefaultMaxAge;
+
+	// scanning the directory is only worth it once per session and
+	// whenever a considerable amount has been added since
+	QMutexLocker lock( &s_limitsMutex );
+	if( s_limitsEnforced && s_bytesStored < limit / 8 )
+	{
+		return;
+	}
+	s_limitsEnforced = true;
+	s_bytesStored = 0;
+
+	QFileInfoList files = QDir( directory() ).entryInfoList(
+				QStringList( "*.samples" ), QDir::Files );
+	qSort( files.begin(), files.end(), lastUsedAfter );
+
+	const QDateTime oldest =
+			QDateTime::currentDateTime().addDays( -maxAge );
+	qint64 total = 0;
+	for( const QFileInfo & file : files )
+	{
+		total += file.size();
+		if( total > limit || file.lastModified() < oldest )
+		{
+			// entries still mapped stay readable until unmapped
+			QFile::remove( file.absoluteFilePath() );
+		}
+	}
+}
@@ -0,0 +1,421 @@
+/*
+ * SampleInterpolator.cpp - fast interpolation for pitched sample playback
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include <samplerate.h>
+
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
+#include "SampleInterpolator.h"
+#include "lmms_constants.h"
+
+
+// number of fractional positions the sinc kernels are tabulated at, values
+// in between are interpolated linearly
+static const int Phases = 128;
+
+static const int FastTaps = 8;
+static const int MediumTaps = 16;
+
+// cutoff relative to the nyquist frequency, the shorter kernel needs a wider
+// transition band
+static const double FastCutoff = 0.85;
+static const double MediumCutoff = 0.92;
+
+// when pitching up, the kernels are stretched by the ratio to lower their
+// cutoff below the nyquist frequency of the output - up to this factor, so
+// that the number of taps stays bounded
+static const int MaxStretch = 4;
+
+// every row holds the coefficients of one phase, each of them stored twice -
+// once per channel - so that a row can be multiplied with the interleaved
+// frames directly. The deltas are the differences to the next row.
+static float s_fastCoefficients[Phases * FastTaps * 2];
+static float s_fastDeltas[Phases * FastTaps * 2];
+static float s_mediumCoefficients[Phases * MediumTaps * 2];
+static float s_mediumDeltas[Phases * MediumTaps * 2];
+
+// the same kernels sampled Phases times per input frame across their whole
+// width, for the stretched kernels whose taps don't line up with the rows
+static float s_fastKernel[FastTaps * Phases + 1];
+static float s_fastKernelDeltas[FastTaps * Phases + 1];
+static float s_mediumKernel[MediumTaps * Phases + 1];
+static float s_mediumKernelDeltas[MediumTaps * Phases + 1];
+
+static bool s_enabled = false;
+
+
+
+
+// the kernel at distance _x of the interpolated position
+static double windowedSinc( double _x, int _taps, double _cutoff )
+{
+	const double sinc = _x == 0 ? 1 :
+			sin( D_PI * _cutoff * _x ) / ( D_PI * _cutoff * _x );
+	// blackman window spanning all taps
+	const double w = ( _x + _taps / 2 ) / _taps;
+	return sinc * ( 0.42 - 0.5 * cos( 2 * D_PI * w ) +
+						0.08 * cos( 4 * D_PI * w ) );
+}
+
+
+
+
+static void buildRow( double * _row, int _taps, double _cutoff,
+							double _fraction )
+{
+	double sum = 0;
+	for( int k = 0; k < _taps; ++k )
+	{
+		// distance of the tap from the interpolated position
+		const double x = k - ( _taps / 2 - 1 ) - _fraction;
+		_row[k] = windowedSinc( x, _taps, _cutoff );
+		sum += _row[k];
+	}
+	// unity gain for DC at every phase
+	for( int k = 0; k < _taps; ++k )
+	{
+		_row[k] /= sum;
+	}
+}
+
+
+
+
+static void buildTable( float * _coefficients, float * _deltas, int _taps,
+							double _cutoff )
+{
+	double row[MediumTaps];
+	double next[MediumTaps];
+	buildRow( row, _taps, _cutoff, 0 );
+	for( int j = 0; j < Phases; ++j )
+	{
+		buildRow( next, _taps, _cutoff, (double)( j + 1 ) / Phases );
+		for( int k = 0; k < _taps; ++k )
+		{
+			const int i = ( j * _taps + k ) * 2;
+			_coefficients[i] = _coefficients[i + 1] = row[k];
+			_deltas[i] = _deltas[i + 1] = next[k] - row[k];
+			row[k] = next[k];
+		}
+	}
+}
+
+
+
+
+static void buildKernel( float * _kernel, float * _deltas, int _taps,
+							double _cutoff )
+{
+	const int size = _taps * Phases + 1;
+	for( int j = 0; j < size; ++j )
+	{
+		_kernel[j] = windowedSinc( (double) j / Phases - _taps / 2,
+							_taps, _cutoff );
+	}
+	for( int j = 0; j < size - 1; ++j )
+	{
+		_deltas[j] = _kernel[j + 1] - _kernel[j];
+	}
+	_deltas[size - 1] = 0;
+}
+
+
+
+
+// builds all tables at startup, they're small enough
+static struct SampleInterpolatorTables
+{
+	SampleInterpolatorTables()
+	{
+		buildTable( s_fastCoefficients, s_fastDeltas, FastTaps,
+								FastCutoff );
+		buildTable( s_mediumCoefficients, s_mediumDeltas, MediumTaps,
+								MediumCutoff );
+		buildKernel( s_fastKernel, s_fastKernelDeltas, FastTaps,
+								FastCutoff );
+		buildKernel( s_mediumKernel, s_mediumKernelDeltas, MediumTaps,
+								MediumCutoff );
+	}
+} s_tables;
+
+
+
+
+// used for ratios above 1 - the kernel spans more input frames than it has
+// taps, so its coefficients are picked from the kernel table with a stride
+// of Phases / stretch entries per input frame
+template<int TAPS>
+static void processStretchedSinc( const float * _kernel,
+				const float * _kernelDeltas,
+				const sampleFrame * _src, sampleFrame * _dst,
+				fpp_t _frames, double _ratio, double _position )
+{
+	const double stretch = std::min( _ratio, (double) MaxStretch );
+	const double halfWidth = stretch * TAPS / 2;
+	const float step = Phases / stretch;
+
+	// the coefficients of one output frame, stored twice like the rows
+	// of the polyphase tables, and padded to whole pairs of frames
+	float coefficients[( MaxStretch * TAPS + 2 ) * 2];
+
+	for( fpp_t i = 0; i < _frames; ++i )
+	{
+		const double t = _position + i * _ratio;
+		const f_cnt_t first =
+			static_cast<f_cnt_t>( floor( t - halfWidth ) ) + 1;
+		const f_cnt_t last =
+			static_cast<f_cnt_t>( ceil( t + halfWidth ) ) - 1;
+		const int taps = last - first + 1;
+
+		// kernel table position of the first tap
+		const float p = ( first - t + halfWidth ) * step;
+		float sum = 0;
+		for( int k = 0; k < taps; ++k )
+		{
+			const float x = p + k * step;
+			const int j = static_cast<int>( x );
+			const float c = _kernel[j] + ( x - j ) * _kernelDeltas[j];
+			coefficients[k * 2] = coefficients[k * 2 + 1] = c;
+			sum += c;
+		}
+		// an odd number of taps reads one frame more, which is within
+		// lookaheadFrames() still
+		coefficients[taps * 2] = coefficients[taps * 2 + 1] = 0;
+		const int floats = ( ( taps + 1 ) & ~1 ) * 2;
+
+		// the stretched kernel adds up to about the stretch factor,
+		// keep unity gain for DC
+		const float gain = 1 / sum;
+		const float * in = _src[first];
+
+#ifdef __SSE__
+		// lanes hold left, right, left, right
+		__m128 acc = _mm_setzero_ps();
+		for( int k = 0; k < floats; k += 4 )
+		{
+			acc = _mm_add_ps( acc, _mm_mul_ps(
+					_mm_loadu_ps( coefficients + k ),
+						_mm_loadu_ps( in + k ) ) );
+		}
+		acc = _mm_add_ps( acc, _mm_movehl_ps( acc, acc ) );
+		acc = _mm_mul_ps( acc, _mm_set1_ps( gain ) );
+		_mm_storel_pi( (__m64 *) _dst[i], acc );
+#else
+		float acc[4] = { 0, 0, 0, 0 };
+		for( int k = 0; k < floats; k += 4 )
+		{
+			for( int m = 0; m < 4; ++m )
+			{
+				acc[m] += coefficients[k + m] * in[k + m];
+			}
+		}
+		_dst[i][0] = ( acc[0] + acc[2] ) * gain;
+		_dst[i][1] = ( acc[1] + acc[3] ) * gain;
+#endif
+	}
+}
+
+
+
+
+template<int TAPS>
+static void processSinc( const float * _coefficients, const float * _deltas,
+				const float * _kernel, const float * _kernelDeltas,
+				const sampleFrame * _src, sampleFrame * _dst,
+				fpp_t _frames, double _ratio, double _position )
+{
+	if( _ratio > 1 )
+	{
+		processStretchedSinc<TAPS>( _kernel, _kernelDeltas, _src, _dst,
+						_frames, _ratio, _position );
+		return;
+	}
+
+	for( fpp_t i = 0; i < _frames; ++i )
+	{
+		const double t = _position + i * _ratio;
+		const f_cnt_t n = static_cast<f_cnt_t>( t );
+		const float phase = ( t - n ) * Phases;
+		const int row = static_cast<int>( phase );
+		const float a = phase - row;
+
+		const float * c = _coefficients + row * TAPS * 2;
+		const float * d = _deltas + row * TAPS * 2;
+		const float * in = _src[n - ( TAPS / 2 - 1 )];
+
+#ifdef __SSE__
+		// lanes hold left, right, left, right
+		const __m128 va = _mm_set1_ps( a );
+		__m128 acc = _mm_setzero_ps();
+		for( int k = 0; k < TAPS * 2; k += 4 )
+		{
+			const __m128 coeff = _mm_add_ps( _mm_loadu_ps( c + k ),
+				_mm_mul_ps( va, _mm_loadu_ps( d + k ) ) );
+			acc = _mm_add_ps( acc,
+				_mm_mul_ps( coeff, _mm_loadu_ps( in + k ) ) );
+		}
+		acc = _mm_add_ps( acc, _mm_movehl_ps( acc, acc ) );
+		_mm_storel_pi( (__m64 *) _dst[i], acc );
+#else
+		float acc[4] = { 0, 0, 0, 0 };
+		for( int k = 0; k < TAPS * 2; k += 4 )
+		{
+			for( int m = 0; m < 4; ++m )
+			{
+				acc[m] += ( c[k + m] + a * d[k + m] ) * in[k + m];
+			}
+		}
+		_dst[i][0] = acc[0] + acc[2];
+		_dst[i][1] = acc[1] + acc[3];
+#endif
+	}
+}
+
+
+
+
+bool SampleInterpolator::isEnabled()
+{
+	return s_enabled;
+}
+
+
+
+
+void SampleInterpolator::setEnabled( bool _enabled )
+{
+	s_enabled = _enabled;
+}
+
+
+
+
+bool SampleInterpolator::fromConverter( int _converter, Qualities * _quality )
+{
+	switch( _converter )
+	{
+		case SRC_ZERO_ORDER_HOLD:
+			*_quality = ZeroOrderHold;
+			return true;
+		case SRC_LINEAR:
+			*_quality = Linear;
+			return true;
+		case SRC_SINC_FASTEST:
+			*_quality = SincFast;
+			return true;
+		case SRC_SINC_MEDIUM_QUALITY:
+			*_quality = SincMedium;
+			return true;
+	}
+	return false;
+}
+
+
+
+
+int SampleInterpolator::historyFrames( Qualities _quality )
+{
+	switch( _quality )
+	{
+		case SincFast: return MaxStretch * FastTaps / 2 - 1;
+		case SincMedium: return MaxStretch * MediumTaps / 2 - 1;
+		default: break;
+	}
+	return 0;
+}
+
+
+
+
+int SampleInterpolator::lookaheadFrames( Qualities _quality )
+{
+	switch( _quality )
+	{
+		case Linear: return 1;
+		case SincFast: return MaxStretch * FastTaps / 2;
+		case SincMedium: return MaxStretch * MediumTaps / 2;
+		default: break;
+	}
+	return 0;
+}
+
+
+
+
+f_cnt_t SampleInterpolator::process( Qualities _quality,
+				const sampleFrame * _src, sampleFrame * _dst,
+				fpp_t _frames, double _ratio, double * _position )
+{
+	const double pos = *_position;
+
+	switch( _quality )
+	{
+		case ZeroOrderHold:
+			for( fpp_t i = 0; i < _frames; ++i )
+			{
+				const f_cnt_t n =
+					static_cast<f_cnt_t>( pos + i * _ratio );
+				_dst[i][0] = _src[n][0];
+				_dst[i][1] = _src[n][1];
+			}
+			break;
+
+		case Linear:
+			for( fpp_t i = 0; i < _frames; ++i )
+			{
+				const double t = pos + i * _ratio;
+				const f_cnt_t n = static_cast<f_cnt_t>( t );
+				const float f = t - n;
+				_dst[i][0] = _src[n][0] +
+					f * ( _src[n + 1][0] - _src[n][0] );
+				_dst[i][1] = _src[n][1] +
+					f * ( _src[n + 1][1] - _src[n][1] );
+			}
+			break;
+
+		case SincFast:
+			processSinc<FastTaps>( s_fastCoefficients, s_fastDeltas,
+					s_fastKernel, s_fastKernelDeltas,
+					_src, _dst, _frames, _ratio, pos );
+			break;
+
+		case SincMedium:
+			processSinc<MediumTaps>( s_mediumCoefficients,
+						s_mediumDeltas, s_mediumKernel,
+						s_mediumKernelDeltas, _src, _dst,
+						_frames, _ratio, pos );
+			break;
+
+		default:
+			break;
+	}
+
+	const double end = pos + _frames * _ratio;
+	const f_cnt_t used = static_cast<f_cnt_t>( end );
+	*_position = end - used;
+	return used;
+}
@@ -0,0 +1,235 @@
+/*
+ * SamplePeaks.cpp - min/max pyramid for drawing waveforms
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SamplePeaks.h"
+
+
+static inline void merge( SamplePeaks::Peak & _peak,
+					const SamplePeaks::Peak & _other )
+{
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		_peak.min[ch] = qMin( _peak.min[ch], _other.min[ch] );
+		_peak.max[ch] = qMax( _peak.max[ch], _other.max[ch] );
+	}
+}
+
+
+
+
+static inline void merge( SamplePeaks::Peak & _peak,
+				const sampleFrame * _data, f_cnt_t _frames )
+{
+	for( f_cnt_t f = 0; f < _frames; ++f )
+	{
+		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			_peak.min[ch] = qMin( _peak.min[ch], _data[f][ch] );
+			_peak.max[ch] = qMax( _peak.max[ch], _data[f][ch] );
+		}
+	}
+}
+
+
+
+
+static inline SamplePeaks::Peak emptyPeak()
+{
+	SamplePeaks::Peak peak;
+	for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+	{
+		peak.min[ch] = 1.0e30f;
+		peak.max[ch] = -1.0e30f;
+	}
+	return peak;
+}
+
+
+
+
+SamplePeaks::SamplePeaks( const sampleFrame * _data, f_cnt_t _frames ) :
+	m_data( _data ),
+	m_frames( _frames ),
+	m_blockFrames( BlockFrames ),
+	m_available( _frames )
+{
+	// level 0 from the frames, incomplete blocks at the end are left out
+	// and read from the frames when needed
+	QVector<Peak> level( _frames / BlockFrames );
+	for( int b = 0; b < level.size(); ++b )
+	{
+		level[b] = emptyPeak();
+		merge( level[b], _data + b * BlockFrames, BlockFrames );
+	}
+
+	while( level.size() >= BlocksPerLevel )
+	{
+		m_levels.append( level );
+
+		QVector<Peak> next( level.size() / BlocksPerLevel );
+		for( int b = 0; b < next.size(); ++b )
+		{
+			next[b] = level[b * BlocksPerLevel];
+			for( int i = 1; i < BlocksPerLevel; ++i )
+			{
+				merge( next[b], level[b * BlocksPerLevel + i] );
+			}
+		}
+		level = next;
+	}
+	if( level.isEmpty() == false )
+	{
+		m_levels.append( level );
+	}
+}
+
+
+
+
+SamplePeaks::SamplePeaks( f_cnt_t _frames ) :
+	m_data( NULL ),
+	m_frames( _frames ),
+	m_blockFrames( StreamBlockFrames ),
+	m_available( 0 )
+{
+	// unlike above, level 0 includes the incomplete block at the end as
+	// there are no frames to read it from later on
+	int blocks = ( _frames + m_blockFrames - 1 ) / m_blockFrames;
+	while( blocks > 0 )
+	{
+		m_levels.append( QVector<Peak>( blocks, emptyPeak() ) );
+		blocks = blocks >= BlocksPerLevel ? blocks / BlocksPerLevel : 0;
+	}
+}
+
+
+
+
+void SamplePeaks::add( const sampleFrame * _data, f_cnt_t _frames )
+{
+	const f_cnt_t start = m_available;
+	const f_cnt_t end = qMin( start + _frames, m_frames );
+	if( start >= end )
+	{
+		return;
+	}
+
+	QVector<Peak> & blocks = m_levels[0];
+	for( f_cnt_t f = start; f < end; f += m_blockFrames )
+	{
+		Peak & peak = blocks[f / m_blockFrames];
+		peak = emptyPeak();
+		merge( peak, _data + ( f - start ),
+					qMin( m_blockFrames, end - f ) );
+	}
+
+	// update the blocks of the other levels which are complete now
+	for( int l = 1; l < m_levels.size(); ++l )
+	{
+		const f_cnt_t size = blockFrames( l );
+		const f_cnt_t last = qMin<f_cnt_t>( end / size,
+							m_levels[l].size() );
+		for( f_cnt_t b = start / size; b < last; ++b )
+		{
+			Peak & peak = m_levels[l][b];
+			peak = m_levels[l - 1][b * BlocksPerLevel];
+			for( int i = 1; i < BlocksPerLevel; ++i )
+			{
+				merge( peak, m_levels[l - 1][
+						b * BlocksPerLevel + i] );
+			}
+		}
+	}
+
+	// publish the new peaks to readers
+	m_available.fetchAndStoreOrdered( end );
+}
+
+
+
+
+SamplePeaks::Peak SamplePeaks::peak( f_cnt_t _start, f_cnt_t _end ) const
+{
+	const f_cnt_t available = frames();
+	_start = qBound<f_cnt_t>( 0, _start, available );
+	_end = qBound<f_cnt_t>( _start, _end, available );
+
+	Peak peak = emptyPeak();
+	if( _start == _end )
+	{
+		for( ch_cnt_t ch = 0; ch < DEFAULT_CHANNELS; ++ch )
+		{
+			peak.min[ch] = peak.max[ch] = 0;
+		}
+		return peak;
+	}
+
+	// start at the coarsest level whose blocks fit into the range
+	int level = m_levels.size() - 1;
+	while( level >= 0 && blockFrames( level ) > _end - _start )
+	{
+		--level;
+	}
+
+	accumulate( peak, _start, _end, level );
+	return peak;
+}
+
+
+
+
+void SamplePeaks::accumulate( Peak & _peak, f_cnt_t _start, f_cnt_t _end,
+							int _level ) const
+{
+	if( _level < 0 )
+	{
+		if( m_data != NULL )
+		{
+			merge( _peak, m_data + _start, _end - _start );
+		}
+		else if( _start < _end )
+		{
+			merge( _peak, m_levels[0][_start / m_blockFrames] );
+			merge( _peak, m_levels[0][( _end - 1 ) / m_blockFrames] );
+		}
+		return;
+	}
+
+	// whole blocks of this level within the range, the remainders at both
+	// ends are taken from the levels below
+	const f_cnt_t size = blockFrames( _level );
+	const f_cnt_t first = ( _start + size - 1 ) / size;
+	const f_cnt_t last = qMin<f_cnt_t>( _end / size,
+						m_levels[_level].size() );
+	if( first >= last )
+	{
+		accumulate( _peak, _start, _end, _level - 1 );
+		return;
+	}
+
+	accumulate( _peak, _start, first * size, _level - 1 );
+	for( f_cnt_t b = first; b < last; ++b )
+	{
+		merge( _peak, m_levels[_level][b] );
+	}
+	accumulate( _peak, last * size, _end, _level - 1 );
+}
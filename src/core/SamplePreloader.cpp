@@ -0,0 +1,214 @@
+/*
+ * SamplePreloader.cpp - decodes the samples of a project in parallel
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SamplePreloader.h"
+
+#include <QCoreApplication>
+#include <QDomElement>
+#include <QProgressDialog>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+
+#include "Engine.h"
+#include "GuiApplication.h"
+#include "LocaleHelper.h"
+#include "MainWindow.h"
+#include "Mixer.h"
+#include "SampleBuffer.h"
+
+
+class SamplePreloader::Job : public QRunnable
+{
+public:
+	Job( SamplePreloader * _preloader, const QString & _file,
+				sample_rate_t _sample_rate, bool _reversed ) :
+		m_preloader( _preloader ),
+		m_file( _file ),
+		m_sampleRate( _sample_rate ),
+		m_reversed( _reversed )
+	{
+	}
+
+	virtual void run()
+	{
+		SampleData * data = NULL;
+		if( !m_preloader->m_cancelled )
+		{
+			data = SampleBuffer::decodeFile( m_file, m_sampleRate,
+								m_reversed );
+		}
+		m_preloader->jobDone( data );
+	}
+
+
+private:
+	SamplePreloader * m_preloader;
+	QString m_file;
+	sample_rate_t m_sampleRate;
+	bool m_reversed;
+
+} ;
+
+
+
+
+// reads a model the way AutomatableModel::loadSettings() does - automated
+// models are stored as an element instead of an attribute
+static float modelValue( const QDomElement & _element, const QString & _name )
+{
+	const QDomElement automated = _element.firstChildElement( _name );
+	if( !automated.isNull() )
+	{
+		return LocaleHelper::toFloat( automated.attribute( "value" ) );
+	}
+	return LocaleHelper::toFloat( _element.attribute( _name ) );
+}
+
+
+
+
+SamplePreloader::SamplePreloader() :
+	m_jobsDone( 0 ),
+	m_cancelled( 0 )
+{
+}
+
+
+
+
+SamplePreloader::~SamplePreloader()
+{
+	// SampleBuffers which picked up the data hold their own references
+	for( SampleData * data : m_data )
+	{
+		sharedObject::unref( data );
+	}
+}
+
+
+
+
+bool SamplePreloader::load( const QDomElement & _project )
+{
+	const sample_rate_t sampleRate =
+			Engine::mixer()->processingSampleRate();
+
+	// gather the files the same way the elements' loadSettings() will
+	// load them - audioFileProcessor loads its file unreversed first
+	// and reverses it afterwards
+	QList<Job *> jobs;
+	QSet<QString> files;
+	QDomNodeList nodes = _project.elementsByTagName( "sampletco" );
+	for( int i = 0; i < nodes.count(); ++i )
+	{
+		const QString src = nodes.item( i ).toElement().attribute( "src" );
+		const QString file = SampleBuffer::tryToMakeAbsolute( src );
+		if( !src.isEmpty() && !files.contains( file ) &&
+					!SampleBuffer::streamsFile( file ) )
+		{
+			files << file;
+			jobs << new Job( this, file, sampleRate, false );
+		}
+	}
+	QSet<QString> reversedFiles;
+	nodes = _project.elementsByTagName( "audiofileprocessor" );
+	for( int i = 0; i < nodes.count(); ++i )
+	{
+		const QDomElement e = nodes.item( i ).toElement();
+		const QString src = e.attribute( "src" );
+		const QString file = SampleBuffer::tryToMakeAbsolute( src );
+		if( src.isEmpty() )
+		{
+			continue;
+		}
+		if( !files.contains( file ) )
+		{
+			files << file;
+			jobs << new Job( this, file, sampleRate, false );
+		}
+		if( modelValue( e, "reversed" ) != 0 &&
+						!reversedFiles.contains( file ) )
+		{
+			reversedFiles << file;
+			jobs << new Job( this, file, sampleRate, true );
+		}
+	}
+
+	if( jobs.isEmpty() )
+	{
+		return true;
+	}
+
+	QThreadPool pool;
+	pool.setMaxThreadCount( QThread::idealThreadCount() );
+	for( Job * job : jobs )
+	{
+		pool.start( job );
+	}
+
+	QProgressDialog * pd = NULL;
+	if( gui )
+	{
+		pd = new QProgressDialog( tr( "Loading samples..." ),
+						tr( "Cancel" ), 0, jobs.size(),
+						gui->mainWindow() );
+		pd->setWindowModality( Qt::ApplicationModal );
+		pd->setWindowTitle( tr( "Please wait..." ) );
+		pd->show();
+	}
+
+	while( !pool.waitForDone( 50 ) )
+	{
+		if( pd != NULL )
+		{
+			pd->setValue( m_jobsDone );
+			pd->setLabelText( tr( "Loading samples (%1/%2)" ).
+					arg( (int) m_jobsDone ).arg( jobs.size() ) );
+			QCoreApplication::instance()->processEvents(
+						QEventLoop::AllEvents, 50 );
+			if( pd->wasCanceled() )
+			{
+				// jobs not started yet skip decoding
+				m_cancelled.fetchAndStoreOrdered( 1 );
+			}
+		}
+	}
+
+	delete pd;
+
+	return !m_cancelled;
+}
+
+
+
+
+void SamplePreloader::jobDone( SampleData * _data )
+{
+	if( _data != NULL )
+	{
+		QMutexLocker lock( &m_dataMutex );
+		m_data << _data;
+	}
+	m_jobsDone.fetchAndAddOrdered( 1 );
+}
@@ -0,0 +1,561 @@
+/*
+ * SampleStream.cpp - plays long audio files from disk instead of from memory
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "SampleStream.h"
+
+#include <QtCore/QList>
+#include <QtCore/QMutex>
+#include <QtCore/QThread>
+#include <QtCore/QWaitCondition>
+
+#include <stdio.h>
+#include <string.h>
+
+
+//! Background thread loading the blocks of all open streams. It runs as
+//! long as there is at least one stream.
+class SampleStreamLoader : public QThread
+{
+public:
+	static void add( SampleStream * _stream )
+	{
+		QMutexLocker lock( &s_mutex );
+		s_streams << _stream;
+		if( s_thread == NULL )
+		{
+			s_thread = new SampleStreamLoader;
+			s_thread->start();
+		}
+		s_wakeUp.wakeAll();
+	}
+
+	static void remove( SampleStream * _stream )
+	{
+		s_mutex.lock();
+		if( s_streams.removeAll( _stream ) == 0 || !s_streams.isEmpty() ||
+							s_thread == NULL )
+		{
+			s_mutex.unlock();
+			return;
+		}
+		SampleStreamLoader * thread = s_thread;
+		s_thread = NULL;
+		thread->m_quit = true;
+		s_wakeUp.wakeAll();
+		s_mutex.unlock();
+
+		thread->wait();
+		delete thread;
+	}
+
+
+private:
+	// how often streams are checked for blocks to load when all of them
+	// are up to date
+	static const unsigned long IdleInterval = 10; // ms
+
+	SampleStreamLoader() :
+		m_quit( false )
+	{
+	}
+
+	virtual void run()
+	{
+		s_mutex.lock();
+		while( !m_quit )
+		{
+			bool busy = false;
+			for( SampleStream * stream : s_streams )
+			{
+				// every stream loads at most one block at a
+				// time, so all of them get their turn
+				busy = stream->service() || busy;
+			}
+
+			if( busy )
+			{
+				s_mutex.unlock();
+				yieldCurrentThread();
+				s_mutex.lock();
+			}
+			else
+			{
+				s_wakeUp.wait( &s_mutex, IdleInterval );
+			}
+		}
+		s_mutex.unlock();
+	}
+
+	bool m_quit;
+
+	static QMutex s_mutex;
+	static QWaitCondition s_wakeUp;
+	static QList<SampleStream *> s_streams;
+	static SampleStreamLoader * s_thread;
+
+} ;
+
+
+QMutex SampleStreamLoader::s_mutex;
+QWaitCondition SampleStreamLoader::s_wakeUp;
+QList<SampleStream *> SampleStreamLoader::s_streams;
+SampleStreamLoader * SampleStreamLoader::s_thread = NULL;
+
+
+
+
+SampleStream::Block::Block() :
+	index( -1 ),
+	frames( MM_ALLOC( sampleFrame, BlockFrames ) )
+{
+}
+
+
+
+
+SampleStream::Block::~Block()
+{
+	MM_FREE( frames );
+}
+
+
+
+
+SampleStream::Cue::Cue() :
+	requested( -1 )
+{
+}
+
+
+
+
+SampleStream::SampleStream( const QString & _file,
+						sample_rate_t _sample_rate ) :
+	m_fileName( _file ),
+	m_sndFile( NULL ),
+	m_channels( 0 ),
+	m_fileSampleRate( 0 ),
+	m_sampleRate( _sample_rate ),
+	m_frames( 0 ),
+	m_peaks( NULL ),
+	m_readBlock( 0 ),
+	m_srcState( NULL ),
+	m_ratio( 1.0 ),
+	m_interleaved( NULL ),
+	m_input( NULL ),
+	m_inputFrames( 0 ),
+	m_inputPos( 0 ),
+	m_eof( false ),
+	m_nextBlock( 0 )
+{
+}
+
+
+
+
+SampleStream::~SampleStream()
+{
+	SampleStreamLoader::remove( this );
+
+	if( m_sndFile != NULL )
+	{
+		sf_close( m_sndFile );
+	}
+	m_file.close();
+	if( m_srcState != NULL )
+	{
+		src_delete( m_srcState );
+	}
+	delete[] m_interleaved;
+	MM_FREE( m_input );
+	delete m_peaks;
+}
+
+
+
+
+SampleStream * SampleStream::open( const QString & _file,
+						sample_rate_t _sample_rate )
+{
+	SampleStream * stream = new SampleStream( _file, _sample_rate );
+	if( !stream->openFile() )
+	{
+		delete stream;
+		return NULL;
+	}
+
+	for( int i = 0; i < HeadBlocks && i < stream->blockCount(); ++i )
+	{
+		stream->loadBlock( stream->m_head[i], i );
+	}
+
+	SampleStreamLoader::add( stream );
+
+	return stream;
+}
+
+
+
+
+double SampleStream::fileLength( const QString & _file )
+{
+	double length = -1;
+
+	// Use QFile to handle unicode file names on Windows
+	QFile f( _file );
+	if( !f.open( QIODevice::ReadOnly ) )
+	{
+		return length;
+	}
+	SF_INFO sf_info;
+	sf_info.format = 0;
+	SNDFILE * snd_file = sf_open_fd( f.handle(), SFM_READ, &sf_info, false );
+	if( snd_file != NULL )
+	{
+		if( sf_info.samplerate > 0 )
+		{
+			length = (double) sf_info.frames / sf_info.samplerate;
+		}
+		sf_close( snd_file );
+	}
+	f.close();
+
+	return length;
+}
+
+
+
+
+void SampleStream::read( sampleFrame * _dst, f_cnt_t _start,
+							f_cnt_t _frames )
+{
+	m_readBlock.fetchAndStoreOrdered( qMax( _start, 0 ) / BlockFrames );
+
+	f_cnt_t pos = _start;
+	f_cnt_t done = 0;
+	while( done < _frames )
+	{
+		sampleFrame * dst = _dst + done;
+		if( pos < 0 || pos >= m_frames )
+		{
+			memset( dst, 0, ( _frames - done ) * BYTES_PER_FRAME );
+			break;
+		}
+
+		const int index = pos / BlockFrames;
+		const f_cnt_t offset = pos % BlockFrames;
+		const f_cnt_t n = qMin( _frames - done,
+				qMin( BlockFrames - offset, m_frames - pos ) );
+
+		bool copied = index < HeadBlocks &&
+			copyFrom( m_head[index], index, offset, dst, n );
+		for( int c = 0; c < NumCues && !copied; ++c )
+		{
+			for( int i = 0; i < CueBlocks && !copied; ++i )
+			{
+				copied = copyFrom( m_cues[c].blocks[i], index,
+								offset, dst, n );
+			}
+		}
+		if( !copied )
+		{
+			copied = copyFrom( m_ring[index % RingBlocks], index,
+								offset, dst, n );
+		}
+		if( !copied )
+		{
+			// the disk didn't keep up or we just jumped somewhere
+			// not cued
+			memset( dst, 0, n * BYTES_PER_FRAME );
+		}
+
+		pos += n;
+		done += n;
+	}
+}
+
+
+
+
+void SampleStream::cue( Cues _cue, f_cnt_t _frame )
+{
+	const int index = ( _frame >= 0 && _frame < m_frames ) ?
+						_frame / BlockFrames : -1;
+	m_cues[_cue].requested.fetchAndStoreOrdered( index );
+}
+
+
+
+
+bool SampleStream::openFile()
+{
+	// Use QFile to handle unicode file names on Windows
+	m_file.setFileName( m_fileName );
+	if( !m_file.open( QIODevice::ReadOnly ) )
+	{
+		return false;
+	}
+
+	SF_INFO sf_info;
+	sf_info.format = 0;
+	m_sndFile = sf_open_fd( m_file.handle(), SFM_READ, &sf_info, false );
+	if( m_sndFile == NULL || !sf_info.seekable || sf_info.frames <= 0 ||
+						sf_info.samplerate <= 0 )
+	{
+		return false;
+	}
+
+	m_channels = sf_info.channels;
+	m_fileSampleRate = sf_info.samplerate;
+	m_frames = static_cast<f_cnt_t>( (double) sf_info.frames *
+					m_sampleRate / m_fileSampleRate );
+
+	if( m_fileSampleRate != m_sampleRate )
+	{
+		int error;
+		m_srcState = src_new( SRC_SINC_MEDIUM_QUALITY,
+						DEFAULT_CHANNELS, &error );
+		if( m_srcState == NULL )
+		{
+			fprintf( stderr, "Error: src_new() failed in "
+					"SampleStream.cpp: %s\n",
+						src_strerror( error ) );
+			return false;
+		}
+		m_ratio = (double) m_sampleRate / m_fileSampleRate;
+	}
+
+	m_interleaved = new float[InputFrames * m_channels];
+	m_input = MM_ALLOC( sampleFrame, InputFrames );
+	m_peaks = new SamplePeaks( m_frames );
+
+	return true;
+}
+
+
+
+
+bool SampleStream::copyFrom( Block & _block, int _index, f_cnt_t _offset,
+					sampleFrame * _dst, f_cnt_t _frames )
+{
+	if( (int) _block.index != _index )
+	{
+		return false;
+	}
+
+	memcpy( _dst, _block.frames + _offset, _frames * BYTES_PER_FRAME );
+
+	// the loader may have started replacing the block while we were
+	// copying it - the copy is only valid if the index didn't change
+	return _block.index.testAndSetOrdered( _index, _index );
+}
+
+
+
+
+bool SampleStream::isLoaded( int _index )
+{
+	if( _index < HeadBlocks )
+	{
+		return true;
+	}
+	for( int c = 0; c < NumCues; ++c )
+	{
+		for( int i = 0; i < CueBlocks; ++i )
+		{
+			if( (int) m_cues[c].blocks[i].index == _index )
+			{
+				return true;
+			}
+		}
+	}
+	return (int) m_ring[_index % RingBlocks].index == _index;
+}
+
+
+
+
+bool SampleStream::service()
+{
+	const int blocks = blockCount();
+
+	// cue windows go first, playback may jump there any time
+	for( int c = 0; c < NumCues; ++c )
+	{
+		Cue & cue = m_cues[c];
+		const int first = cue.requested;
+		if( first < 0 )
+		{
+			continue;
+		}
+		for( int i = 0; i < CueBlocks && first + i < blocks; ++i )
+		{
+			const int index = first + i;
+			if( index >= HeadBlocks &&
+					(int) cue.blocks[i].index != index )
+			{
+				loadBlock( cue.blocks[i], index );
+				return true;
+			}
+		}
+	}
+
+	const int readBlock = m_readBlock;
+	const int last = qMin( readBlock + ReadAheadBlocks, blocks );
+	for( int index = qMax( readBlock, HeadBlocks ); index < last; ++index )
+	{
+		if( !isLoaded( index ) )
+		{
+			loadBlock( m_ring[index % RingBlocks], index );
+			return true;
+		}
+	}
+
+	// playback is taken care of, continue scanning the peaks
+	if( m_peaks->frames() < m_frames )
+	{
+		loadBlock( m_scan, m_peaks->frames() / BlockFrames );
+		return true;
+	}
+
+	return false;
+}
+
+
+
+
+void SampleStream::loadBlock( Block & _block, int _index )
+{
+	// readers ignore the block until it has been filled completely
+	_block.index.fetchAndStoreOrdered( -1 );
+
+	if( _index != m_nextBlock )
+	{
+		seek( _index );
+	}
+	decode( _block.frames, BlockFrames );
+	m_nextBlock = _index + 1;
+
+	// peaks have to be added in order, blocks loaded for playback ahead
+	// of the scan are scanned again later on
+	if( _index * BlockFrames == m_peaks->frames() )
+	{
+		m_peaks->add( _block.frames, qMin( BlockFrames,
+					m_frames - _index * BlockFrames ) );
+	}
+
+	_block.index.fetchAndStoreOrdered( _index );
+}
+
+
+
+
+void SampleStream::seek( int _index )
+{
+	const sf_count_t pos = static_cast<sf_count_t>(
+				(double) _index * BlockFrames / m_ratio );
+	sf_seek( m_sndFile, pos, SEEK_SET );
+	if( m_srcState != NULL )
+	{
+		src_reset( m_srcState );
+	}
+	m_inputFrames = 0;
+	m_inputPos = 0;
+	m_eof = false;
+}
+
+
+
+
+f_cnt_t SampleStream::decode( sampleFrame * _dst, f_cnt_t _frames )
+{
+	f_cnt_t done = 0;
+	while( done < _frames )
+	{
+		if( m_inputPos == m_inputFrames && !m_eof )
+		{
+			m_inputFrames = readInput();
+			m_inputPos = 0;
+			m_eof = m_inputFrames == 0;
+		}
+
+		if( m_srcState == NULL )
+		{
+			if( m_inputPos == m_inputFrames )
+			{
+				break;
+			}
+			const f_cnt_t n = qMin( _frames - done,
+						m_inputFrames - m_inputPos );
+			memcpy( _dst + done, m_input + m_inputPos,
+							n * BYTES_PER_FRAME );
+			m_inputPos += n;
+			done += n;
+			continue;
+		}
+
+		SRC_DATA src_data;
+		src_data.data_in = m_input[m_inputPos];
+		src_data.input_frames = m_inputFrames - m_inputPos;
+		src_data.data_out = _dst[done];
+		src_data.output_frames = _frames - done;
+		src_data.src_ratio = m_ratio;
+		src_data.end_of_input = m_eof ? 1 : 0;
+		const int error = src_process( m_srcState, &src_data );
+		if( error )
+		{
+			fprintf( stderr, "SampleStream: error while resampling:"
+					" %s\n", src_strerror( error ) );
+			break;
+		}
+		m_inputPos += src_data.input_frames_used;
+		done += src_data.output_frames_gen;
+		if( m_eof && src_data.output_frames_gen == 0 )
+		{
+			break;
+		}
+	}
+
+	memset( _dst + done, 0, ( _frames - done ) * BYTES_PER_FRAME );
+
+	return done;
+}
+
+
+
+
+f_cnt_t SampleStream::readInput()
+{
+	const f_cnt_t frames = sf_readf_float( m_sndFile, m_interleaved,
+								InputFrames );
+	const int ch = ( m_channels > 1 ) ? 1 : 0;
+
+	int idx = 0;
+	for( f_cnt_t frame = 0; frame < frames; ++frame )
+	{
+		m_input[frame][0] = m_interleaved[idx+0];
+		m_input[frame][1] = m_interleaved[idx+ch];
+		idx += m_channels;
+	}
+
+	return qMax<f_cnt_t>( frames, 0 );
+}
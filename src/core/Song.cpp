@@ -52,8 +52,10 @@
 #include "FileDialog.h"
 #include "Pattern.h"
 #include "PianoRoll.h"
+#include "ProjectBundle.h"
 #include "ProjectJournal.h"
 #include "ProjectNotes.h"
+#include "SamplePreloader.h"
 #include "SongEditor.h"
 #include "TextFloat.h"
 #include "TimeLineWidget.h"
@@ -1039,6 +1041,14 @@ void Song::loadProject( const QString & fileName )
 
 	clearErrors();
 
+	// decode all samples at once instead of one after another while
+	// the tracks are being loaded
+	SamplePreloader preloader;
+	if( !preloader.load( dataFile.content() ) )
+	{
+		loadingCancelled();
+	}
+
 	Engine::mixer()->requestChangeInModel();
 
 	// get the header information from the DOM
@@ -1195,6 +1205,9 @@ void Song::loadProject( const QString & fileName )
 bool Song::saveProjectFile( const QString & filename )
 {
 	DataFile dataFile( DataFile::SongProject );
+	// project bundles store embedded samples as binary entries
+	dataFile.setBundled( ProjectBundle::isBundleName(
+				dataFile.nameWithExtension( filename ) ) );
 
 	m_tempoModel.saveSettings( dataFile, dataFile.head(), "bpm" );
 	m_timeSigModel.saveSettings( dataFile, dataFile.head(), "timesig" );
@@ -59,6 +59,7 @@
 #include "GuiApplication.h"
 #include "FxMixerView.h"
 #include "gui_templates.h"
+#include "InstrumentTrack.h"
 #include "MainWindow.h"
 #include "Mixer.h"
 #include "ProjectJournal.h"
@@ -1860,6 +1861,21 @@ void TrackOperationsWidget::updateMenu()
 		QMenu *fxMenu = trackView->createFxMenu( tr( "FX %1: %2" ), tr( "Assign to new FX Channel" ));
 		toMenu->addMenu(fxMenu);
 
+		// freezing renders the whole song, so it's limited to song tracks
+		if( trackView->model()->trackContainer() == Engine::getSong() )
+		{
+			if( trackView->model()->isFrozen() )
+			{
+				toMenu->addAction( tr( "Unfreeze this track" ),
+						trackView->model(), SLOT( unfreeze() ) );
+			}
+			else
+			{
+				toMenu->addAction( tr( "Freeze this track" ),
+						trackView, SLOT( freezeTrack() ) );
+			}
+		}
+
 		toMenu->addSeparator();
 		toMenu->addMenu( trackView->midiMenu() );
 	}
@@ -2492,6 +2508,16 @@ BoolModel *Track::getMutedModel()
 
 
 
+void Track::setMutedWithoutJournalling( bool muted )
+{
+	m_mutedModel.saveJournallingState( false );
+	m_mutedModel.setValue( muted );
+	m_mutedModel.restoreJournallingState();
+}
+
+
+
+
 
 
 // ===========================================================================
@@ -0,0 +1,181 @@
+/*
+ * TrackFreezer.cpp - renders an instrument track into its freeze cache
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "TrackFreezer.h"
+#include "BBTrackContainer.h"
+#include "Engine.h"
+#include "FreezeCache.h"
+#include "InstrumentTrack.h"
+#include "Mixer.h"
+#include "Song.h"
+
+
+TrackFreezer::TrackFreezer( InstrumentTrack * _track ) :
+	QThread( Engine::mixer() ),
+	m_track( _track ),
+	m_cache( new FreezeCache ),
+	m_trackWasMuted( false ),
+	m_progress( 0 ),
+	m_abort( false )
+{
+	connect( this, SIGNAL( finished() ),
+			this, SLOT( finishProcessing() ) );
+}
+
+
+
+
+TrackFreezer::~TrackFreezer()
+{
+	sharedObject::unref( m_cache );
+}
+
+
+
+
+void TrackFreezer::startProcessing()
+{
+	Song * song = Engine::getSong();
+	Mixer * mixer = Engine::mixer();
+
+	// mute everything but the track we are about to freeze - we only
+	// capture its own audio port, so the other tracks would just waste
+	// CPU time - automation tracks stay, as muted ones don't automate
+	// anything, and so do BB tracks, which drive the automation and the
+	// tracks of the beat/bassline editor
+	TrackContainer::TrackList tracks = song->tracks();
+	tracks += Engine::getBBTrackContainer()->tracks();
+	for( Track * track : tracks )
+	{
+		if( track->type() == Track::AutomationTrack ||
+			track->type() == Track::HiddenAutomationTrack ||
+				track->type() == Track::BBTrack )
+		{
+			continue;
+		}
+		if( track != m_track && track->isMuted() == false )
+		{
+			track->setMutedWithoutJournalling( true );
+			m_mutedTracks.push_back( track );
+		}
+	}
+	m_trackWasMuted = m_track->isMuted();
+	m_track->setMutedWithoutJournalling( false );
+
+	// render the whole song plus one bar of padding for effect tails, just
+	// like a non-looped export does
+	song->setExportLoop( false );
+	song->setRenderBetweenMarkers( false );
+	const f_cnt_t frames = static_cast<f_cnt_t>(
+			( m_track->length() + 1 ) * MidiTime::ticksPerTact() *
+						Engine::framesPerTick() ) +
+							mixer->framesPerPeriod();
+
+	if( m_cache->allocate( frames, mixer->processingSampleRate(),
+					m_track->freezeStateHash() ) == false )
+	{
+		m_abort = true;
+		finishProcessing();
+		return;
+	}
+
+	// render in our own thread instead of the audio device's one
+	mixer->stopProcessing();
+
+	start(
+#ifndef LMMS_BUILD_WIN32
+		QThread::HighPriority
+#endif
+					);
+}
+
+
+
+
+void TrackFreezer::abortProcessing()
+{
+	m_abort = true;
+	wait();
+}
+
+
+
+
+void TrackFreezer::run()
+{
+	MemoryManager::ThreadGuard mmThreadGuard; Q_UNUSED(mmThreadGuard);
+
+	Song * song = Engine::getSong();
+	song->startExport();
+	song->updateLength();
+
+	const Song::PlayPos & exportPos = song->getPlayPos( Song::Mode_PlaySong );
+	const tick_t endTick = song->getExportEndpoints().second.getTicks();
+
+	// unlike ProjectRenderer we don't have to skip the first buffer, as the
+	// audio port is captured while the period is being rendered
+	m_track->audioPort()->setFreezeCapture( m_cache );
+
+	while( exportPos.getTicks() < endTick && song->isExporting() &&
+								!m_abort )
+	{
+		Engine::mixer()->nextBuffer();
+
+		const int progress = endTick == 0 ? 100 :
+					exportPos.getTicks() * 100 / endTick;
+		if( m_progress != progress )
+		{
+			m_progress = progress;
+			emit progressChanged( m_progress );
+		}
+	}
+
+	m_track->audioPort()->setFreezeCapture( NULL );
+
+	song->stopExport();
+}
+
+
+
+
+void TrackFreezer::finishProcessing()
+{
+	for( Track * track : m_mutedTracks )
+	{
+		track->setMutedWithoutJournalling( false );
+	}
+	m_mutedTracks.clear();
+	m_track->setMutedWithoutJournalling( m_trackWasMuted );
+
+	// the mixer was only stopped if we got a cache to render into
+	if( m_cache->isValid() )
+	{
+		Engine::mixer()->startProcessing();
+	}
+
+	if( m_abort == false )
+	{
+		m_track->setFreezeCache( m_cache );
+	}
+
+	emit freezeFinished();
+}
@@ -49,6 +49,7 @@ VstSyncController::VstSyncController() :
 	if( ConfigManager::inst()->value( "ui", "syncvstplugins" ).toInt() )
 	{
 		connect( Engine::mixer(), SIGNAL( sampleRateChanged() ), this, SLOT( updateSampleRate() ) );
+		connect( Engine::mixer(), SIGNAL( framesPerPeriodChanged() ), this, SLOT( update() ) );
 
 #ifdef USE_QT_SHMEM
 		if ( m_shm.create( sizeof( VstSyncData ) ) )
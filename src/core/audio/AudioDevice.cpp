@@ -28,6 +28,7 @@
 #include "ConfigManager.h"
 #include "debug.h"
 #include "Mixer.h"
+#include "MixHelpers.h"
 
 
 
@@ -36,15 +37,20 @@ AudioDevice::AudioDevice( const ch_cnt_t _channels, Mixer*  _mixer ) :
 	m_sampleRate( _mixer->processingSampleRate() ),
 	m_channels( _channels ),
 	m_mixer( _mixer ),
+	m_srcInterpolation( mixer()->currentQualitySettings().libsrcInterpolation() ),
+	m_resampled( NULL ),
+	m_resampledSize( 0 ),
+	m_resampledFrames( 0 ),
 	m_buffer( new surroundSampleFrame[mixer()->framesPerPeriod()] )
 {
 	int error;
-	if( ( m_srcState = src_new(
-		mixer()->currentQualitySettings().libsrcInterpolation(),
+	if( ( m_srcState = src_new( m_srcInterpolation,
 				SURROUND_CHANNELS, &error ) ) == NULL )
 	{
 		printf( "Error: src_new() failed in audio_device.cpp!\n" );
 	}
+
+	reserveResampled();
 }
 
 
@@ -53,6 +59,7 @@ AudioDevice::AudioDevice( const ch_cnt_t _channels, Mixer*  _mixer ) :
 AudioDevice::~AudioDevice()
 {
 	src_delete( m_srcState );
+	delete[] m_resampled;
 	delete[] m_buffer;
 
 	m_devMutex.tryLock();
@@ -80,33 +87,85 @@ void AudioDevice::processNextBuffer()
 
 fpp_t AudioDevice::getNextBuffer( surroundSampleFrame * _ab )
 {
-	fpp_t frames = mixer()->framesPerPeriod();
+	// resample if necessary
+	if( mixer()->processingSampleRate() != m_sampleRate )
+	{
+		return getNextResampledBuffer( _ab );
+	}
+
+	const fpp_t frames = mixer()->framesPerPeriod();
 	const surroundSampleFrame * b = mixer()->nextBuffer();
 	if( !b )
 	{
 		return 0;
 	}
 
-	// make sure, no other thread is accessing device
+	memcpy( _ab, b, frames * sizeof( surroundSampleFrame ) );
+
+	if( mixer()->hasFifoWriter() )
+	{
+		delete[] b;
+	}
+
+	return frames;
+}
+
+
+
+
+fpp_t AudioDevice::getNextResampledBuffer( surroundSampleFrame * _ab )
+{
+	const fpp_t fpp = mixer()->framesPerPeriod();
+	const sample_rate_t srcRate = mixer()->processingSampleRate();
+
+	// a resampled period usually doesn't have the size of the callers'
+	// buffers, so what doesn't fit is kept for the next call, which only
+	// fetches a new period if not enough frames are left - only this
+	// thread consumes them, so waiting for the mixer needs no lock
+	const surroundSampleFrame * b = NULL;
+	if( m_resampledFrames < fpp )
+	{
+		b = mixer()->nextBuffer();
+		if( !b )
+		{
+			return 0;
+		}
+	}
+
+	// make sure, no other thread is accessing the converter
 	lock();
 
-	// resample if necessary
-	if( mixer()->processingSampleRate() != m_sampleRate )
+	if( b != NULL )
 	{
-		resample( b, frames, _ab, mixer()->processingSampleRate(),
-								m_sampleRate );
-		frames = frames * m_sampleRate /
-					mixer()->processingSampleRate();
+		// reserveResampled() left enough room for the converter to
+		// always take all input, so nothing has to be fed back
+		m_resampledFrames += resample( b, fpp,
+					m_resampled + m_resampledFrames,
+					m_resampledSize - m_resampledFrames,
+						srcRate, m_sampleRate );
+	}
+
+	fpp_t frames = qMin<f_cnt_t>( m_resampledFrames, fpp );
+	if( frames > 0 )
+	{
+		memcpy( _ab, m_resampled, frames *
+					sizeof( surroundSampleFrame ) );
+		m_resampledFrames -= frames;
+		memmove( m_resampled, m_resampled + frames,
+			m_resampledFrames * sizeof( surroundSampleFrame ) );
 	}
 	else
 	{
-		memcpy( _ab, b, frames * sizeof( surroundSampleFrame ) );
+		// the sinc converters need some input before giving out
+		// anything - hand out silence, as no frames mean "stop"
+		frames = qBound<f_cnt_t>( 1, (f_cnt_t) fpp * m_sampleRate /
+							srcRate, fpp );
+		memset( _ab, 0, frames * sizeof( surroundSampleFrame ) );
 	}
 
-	// release lock
 	unlock();
 
-	if( mixer()->hasFifoWriter() )
+	if( b != NULL && mixer()->hasFifoWriter() )
 	{
 		delete[] b;
 	}
@@ -149,15 +208,63 @@ void AudioDevice::stopProcessingThread( QThread * thread )
 
 void AudioDevice::applyQualitySettings()
 {
+	const int interpolation =
+		mixer()->currentQualitySettings().libsrcInterpolation();
+
+	lock();
+	m_resampledFrames = 0;
+	reserveResampled();
+	if( m_srcState != NULL && interpolation == m_srcInterpolation )
+	{
+		// keep the converter, just drop what it buffered at the old
+		// sample rate
+		src_reset( m_srcState );
+		unlock();
+		return;
+	}
+
 	src_delete( m_srcState );
 
 	int error;
-	if( ( m_srcState = src_new(
-		mixer()->currentQualitySettings().libsrcInterpolation(),
+	if( ( m_srcState = src_new( interpolation,
 				SURROUND_CHANNELS, &error ) ) == NULL )
 	{
 		printf( "Error: src_new() failed in audio_device.cpp!\n" );
 	}
+	m_srcInterpolation = interpolation;
+	unlock();
+}
+
+
+
+
+void AudioDevice::setSampleRate( const sample_rate_t _new_sr )
+{
+	lock();
+	m_sampleRate = _new_sr;
+	reserveResampled();
+	unlock();
+}
+
+
+
+
+void AudioDevice::reserveResampled()
+{
+	// less than a period left over plus a resampled period, so the audio
+	// callback never has to allocate
+	const fpp_t fpp = mixer()->framesPerPeriod();
+	const f_cnt_t size = 2 * fpp + (f_cnt_t) fpp * m_sampleRate /
+					mixer()->processingSampleRate();
+	if( size > m_resampledSize )
+	{
+		surroundSampleFrame * resampled = new surroundSampleFrame[size];
+		memcpy( resampled, m_resampled, m_resampledFrames *
+					sizeof( surroundSampleFrame ) );
+		delete[] m_resampled;
+		m_resampled = resampled;
+		m_resampledSize = size;
+	}
 }
 
 
@@ -184,18 +291,19 @@ void AudioDevice::renamePort( AudioPort * )
 
 
 
-void AudioDevice::resample( const surroundSampleFrame * _src,
+f_cnt_t AudioDevice::resample( const surroundSampleFrame * _src,
 						const fpp_t _frames,
 						surroundSampleFrame * _dst,
+						const f_cnt_t _dst_frames,
 						const sample_rate_t _src_sr,
 						const sample_rate_t _dst_sr )
 {
 	if( m_srcState == NULL )
 	{
-		return;
+		return 0;
 	}
 	m_srcData.input_frames = _frames;
-	m_srcData.output_frames = _frames;
+	m_srcData.output_frames = _dst_frames;
 	m_srcData.data_in = (float *) _src[0];
 	m_srcData.data_out = _dst[0];
 	m_srcData.src_ratio = (double) _dst_sr / _src_sr;
@@ -205,7 +313,10 @@ void AudioDevice::resample( const surroundSampleFrame * _src,
 	{
 		printf( "AudioDevice::resample(): error while resampling: %s\n",
 							src_strerror( error ) );
+		return 0;
 	}
+
+	return m_srcData.output_frames_gen;
 }
 
 
@@ -216,33 +327,20 @@ int AudioDevice::convertToS16( const surroundSampleFrame * _ab,
 								int_sample_t * _output_buffer,
 								const bool _convert_endian )
 {
-	if( _convert_endian )
+	if( channels() == SURROUND_CHANNELS )
 	{
-		int_sample_t temp;
-		for( fpp_t frame = 0; frame < _frames; ++frame )
-		{
-			for( ch_cnt_t chnl = 0; chnl < channels(); ++chnl )
-			{
-				temp = static_cast<int_sample_t>( Mixer::clip( _ab[frame][chnl] * _master_gain ) * OUTPUT_SAMPLE_MULTIPLIER );
-				
-				( _output_buffer + frame * channels() )[chnl] =
-						( temp & 0x00ff ) << 8 |
-						( temp & 0xff00 ) >> 8;
-			}
-		}
+		// frames are packed without gaps, so convert them in one go
+		MixHelpers::convertToS16( _output_buffer, _ab[0], _master_gain,
+					_frames * channels(), _convert_endian );
 	}
 	else
 	{
 		for( fpp_t frame = 0; frame < _frames; ++frame )
 		{
-			for( ch_cnt_t chnl = 0; chnl < channels(); ++chnl )
-			{
-				( _output_buffer + frame * channels() )[chnl] =
-						static_cast<int_sample_t>(
-						Mixer::clip( _ab[frame][chnl] *
-						_master_gain ) *
-						OUTPUT_SAMPLE_MULTIPLIER );
-			}
+			MixHelpers::convertToS16(
+					_output_buffer + frame * channels(),
+					_ab[frame], _master_gain, channels(),
+							_convert_endian );
 		}
 	}
 
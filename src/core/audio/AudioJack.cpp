@@ -36,10 +36,14 @@
 #include "gui_templates.h"
 #include "ConfigManager.h"
 #include "LcdSpinBox.h"
+#include "LedCheckbox.h"
 #include "AudioPort.h"
 #include "MainWindow.h"
+#include "ToolTip.h"
 #include "Mixer.h"
 #include "MidiJack.h"
+#include "MixerWorkerThread.h"
+#include "denormals.h"
 
 
 
@@ -53,6 +57,9 @@ AudioJack::AudioJack( bool & _success_ful, Mixer*  _mixer ) :
 	m_midiClient( NULL ),
 	m_tempOutBufs( new jack_default_audio_sample_t *[channels()] ),
 	m_outBuf( new surroundSampleFrame[mixer()->framesPerPeriod()] ),
+	m_renderInCallback( ConfigManager::inst()->value( "audiojack",
+					"rendercallback" ).toInt() != 0 ),
+	m_curBuf( m_outBuf ),
 	m_framesDoneInCurBuf( 0 ),
 	m_framesToDoInCurBuf( 0 )
 {
@@ -216,6 +223,12 @@ void AudioJack::startProcessing()
 
 	m_active = true;
 
+	if( m_renderInCallback )
+	{
+		// the workers have to keep up with JACK's realtime thread
+		MixerWorkerThread::setRealtimePriority(
+				jack_client_real_time_priority( m_client ) );
+	}
 
 	// try to sync JACK's and LMMS's buffer-size
 //	jack_set_buffer_size( m_client, mixer()->framesPerPeriod() );
@@ -254,6 +267,15 @@ void AudioJack::startProcessing()
 void AudioJack::stopProcessing()
 {
 	m_stopped = true;
+
+	// the mixer mustn't be rendering anymore once this returns - while
+	// the model is being changed by us, the callback doesn't render
+	// anyway and might even be waiting for us to finish
+	if( !mixer()->isChangingModel() )
+	{
+		m_renderMutex.lock();
+		m_renderMutex.unlock();
+	}
 }
 
 
@@ -379,11 +401,28 @@ int AudioJack::processCallback( jack_nframes_t _nframes, void * _udata )
 	}
 #endif
 
+	// when rendering here, JACK periods which aren't a multiple of the
+	// mixer's are made up of parts of several mixer periods
+	bool render = false;
+	if( m_renderInCallback && m_renderMutex.tryLock() )
+	{
+		render = mixer()->startCallbackRendering();
+		if( render )
+		{
+			disable_denormals();
+		}
+		else
+		{
+			m_renderMutex.unlock();
+		}
+	}
+
 	jack_nframes_t done = 0;
-	while( done < _nframes && m_stopped == false )
+	while( done < _nframes && m_stopped == false &&
+				( render || !m_renderInCallback ) )
 	{
 		jack_nframes_t todo = qMin<jack_nframes_t>(
-						_nframes,
+						_nframes - done,
 						m_framesToDoInCurBuf -
 							m_framesDoneInCurBuf );
 		const float gain = mixer()->masterGain();
@@ -392,14 +431,26 @@ int AudioJack::processCallback( jack_nframes_t _nframes, void * _udata )
 			jack_default_audio_sample_t * o = m_tempOutBufs[c];
 			for( jack_nframes_t frame = 0; frame < todo; ++frame )
 			{
-				o[done+frame] = m_outBuf[m_framesDoneInCurBuf+frame][c] * gain;
+				o[done+frame] = m_curBuf[m_framesDoneInCurBuf+frame][c] * gain;
 			}
 		}
 		done += todo;
 		m_framesDoneInCurBuf += todo;
 		if( m_framesDoneInCurBuf == m_framesToDoInCurBuf )
 		{
-			m_framesToDoInCurBuf = getNextBuffer( m_outBuf );
+			if( render && mixer()->processingSampleRate() ==
+								sampleRate() )
+			{
+				// no need to copy the mixer's buffer, it stays
+				// valid until the next one is rendered here
+				m_curBuf = mixer()->nextBuffer();
+				m_framesToDoInCurBuf = mixer()->framesPerPeriod();
+			}
+			else
+			{
+				m_framesToDoInCurBuf = getNextBuffer( m_outBuf );
+				m_curBuf = m_outBuf;
+			}
 			m_framesDoneInCurBuf = 0;
 			if( !m_framesToDoInCurBuf )
 			{
@@ -409,6 +460,12 @@ int AudioJack::processCallback( jack_nframes_t _nframes, void * _udata )
 		}
 	}
 
+	if( render )
+	{
+		m_renderMutex.unlock();
+		mixer()->finishCallbackRendering();
+	}
+
 	if( _nframes != done )
 	{
 		for( int c = 0; c < channels(); ++c )
@@ -470,6 +527,14 @@ AudioJack::setupWidget::setupWidget( QWidget * _parent ) :
 	m_channels->setLabel( tr( "CHANNELS" ) );
 	m_channels->move( 180, 20 );
 
+	m_renderInCallback = new LedCheckBox( tr( "Render in callback" ),
+									this );
+	m_renderInCallback->move( 236, 24 );
+	m_renderInCallback->setChecked( ConfigManager::inst()->value(
+				"audiojack", "rendercallback" ).toInt() );
+	ToolTip::add( m_renderInCallback, tr( "Render right in JACK's "
+		"realtime callback - saves a period of latency, but model "
+		"changes can make JACK drop out" ) );
 }
 
 
@@ -489,6 +554,8 @@ void AudioJack::setupWidget::saveSettings()
 							m_clientName->text() );
 	ConfigManager::inst()->setValue( "audiojack", "channels",
 				QString::number( m_channels->value<int>() ) );
+	ConfigManager::inst()->setValue( "audiojack", "rendercallback",
+			QString::number( m_renderInCallback->model()->value() ) );
 }
 
 
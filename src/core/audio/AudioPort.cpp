@@ -28,8 +28,10 @@
 #include "FxMixer.h"
 #include "Engine.h"
 #include "Mixer.h"
+#include "MixerProfiler.h"
 #include "MixHelpers.h"
 #include "BufferManager.h"
+#include "FreezeCache.h"
 
 
 AudioPort::AudioPort( const QString & _name, bool _has_effect_chain,
@@ -43,7 +45,9 @@ AudioPort::AudioPort( const QString & _name, bool _has_effect_chain,
 	m_effects( _has_effect_chain ? new EffectChain( NULL ) : NULL ),
 	m_volumeModel( volumeModel ),
 	m_panningModel( panningModel ),
-	m_mutedModel( mutedModel )
+	m_mutedModel( mutedModel ),
+	m_frozen( false ),
+	m_freezeCapture( NULL )
 {
 	Engine::mixer()->addAudioPort( this );
 	setExtOutputEnabled( true );
@@ -109,6 +113,8 @@ void AudioPort::doProcessing()
 		return;
 	}
 
+	MixerProfiler::Scope profilerScope( MixerProfiler::AudioPortJob, this );
+
 	const fpp_t fpp = Engine::mixer()->framesPerPeriod();
 
 	// clear the buffer
@@ -131,6 +137,18 @@ void AudioPort::doProcessing()
 		}
 	}
 
+	// a frozen track's play-handle already delivers the final post-effect
+	// signal, so volume, panning and effects must not be applied again
+	if( m_frozen )
+	{
+		if( m_bufferUsage )
+		{
+			Engine::fxMixer()->mixToChannel( m_portBuffer, m_nextFxChannel );
+			m_bufferUsage = false;
+		}
+		return;
+	}
+
 	if( m_bufferUsage )
 	{
 		// handle volume and panning
@@ -221,6 +239,15 @@ void AudioPort::doProcessing()
 
 	// handle effects
 	const bool me = processEffects();
+
+	// record what we're about to send to the fx mixer while a track is
+	// being frozen - silent periods are written too so the cache stays in
+	// sync with the song position
+	if( m_freezeCapture )
+	{
+		m_freezeCapture->write( m_portBuffer, fpp );
+	}
+
 	if( me || m_bufferUsage )
 	{
 		Engine::fxMixer()->mixToChannel( m_portBuffer, m_nextFxChannel ); 	// send output to fx mixer
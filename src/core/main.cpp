@@ -57,6 +57,7 @@
 #include <signal.h>
 
 #include "MainApplication.h"
+#include "Benchmark.h"
 #include "ConfigManager.h"
 #include "NotePlayHandle.h"
 #include "embed.h"
@@ -67,7 +68,9 @@
 #include "MixHelpers.h"
 #include "OutputSettings.h"
 #include "ProjectRenderer.h"
+#include "RenderCache.h"
 #include "RenderManager.h"
+#include "SampleInterpolator.h"
 #include "Song.h"
 #include "SetupDialog.h"
 
@@ -117,6 +120,8 @@ void printHelp()
 		"Usage: lmms [global options...] [<action> [action parameters...]]\n\n"
 		"Actions:\n"
 		"  <no action> [options...] [<project>]  Start LMMS in normal GUI mode\n"
+		"  bench [options...]                    Render a synthetic project and\n"
+		"                                        report the mixer's speed as JSON\n"
 		"  dump <in>                             Dump XML of compressed file <in>\n"
 		"  render <project> [options...]         Render given project file\n"
 		"  rendertracks <project> [options...]   Render each track to a different file\n"
@@ -139,6 +144,10 @@ void printHelp()
 		"  -a, --float                    Use 32bit float bit depth\n"
 		"  -b, --bitrate <bitrate>        Specify output bitrate in KBit/s\n"
 		"          Default: 160.\n"
+		"      --cache-dir <dir>          Reuse unchanged tracks and FX channels\n"
+		"          of previous renders kept in <dir>\n"
+		"      --cache-size <size>        Limit the render cache to <size> MB\n"
+		"          Default: 2048\n"
 		"  -f, --format <format>         Specify format of render-output where\n"
 		"          Format is either 'wav', 'flac', 'ogg' or 'mp3'.\n"
 		"  -i, --interpolation <method>   Specify interpolation method\n"
@@ -160,11 +169,28 @@ void printHelp()
 		"          If not specified, render will overwrite the input file\n"
 		"          For \"rendertracks\", this might be required\n"
 		"  -p, --profile <out>            Dump profiling information to file <out>\n"
+		"          If <out> ends with .json, a Chrome trace of all\n"
+		"          instruments, effects and FX channels is written\n"
 		"  -s, --samplerate <samplerate>  Specify output samplerate in Hz\n"
 		"          Range: 44100 (default) to 192000\n"
 		"  -x, --oversampling <value>     Specify oversampling\n"
 		"          Possible values: 1, 2, 4, 8\n"
-		"          Default: 2\n\n",
+		"          Default: 2\n"
+		"\nOptions for \"bench\" (besides -i, -s and -x):\n"
+		"      --tracks <n>               Number of instrument tracks\n"
+		"          Default: 16\n"
+		"      --voices <n>               Notes played at once on each track\n"
+		"          Default: 4\n"
+		"      --instrument <plugin>      Instrument to use on all tracks\n"
+		"          Default: tripleoscillator\n"
+		"      --effects <plugins>        Comma-separated effect chain of each\n"
+		"          track, e.g. \"bassbooster,reverbsc\"\n"
+		"      --periods <n>              Number of periods to measure\n"
+		"          Default: 2000\n"
+		"      --threads <list>           Comma-separated numbers of mixer\n"
+		"          threads to benchmark. Default: 1, 2, 4, ... up to all threads\n"
+		"  -o, --output <path>            Write the results to <path> instead\n"
+		"          of standard out\n\n",
 		LMMS_VERSION, LMMS_PROJECT_COPYRIGHT );
 }
 
@@ -208,6 +234,7 @@ int main( int argc, char * * argv )
 	bool allowRoot = false;
 	bool renderLoop = false;
 	bool renderTracks = false;
+	bool benchmark = false;
 	QString fileToLoad, fileToImport, renderOut, profilerOutputFile, configFile;
 
 	// first of two command-line parsing stages
@@ -226,6 +253,11 @@ int main( int argc, char * * argv )
 			coreOnly = true;
 			renderTracks = true;
 		}
+		else if( arg == "bench" || arg == "--bench" )
+		{
+			coreOnly = true;
+			benchmark = true;
+		}
 		else if( arg == "--allowroot" )
 		{
 			allowRoot = true;
@@ -267,6 +299,13 @@ int main( int argc, char * * argv )
 	OutputSettings os( 44100, OutputSettings::BitRateSettings(160, false), OutputSettings::Depth_16Bit, OutputSettings::StereoMode_JointStereo );
 	ProjectRenderer::ExportFileFormats eff = ProjectRenderer::WaveFile;
 
+	int benchTracks = 16;
+	int benchVoices = 4;
+	int benchPeriods = 2000;
+	QString benchInstrument = "tripleoscillator";
+	QStringList benchEffects;
+	QList<int> benchThreads;
+
 	// second of two command-line parsing stages
 	for( int i = 1; i < argc; ++i )
 	{
@@ -355,6 +394,86 @@ int main( int argc, char * * argv )
 			fileToLoad = QString::fromLocal8Bit( argv[i] );
 			renderOut = fileToLoad;
 		}
+		else if( arg == "bench" || arg == "--bench" )
+		{
+			// Ignore, processed earlier
+		}
+		else if( arg == "--tracks" || arg == "--voices" ||
+						arg == "--periods" )
+		{
+			++i;
+
+			const int n = i < argc ? QString( argv[i] ).toInt() : 0;
+			if( n < 1 )
+			{
+				printf( "\nInvalid or missing value for %s.\n\n"
+	"Try \"%s --help\" for more information.\n\n", arg.toUtf8().constData(), argv[0] );
+				return EXIT_FAILURE;
+			}
+
+			if( arg == "--tracks" )
+			{
+				benchTracks = n;
+			}
+			else if( arg == "--voices" )
+			{
+				benchVoices = n;
+			}
+			else
+			{
+				benchPeriods = n;
+			}
+		}
+		else if( arg == "--instrument" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				printf( "\nNo instrument specified.\n\n"
+	"Try \"%s --help\" for more information.\n\n", argv[0] );
+				return EXIT_FAILURE;
+			}
+
+			benchInstrument = QString( argv[i] );
+		}
+		else if( arg == "--effects" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				printf( "\nNo effects specified.\n\n"
+	"Try \"%s --help\" for more information.\n\n", argv[0] );
+				return EXIT_FAILURE;
+			}
+
+			benchEffects = QString( argv[i] ).split( ',',
+						QString::SkipEmptyParts );
+		}
+		else if( arg == "--threads" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				printf( "\nNo thread counts specified.\n\n"
+	"Try \"%s --help\" for more information.\n\n", argv[0] );
+				return EXIT_FAILURE;
+			}
+
+			for( const QString & n : QString( argv[i] ).split( ',',
+						QString::SkipEmptyParts ) )
+			{
+				if( n.toInt() < 1 )
+				{
+					printf( "\nInvalid thread count %s.\n\n"
+	"Try \"%s --help\" for more information.\n\n", n.toUtf8().constData(), argv[0] );
+					return EXIT_FAILURE;
+				}
+				benchThreads << n.toInt();
+			}
+		}
 		else if( arg == "--loop" || arg == "-l" )
 		{
 			renderLoop = true;
@@ -457,6 +576,46 @@ int main( int argc, char * * argv )
 			else
 			{
 				printf( "\nInvalid bitrate %s.\n\n"
+	"Try \"%s --help\" for more information.\n\n", argv[i], argv[0] );
+				return EXIT_FAILURE;
+			}
+		}
+		else if( arg == "--cache-dir" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				printf( "\nNo cache directory specified.\n\n"
+	"Try \"%s --help\" for more information.\n\n", argv[0] );
+				return EXIT_FAILURE;
+			}
+
+
+			RenderCache::setDirectory( QString::fromLocal8Bit( argv[i] ) );
+		}
+		else if( arg == "--cache-size" )
+		{
+			++i;
+
+			if( i == argc )
+			{
+				printf( "\nNo cache size specified.\n\n"
+	"Try \"%s --help\" for more information.\n\n", argv[0] );
+				return EXIT_FAILURE;
+			}
+
+
+			bool ok;
+			const qint64 size = QString( argv[i] ).toLongLong( &ok );
+
+			if( ok && size >= 0 )
+			{
+				RenderCache::setSizeLimit( size * 1024 * 1024 );
+			}
+			else
+			{
+				printf( "\nInvalid cache size %s.\n\n"
 	"Try \"%s --help\" for more information.\n\n", argv[i], argv[0] );
 				return EXIT_FAILURE;
 			}
@@ -644,6 +803,9 @@ int main( int argc, char * * argv )
 	MixHelpers::setNaNHandler( ConfigManager::inst()->value( "app",
 						"nanhandler", "1" ).toInt() );
 
+	SampleInterpolator::setEnabled( ConfigManager::inst()->value( "mixer",
+					"builtininterpolator" ).toInt() );
+
 	// set language
 	QString pos = ConfigManager::inst()->value( "app", "language" );
 	if( pos.isEmpty() )
@@ -703,9 +865,62 @@ int main( int argc, char * * argv )
 
 	bool destroyEngine = false;
 
+	if( benchmark )
+	{
+		// the mixer's sample rate is taken from the configuration when
+		// creating the audio device - the user's setting is restored
+		// before the configuration gets written on shutdown
+		const QString userSampleRate =
+			ConfigManager::inst()->value( "mixer", "samplerate" );
+		ConfigManager::inst()->setValue( "mixer", "samplerate",
+				QString::number( os.getSampleRate() ) );
+		Engine::init( true );
+		Engine::mixer()->changeQuality( qs );
+
+		Benchmark b( benchTracks, benchVoices, benchInstrument,
+						benchEffects, benchPeriods );
+		int ret = EXIT_FAILURE;
+		if( b.createProject() )
+		{
+			const QByteArray json = b.run( benchThreads );
+			if( renderOut.isEmpty() )
+			{
+				fwrite( json.constData(), 1, json.size(), stdout );
+				fflush( stdout );
+				ret = EXIT_SUCCESS;
+			}
+			else
+			{
+				QFile f( renderOut );
+				if( f.open( QIODevice::WriteOnly ) &&
+					f.write( json ) == json.size() )
+				{
+					ret = EXIT_SUCCESS;
+				}
+				else
+				{
+					fprintf( stderr, "Could not write %s.\n",
+						renderOut.toUtf8().constData() );
+				}
+			}
+		}
+
+		if( userSampleRate.isEmpty() )
+		{
+			ConfigManager::inst()->deleteValue( "mixer", "samplerate" );
+		}
+		else
+		{
+			ConfigManager::inst()->setValue( "mixer", "samplerate",
+							userSampleRate );
+		}
+		Engine::destroy();
+		delete app;
+		return ret;
+	}
 	// if we have an output file for rendering, just render the song
 	// without starting the GUI
-	if( !renderOut.isEmpty() )
+	else if( !renderOut.isEmpty() )
 	{
 		Engine::init( true );
 		destroyEngine = true;
@@ -66,6 +66,23 @@ static QString portName( snd_seq_t * _seq, const snd_seq_addr_t * _addr )
 	return name;
 }
 
+// events are processed after ALSA reused the memory of the sequencer event,
+// so they carry a copy of the source address packed into the pointer
+static const void * packAddress( const snd_seq_addr_t & _addr )
+{
+	return reinterpret_cast<const void *>( (intptr_t)
+				( 1 << 16 | _addr.client << 8 | _addr.port ) );
+}
+
+static snd_seq_addr_t unpackAddress( const void * _source )
+{
+	const intptr_t packed = reinterpret_cast<intptr_t>( _source );
+	snd_seq_addr_t addr;
+	addr.client = ( packed >> 8 ) & 0xff;
+	addr.port = packed & 0xff;
+	return addr;
+}
+
 
 
 MidiAlsaSeq::MidiAlsaSeq() :
@@ -351,9 +368,9 @@ QString MidiAlsaSeq::sourcePortName( const MidiEvent & _event ) const
 {
 	if( _event.sourcePort() )
 	{
-		const snd_seq_addr_t * addr =
-			static_cast<const snd_seq_addr_t *>( _event.sourcePort() );
-		return portName( m_seqHandle, addr );
+		const snd_seq_addr_t addr =
+					unpackAddress( _event.sourcePort() );
+		return portName( m_seqHandle, &addr );
 	}
 	return MidiClient::sourcePortName( _event );
 }
@@ -505,7 +522,7 @@ void MidiAlsaSeq::run()
 			}
 			m_seqMutex.unlock();
 
-			snd_seq_addr_t * source = NULL;
+			const void * source = NULL;
 			MidiPort * dest = NULL;
 			for( int i = 0; i < m_portIDs.size(); ++i )
 			{
@@ -517,7 +534,7 @@ void MidiAlsaSeq::run()
 						m_portIDs.values()[i][1] == ev->source.port ) ||
 							m_portIDs.values()[i][0] == ev->source.port )
 				{
-					source = &ev->source;
+					source = packAddress( ev->source );
 				}
 			}
 
@@ -24,11 +24,14 @@
  */
 
 #include "MidiClient.h"
+#include "Engine.h"
 #include "MidiPort.h"
+#include "Mixer.h"
 #include "Note.h"
 
 
-MidiClient::MidiClient()
+MidiClient::MidiClient() :
+	m_lastPeriodStart( MidiPort::timestamp() )
 {
 }
 
@@ -63,7 +66,16 @@ void MidiClient::applyPortName( MidiPort* )
 
 void MidiClient::addPort( MidiPort* port )
 {
+	// the mixer walks the ports in processQueuedInEvents()
+	if( Engine::mixer() )
+	{
+		Engine::mixer()->requestChangeInModel();
+	}
 	m_midiPorts.push_back( port );
+	if( Engine::mixer() )
+	{
+		Engine::mixer()->doneChangeInModel();
+	}
 }
 
 
@@ -80,8 +92,30 @@ void MidiClient::removePort( MidiPort* port )
 		qFind( m_midiPorts.begin(), m_midiPorts.end(), port );
 	if( it != m_midiPorts.end() )
 	{
+		if( Engine::mixer() )
+		{
+			Engine::mixer()->requestChangeInModel();
+		}
 		m_midiPorts.erase( it );
+		if( Engine::mixer() )
+		{
+			Engine::mixer()->doneChangeInModel();
+		}
+	}
+}
+
+
+
+
+void MidiClient::processQueuedInEvents( const fpp_t _frames )
+{
+	const qint64 periodStart = MidiPort::timestamp();
+	for( MidiPort * port : m_midiPorts )
+	{
+		port->processQueuedInEvents( m_lastPeriodStart, periodStart,
+								_frames );
 	}
+	m_lastPeriodStart = periodStart;
 }
 
 
@@ -23,6 +23,8 @@
  *
  */
 
+#include <chrono>
+
 #include <QDomElement>
 
 #include "MidiPort.h"
@@ -33,6 +35,9 @@
 
 static MidiDummy s_dummyClient;
 
+// events that can be queued per period before they get dropped
+static const size_t MaxQueuedInEvents = 256;
+
 
 
 MidiPort::MidiPort( const QString& name,
@@ -56,7 +61,8 @@ MidiPort::MidiPort( const QString& name,
 	m_outputProgramModel( 1, 1, MidiProgramCount, this, tr( "Output MIDI program" ) ),
 	m_baseVelocityModel( MidiMaxVelocity/2, 1, MidiMaxVelocity, this, tr( "Base velocity" ) ),
 	m_readableModel( false, this, tr( "Receive MIDI-events" ) ),
-	m_writableModel( false, this, tr( "Send MIDI-events" ) )
+	m_writableModel( false, this, tr( "Send MIDI-events" ) ),
+	m_queuedInEvents( MaxQueuedInEvents )
 {
 	m_midiClient->addPort( this );
 
@@ -142,8 +148,55 @@ void MidiPort::processInEvent( const MidiEvent& event, const MidiTime& time )
 			}
 		}
 
-		m_midiEventProcessor->processInEvent( inEvent, time );
+		QueuedInEvent queued;
+		queued.event = inEvent;
+		queued.time = time;
+		queued.timestamp = timestamp();
+		m_queuedInEvents.push( queued );
+	}
+}
+
+
+
+
+void MidiPort::processQueuedInEvents( qint64 periodStart, qint64 periodEnd,
+								fpp_t frames )
+{
+	typedef LocklessList<QueuedInEvent>::Element Element;
+
+	// the list has the latest event first
+	Element * first = NULL;
+	for( Element * e = m_queuedInEvents.popList(); e; )
+	{
+		Element * next = e->next;
+		e->next = first;
+		first = e;
+		e = next;
 	}
+
+	const qint64 length = qMax<qint64>( periodEnd - periodStart, 1 );
+	for( Element * e = first; e; )
+	{
+		const qint64 elapsed = qBound<qint64>( 0,
+				e->value.timestamp - periodStart, length - 1 );
+		const f_cnt_t offset = elapsed * frames / length;
+		m_midiEventProcessor->processInEvent( e->value.event,
+						e->value.time, offset );
+
+		Element * next = e->next;
+		m_queuedInEvents.free( e );
+		e = next;
+	}
+}
+
+
+
+
+qint64 MidiPort::timestamp()
+{
+	using namespace std::chrono;
+	return duration_cast<nanoseconds>(
+			steady_clock::now().time_since_epoch() ).count();
 }
 
 
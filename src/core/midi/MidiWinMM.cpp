@@ -124,9 +124,11 @@ void MidiWinMM::removePort( MidiPort* port )
 
 QString MidiWinMM::sourcePortName( const MidiEvent& event ) const
 {
+	// the handle itself is stored as source port - events are processed
+	// long after the input callback returned
 	if( event.sourcePort() )
 	{
-		return m_inputDevices.value( *static_cast<const HMIDIIN *>( event.sourcePort() ) );
+		return m_inputDevices.value( (HMIDIIN) event.sourcePort() );
 	}
 
 	return MidiClient::sourcePortName( event );
@@ -208,17 +210,17 @@ void MidiWinMM::handleInputEvent( HMIDIIN hm, DWORD ev )
 			case MidiNoteOn:
 			case MidiNoteOff:
 			case MidiKeyPressure:
-				( *it )->processInEvent( MidiEvent( cmdtype, chan, par1 - KeysPerOctave, par2 & 0xff, &hm ) );
+				( *it )->processInEvent( MidiEvent( cmdtype, chan, par1 - KeysPerOctave, par2 & 0xff, hm ) );
 				break;
 
 			case MidiControlChange:
 			case MidiProgramChange:
 			case MidiChannelPressure:
-				( *it )->processInEvent( MidiEvent( cmdtype, chan, par1, par2 & 0xff, &hm ) );
+				( *it )->processInEvent( MidiEvent( cmdtype, chan, par1, par2 & 0xff, hm ) );
 				break;
 
 			case MidiPitchBend:
-				( *it )->processInEvent( MidiEvent( cmdtype, chan, par1 + par2*128, 0, &hm ) );
+				( *it )->processInEvent( MidiEvent( cmdtype, chan, par1 + par2*128, 0, hm ) );
 				break;
 
 			default:
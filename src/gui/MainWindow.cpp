@@ -120,7 +120,7 @@ MainWindow::MainWindow() :
 	sideBar->appendTab( new FileBrowser(
 				confMgr->userProjectsDir() + "*" +
 				confMgr->factoryProjectsDir(),
-					"*.mmp *.mmpz *.xml *.mid",
+					"*.mmp *.mmpz *.mmpb *.xml *.mid",
 							tr( "My Projects" ),
 					embed::getIconPixmap( "project_file" ).transformed( QTransform().rotate( 90 ) ),
 							splitter, false, true ) );
@@ -872,7 +872,7 @@ void MainWindow::openProject()
 {
 	if( mayChangeProject(false) )
 	{
-		FileDialog ofd( this, tr( "Open Project" ), "", tr( "LMMS (*.mmp *.mmpz)" ) );
+		FileDialog ofd( this, tr( "Open Project" ), "", tr( "LMMS (*.mmp *.mmpz *.mmpb)" ) );
 
 		ofd.setDirectory( ConfigManager::inst()->userProjectsDir() );
 		ofd.setFileMode( FileDialog::ExistingFiles );
@@ -966,6 +966,7 @@ bool MainWindow::saveProjectAs()
 {
 	VersionedSaveDialog sfd( this, tr( "Save Project" ), "",
 			tr( "LMMS Project" ) + " (*.mmpz *.mmp);;" +
+				tr( "LMMS Project Bundle" ) + " (*.mmpb);;" +
 				tr( "LMMS Project Template" ) + " (*.mpt)" );
 	QString f = Engine::getSong()->projectFileName();
 	if( f != "" )
@@ -1002,6 +1003,12 @@ bool MainWindow::saveProjectAs()
 				}
 			}
 		}
+		else if( sfd.selectedNameFilter().contains( "(*.mmpb)" ) &&
+					!fname.endsWith( ".mmpb" ) )
+		{
+			fname.remove( "." + suffix );
+			fname += ".mmpb";
+		}
 		if( Engine::getSong()->guiSaveProjectAs( fname ) )
 		{
 			if( getSession() == Recover )
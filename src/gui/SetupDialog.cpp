@@ -43,6 +43,7 @@
 #include "debug.h"
 #include "ToolTip.h"
 #include "FileDialog.h"
+#include "SampleInterpolator.h"
 
 
 // platform-specific audio-interface-classes
@@ -130,6 +131,10 @@ SetupDialog::SetupDialog( ConfigTabs _tab_to_open ) :
 					"compacttrackbuttons" ).toInt() ),
 	m_syncVSTPlugins( ConfigManager::inst()->value( "ui",
 							"syncvstplugins", "1" ).toInt() ),
+	m_pipelineRemotePlugins( ConfigManager::inst()->value( "mixer",
+					"pipelineremoteplugins" ).toInt() ),
+	m_builtinInterpolator( ConfigManager::inst()->value( "mixer",
+					"builtininterpolator" ).toInt() ),
 	m_animateAFP(ConfigManager::inst()->value( "ui",
 						   "animateafp", "1" ).toInt() ),
 	m_printNoteLabels(ConfigManager::inst()->value( "ui",
@@ -291,6 +296,29 @@ SetupDialog::SetupDialog( ConfigTabs _tab_to_open ) :
 	connect( syncVST, SIGNAL( toggled( bool ) ),
 				this, SLOT( toggleSyncVSTPlugins( bool ) ) );
 
+	LedCheckBox * pipelineRemote = new LedCheckBox(
+		tr( "Run VST and ZynAddSubFX plugins one period behind" ),
+								misc_tw );
+	labelNumber++;
+	pipelineRemote->move( XDelta, YDelta*labelNumber );
+	pipelineRemote->setChecked( m_pipelineRemotePlugins );
+	connect( pipelineRemote, SIGNAL( toggled( bool ) ),
+			this, SLOT( togglePipelineRemotePlugins( bool ) ) );
+	ToolTip::add( pipelineRemote, tr( "Out-of-process plugins render in "
+				"parallel to LMMS instead of blocking it, at the "
+				"cost of one period of additional latency." ) );
+
+	LedCheckBox * builtinInterpolator = new LedCheckBox(
+		tr( "Use fast interpolation for pitched samples" ),
+								misc_tw );
+	labelNumber++;
+	builtinInterpolator->move( XDelta, YDelta*labelNumber );
+	builtinInterpolator->setChecked( m_builtinInterpolator );
+	connect( builtinInterpolator, SIGNAL( toggled( bool ) ),
+			this, SLOT( toggleBuiltinInterpolator( bool ) ) );
+	ToolTip::add( builtinInterpolator, tr( "Pitched samples need less CPU, "
+				"but may sound slightly different than before." ) );
+
 	LedCheckBox * noteLabels = new LedCheckBox(
 				tr( "Enable note labels in piano roll" ),
 								misc_tw );
@@ -1061,6 +1089,9 @@ void SetupDialog::accept()
 	// from taking mouse input, rendering the application unusable.
 	QDialog::accept();
 
+	const bool bufferSizeChanged = m_bufferSize != ConfigManager::inst()->
+			value( "mixer", "framesperaudiobuffer" ).toInt();
+
 	ConfigManager::inst()->setValue( "mixer", "framesperaudiobuffer",
 					QString::number( m_bufferSize ) );
 	ConfigManager::inst()->setValue( "mixer", "audiodev",
@@ -1097,6 +1128,11 @@ void SetupDialog::accept()
 					QString::number( m_compactTrackButtons ) );
 	ConfigManager::inst()->setValue( "ui", "syncvstplugins",
 					QString::number( m_syncVSTPlugins ) );
+	ConfigManager::inst()->setValue( "mixer", "pipelineremoteplugins",
+				QString::number( m_pipelineRemotePlugins ) );
+	ConfigManager::inst()->setValue( "mixer", "builtininterpolator",
+				QString::number( m_builtinInterpolator ) );
+	SampleInterpolator::setEnabled( m_builtinInterpolator );
 	ConfigManager::inst()->setValue( "ui", "animateafp",
 					QString::number( m_animateAFP ) );
 	ConfigManager::inst()->setValue( "ui", "printnotelabels",
@@ -1140,6 +1176,13 @@ void SetupDialog::accept()
 	}
 
 	ConfigManager::inst()->saveConfigFile();
+
+	// the period size can be applied right away, the audio device gets
+	// reopened with the settings saved above
+	if( bufferSizeChanged )
+	{
+		Engine::mixer()->setFramesPerPeriod( m_bufferSize );
+	}
 }
 
 
@@ -1298,6 +1341,16 @@ void SetupDialog::toggleSyncVSTPlugins( bool _enabled )
 	m_syncVSTPlugins = _enabled;
 }
 
+void SetupDialog::togglePipelineRemotePlugins( bool _enabled )
+{
+	m_pipelineRemotePlugins = _enabled;
+}
+
+void SetupDialog::toggleBuiltinInterpolator( bool _enabled )
+{
+	m_builtinInterpolator = _enabled;
+}
+
 void SetupDialog::toggleAnimateAFP( bool _enabled )
 {
 	m_animateAFP = _enabled;
@@ -42,7 +42,7 @@ VisualizationWidget::VisualizationWidget( const QPixmap & _bg, QWidget * _p,
 						visualizationTypes _vtype ) :
 	QWidget( _p ),
 	s_background( _bg ),
-	m_points( new QPointF[Engine::mixer()->framesPerPeriod()] ),
+	m_points( new QPointF[DEFAULT_BUFFER_SIZE] ),
 	m_active( false ),
 	m_normalColor(71, 253, 133),
 	m_warningColor(255, 192, 64),
@@ -52,10 +52,10 @@ VisualizationWidget::VisualizationWidget( const QPixmap & _bg, QWidget * _p,
 	setAttribute( Qt::WA_OpaquePaintEvent, true );
 	setActive( ConfigManager::inst()->value( "ui", "displaywaveform").toInt() );
 
-	const fpp_t frames = Engine::mixer()->framesPerPeriod();
-	m_buffer = new sampleFrame[frames];
+	// the period size may change at runtime
+	m_buffer = new sampleFrame[DEFAULT_BUFFER_SIZE];
 
-	BufferManager::clear( m_buffer, frames );
+	BufferManager::clear( m_buffer, DEFAULT_BUFFER_SIZE );
 
 
 	ToolTip::add( this, tr( "click to enable/disable visualization of "
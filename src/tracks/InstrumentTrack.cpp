@@ -35,11 +35,14 @@
 #include <QMessageBox>
 #include <QMdiSubWindow>
 #include <QPainter>
+#include <QProgressDialog>
 
 #include "FileDialog.h"
 #include "InstrumentTrack.h"
 #include "AutomationPattern.h"
+#include "AutomationTrack.h"
 #include "BBTrack.h"
+#include "BBTrackContainer.h"
 #include "CaptionMenu.h"
 #include "ConfigManager.h"
 #include "ControllerConnection.h"
@@ -47,6 +50,8 @@
 #include "EffectRackView.h"
 #include "embed.h"
 #include "FileBrowser.h"
+#include "FreezeCache.h"
+#include "FreezePlayHandle.h"
 #include "FxMixer.h"
 #include "FxMixerView.h"
 #include "GuiApplication.h"
@@ -72,6 +77,7 @@
 #include "Song.h"
 #include "StringPairDrag.h"
 #include "TrackContainerView.h"
+#include "TrackFreezer.h"
 #include "TrackLabelButton.h"
 
 
@@ -109,7 +115,10 @@ InstrumentTrack::InstrumentTrack( TrackContainer* tc ) :
 	m_soundShaping( this ),
 	m_arpeggio( this ),
 	m_noteStacking( this ),
-	m_piano( this )
+	m_piano( this ),
+	m_freezeCache( NULL ),
+	m_freezePlayHandle( NULL ),
+	m_freezeCheckPending( false )
 {
 	m_pitchModel.setCenterValue( 0 );
 	m_panningModel.setCenterValue( DefaultPanning );
@@ -134,6 +143,11 @@ InstrumentTrack::InstrumentTrack( TrackContainer* tc ) :
 			this, SLOT( updatePitchRange() ), Qt::DirectConnection );
 	connect( &m_effectChannelModel, SIGNAL( dataChanged() ),
 			this, SLOT( updateEffectChannel() ), Qt::DirectConnection );
+	connect( Engine::getSong(), SIGNAL( playbackStateChanged() ),
+			this, SLOT( checkFreezeState() ) );
+	connect( this, SIGNAL( trackContentObjectAdded( TrackContentObject * ) ),
+			this, SLOT( watchFreezeState( TrackContentObject * ) ),
+							Qt::DirectConnection );
 }
 
 
@@ -148,6 +162,8 @@ int InstrumentTrack::baseNote() const
 
 InstrumentTrack::~InstrumentTrack()
 {
+	unfreeze();
+
 	// kill all running notes and the iph
 	silenceAllNotes( true );
 
@@ -242,7 +258,8 @@ MidiEvent InstrumentTrack::applyMasterKey( const MidiEvent& event )
 
 void InstrumentTrack::processInEvent( const MidiEvent& event, const MidiTime& time, f_cnt_t offset )
 {
-	if( Engine::getSong()->isExporting() )
+	// a frozen track only plays back what has been rendered
+	if( Engine::getSong()->isExporting() || isFrozen() )
 	{
 		return;
 	}
@@ -615,6 +632,38 @@ bool InstrumentTrack::play( const MidiTime & _start, const fpp_t _frames,
 	}
 	const float frames_per_tick = Engine::framesPerTick();
 
+	// the frozen render covers the whole song, so just tell the freeze
+	// handle where we are - this also takes care of loops and jumps
+	if( isFrozen() )
+	{
+		if( _tco_num < 0 )
+		{
+			if( m_freezePlayHandle == NULL )
+			{
+				m_freezePlayHandle = new FreezePlayHandle( this,
+								m_freezeCache );
+				Engine::mixer()->addPlayHandle( m_freezePlayHandle );
+			}
+			if( m_freezePlayHandle )
+			{
+				m_freezePlayHandle->seek( _offset,
+					m_freezeCache->tickFrame(
+						_start.getTicks(),
+						frames_per_tick ) );
+			}
+		}
+		unlock();
+		return false;
+	}
+
+	// while being frozen, remember where every tick starts in the render,
+	// as tempo automation keeps running
+	if( _tco_num < 0 && m_audioPort.freezeCapture() )
+	{
+		m_audioPort.freezeCapture()->markTick( _start.getTicks(),
+								_offset );
+	}
+
 	tcoVector tcos;
 	::BBTrack * bb_track = NULL;
 	if( _tco_num >= 0 )
@@ -708,6 +757,195 @@ bool InstrumentTrack::play( const MidiTime & _start, const fpp_t _frames,
 
 
 
+void InstrumentTrack::setFreezeCache( FreezeCache * _cache )
+{
+	if( _cache == m_freezeCache )
+	{
+		return;
+	}
+
+	// get rid of the old freeze handle, a new one is created on demand
+	Engine::mixer()->removePlayHandlesOfTypes( this,
+					PlayHandle::TypeSamplePlayHandle );
+
+	Engine::mixer()->requestChangeInModel();
+	FreezeCache * oldCache = m_freezeCache;
+	m_freezeCache = _cache ? sharedObject::ref( _cache ) : NULL;
+	m_audioPort.setFrozen( m_freezeCache != NULL );
+	Engine::mixer()->doneChangeInModel();
+
+	if( oldCache )
+	{
+		sharedObject::unref( oldCache );
+	}
+
+	if( m_freezeCache )
+	{
+		// notes started before freezing would play on top of the render
+		silenceAllNotes();
+	}
+}
+
+
+
+
+void InstrumentTrack::unfreeze()
+{
+	setFreezeCache( NULL );
+}
+
+
+
+
+QByteArray InstrumentTrack::freezeStateHash()
+{
+	QDomDocument doc;
+	QDomElement element = doc.createElement( "track" );
+	doc.appendChild( element );
+	saveSettings( doc, element );
+
+	// these don't change what the track sounds like
+	element.removeAttribute( "name" );
+	element.removeAttribute( "muted" );
+	element.removeAttribute( "solo" );
+	element.removeAttribute( "height" );
+
+	element.setAttribute( "freezebpm", Engine::getSong()->getTempo() );
+	element.setAttribute( "freezesr",
+				Engine::mixer()->processingSampleRate() );
+	element.setAttribute( "freezemasterpitch",
+				Engine::getSong()->masterPitch() );
+
+	// the track plays along with the automation while being frozen, so
+	// editing patterns of our models or song-wide ones like the tempo
+	// has to drop the frozen render as well
+	TrackContainer::TrackList tracks = Engine::getSong()->tracks();
+	tracks += Engine::getBBTrackContainer()->tracks();
+	tracks += Engine::getSong()->globalAutomationTrack();
+	for( const Track * track : tracks )
+	{
+		if( track->type() != Track::AutomationTrack &&
+				track->type() != Track::HiddenAutomationTrack )
+		{
+			continue;
+		}
+		for( TrackContentObject * tco : track->getTCOs() )
+		{
+			AutomationPattern * p =
+				dynamic_cast<AutomationPattern *>( tco );
+			if( p == NULL )
+			{
+				continue;
+			}
+
+			QStringList automated;
+			for( const AutomatableModel * model : p->objects() )
+			{
+				if( model && isFreezeRelevant( model ) )
+				{
+					automated << model->displayName();
+				}
+			}
+			if( automated.isEmpty() )
+			{
+				continue;
+			}
+
+			QDomElement pattern = doc.createElement( "automation" );
+			p->saveSettings( doc, pattern );
+			// object IDs aren't stable across sessions
+			pattern.removeAttribute( "name" );
+			while( !pattern.firstChildElement( "object" ).isNull() )
+			{
+				pattern.removeChild(
+					pattern.firstChildElement( "object" ) );
+			}
+			pattern.setAttribute( "objects", automated.join( "," ) );
+			pattern.setAttribute( "trackmuted", track->isMuted() );
+			element.appendChild( pattern );
+		}
+	}
+
+	return FreezeCache::hashState( doc );
+}
+
+
+
+
+bool InstrumentTrack::isFreezeRelevant( const Model * _model ) const
+{
+	for( const Model * m = _model; m != NULL; m = m->parentModel() )
+	{
+		if( m == this || m == m_instrument || m == Engine::getSong() )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+
+
+void InstrumentTrack::freezePlayHandleDeleted( FreezePlayHandle * _handle )
+{
+	if( m_freezePlayHandle == _handle )
+	{
+		m_freezePlayHandle = NULL;
+	}
+}
+
+
+
+
+void InstrumentTrack::watchFreezeState( TrackContentObject * _tco )
+{
+	connect( _tco, SIGNAL( dataChanged() ),
+			this, SLOT( scheduleFreezeCheck() ) );
+	connect( _tco, SIGNAL( positionChanged() ),
+			this, SLOT( scheduleFreezeCheck() ) );
+	connect( _tco, SIGNAL( lengthChanged() ),
+			this, SLOT( scheduleFreezeCheck() ) );
+	connect( _tco, SIGNAL( destroyedTCO() ),
+			this, SLOT( scheduleFreezeCheck() ) );
+}
+
+
+
+
+void InstrumentTrack::scheduleFreezeCheck()
+{
+	// editing a pattern usually emits a bunch of signals at once, so only
+	// hash the track once they're all through
+	if( isFrozen() && m_freezeCheckPending == false )
+	{
+		m_freezeCheckPending = true;
+		QMetaObject::invokeMethod( this, "checkFreezeState",
+						Qt::QueuedConnection );
+	}
+}
+
+
+
+
+void InstrumentTrack::checkFreezeState()
+{
+	m_freezeCheckPending = false;
+
+	// drop the frozen render as soon as the track has been edited - this
+	// is checked whenever playback starts or stops and whenever one of
+	// our patterns changes
+	if( isFrozen() && ( m_freezeCache->sampleRate() !=
+				Engine::mixer()->processingSampleRate() ||
+			m_freezeCache->stateHash() != freezeStateHash() ) )
+	{
+		unfreeze();
+	}
+}
+
+
+
+
 TrackContentObject * InstrumentTrack::createTCO( const MidiTime & )
 {
 	return new Pattern( this );
@@ -1027,6 +1265,36 @@ void InstrumentTrackView::assignFxLine(int channelIndex)
 
 
 
+
+/*! \brief Render this track into a freeze cache and play back the result */
+void InstrumentTrackView::freezeTrack()
+{
+	if( Engine::getSong()->isExporting() || model()->isFrozen() )
+	{
+		return;
+	}
+
+	TrackFreezer * freezer = new TrackFreezer( model() );
+	QProgressDialog * progress = new QProgressDialog(
+					tr( "Freezing %1..." ).arg( model()->name() ),
+					tr( "Cancel" ), 0, 100, gui->mainWindow() );
+	progress->setWindowModality( Qt::WindowModal );
+
+	connect( freezer, SIGNAL( progressChanged( int ) ),
+				progress, SLOT( setValue( int ) ) );
+	connect( progress, SIGNAL( canceled() ),
+				freezer, SLOT( abortProcessing() ) );
+	connect( freezer, SIGNAL( freezeFinished() ),
+				progress, SLOT( deleteLater() ) );
+	connect( freezer, SIGNAL( freezeFinished() ),
+				freezer, SLOT( deleteLater() ) );
+
+	progress->show();
+	freezer->startProcessing();
+}
+
+
+
 // TODO: Add windows to free list on freeInstrumentTrackWindow.
 // But, don't NULL m_window or disconnect signals.  This will allow windows
 // that are being show/hidden frequently to stay connected.
@@ -30,6 +30,7 @@
 #include <QPainter>
 #include <QPushButton>
 
+#include "DataFile.h"
 #include "InstrumentTrack.h"
 #include "gui_templates.h"
 #include "embed.h"
@@ -400,6 +401,36 @@ void Pattern::loadSettings( const QDomElement & _this )
 	clearNotes();
 
 	QDomNode node = _this.firstChild();
+	const QVector<DataFile::StreamedNote> * streamed =
+						DataFile::streamedNotes( _this );
+	if( streamed != NULL )
+	{
+		// the notes the DOM still has are interleaved with the others
+		for( const DataFile::StreamedNote & s : *streamed )
+		{
+			if( s.inDom == false )
+			{
+				m_notes.push_back( new Note( MidiTime( s.length ),
+						MidiTime( s.pos ), s.key,
+						s.volume, s.panning ) );
+				continue;
+			}
+			while( !node.isNull() && ( !node.isElement() ||
+				node.toElement().attribute( "metadata" ).toInt() ) )
+			{
+				node = node.nextSibling();
+			}
+			if( !node.isNull() )
+			{
+				Note * n = new Note;
+				n->restoreState( node.toElement() );
+				m_notes.push_back( n );
+				node = node.nextSibling();
+			}
+		}
+		node = QDomNode();
+	}
+
 	while( !node.isNull() )
 	{
 		if( node.isElement() &&
@@ -31,6 +31,7 @@
 #include <QMdiSubWindow>
 #include <QPainter>
 #include <QPushButton>
+#include <QTimer>
 
 #include "gui_templates.h"
 #include "GuiApplication.h"
@@ -54,6 +55,9 @@ SampleTCO::SampleTCO( Track * _track ) :
 	m_sampleBuffer( new SampleBuffer ),
 	m_isPlaying( false )
 {
+	// hour-long recordings don't have to be held in memory
+	m_sampleBuffer->setStreamingEnabled( true );
+
 	saveJournallingState( false );
 	setSampleFile( "" );
 	restoreJournallingState();
@@ -183,6 +187,43 @@ void SampleTCO::playbackPositionChanged()
 	Engine::mixer()->removePlayHandlesOfTypes( getTrack(), PlayHandle::TypeSamplePlayHandle );
 	SampleTrack * st = dynamic_cast<SampleTrack*>( getTrack() );
 	st->setPlayingTcos( false );
+	cueSample();
+}
+
+
+
+
+void SampleTCO::cueSample()
+{
+	if( !m_sampleBuffer->isStreamed() )
+	{
+		return;
+	}
+
+	// have the frames ready which playback starts with when it continues
+	// from the current position or jumps back to the loop begin
+	const Song::PlayPos & pos =
+			Engine::getSong()->getPlayPos( Song::Mode_PlaySong );
+	m_sampleBuffer->cue( SampleStream::CuePlayPosition,
+						sampleFrameAt( pos ) );
+	if( pos.m_timeLine && pos.m_timeLine->loopPointsEnabled() )
+	{
+		m_sampleBuffer->cue( SampleStream::CueLoopBegin,
+				sampleFrameAt( pos.m_timeLine->loopBegin() ) );
+	}
+}
+
+
+
+
+f_cnt_t SampleTCO::sampleFrameAt( const MidiTime & _time ) const
+{
+	if( _time < startPosition() || _time >= endPosition() )
+	{
+		return -1;
+	}
+	return static_cast<f_cnt_t>( Engine::framesPerTick(
+			m_sampleBuffer->sampleRate() ) * ( _time - startPosition() ) );
 }
 
 
@@ -257,8 +298,7 @@ void SampleTCO::saveSettings( QDomDocument & _doc, QDomElement & _this )
 	_this.setAttribute( "src", sampleFile() );
 	if( sampleFile() == "" )
 	{
-		QString s;
-		_this.setAttribute( "data", m_sampleBuffer->toBase64( s ) );
+		m_sampleBuffer->saveSampleData( _doc, _this, "data" );
 	}
 
 	_this.setAttribute ("sample_rate", m_sampleBuffer->sampleRate());
@@ -275,9 +315,9 @@ void SampleTCO::loadSettings( const QDomElement & _this )
 		movePosition( _this.attribute( "pos" ).toInt() );
 	}
 	setSampleFile( _this.attribute( "src" ) );
-	if( sampleFile().isEmpty() && _this.hasAttribute( "data" ) )
+	if( sampleFile().isEmpty() )
 	{
-		m_sampleBuffer->loadFromBase64( _this.attribute( "data" ) );
+		m_sampleBuffer->loadSampleData( _this, "data" );
 	}
 	changeLength( _this.attribute( "len" ).toInt() );
 	setMuted( _this.attribute( "muted" ).toInt() );
@@ -530,6 +570,11 @@ void SampleTCOView::paintEvent( QPaintEvent * pe )
 	QRect r = QRect( TCO_BORDER_WIDTH, spacing,
 			qMax( static_cast<int>( m_tco->sampleLength() * ppt / ticksPerTact ), 1 ), rect().bottom() - 2 * spacing );
 	m_tco->m_sampleBuffer->visualize( p, r, pe->rect() );
+	if( m_tco->m_sampleBuffer->isScanningPeaks() )
+	{
+		// draw the rest of the waveform once it has been scanned
+		QTimer::singleShot( 500, this, SLOT( updateSample() ) );
+	}
 
 	// disable antialiasing for borders, since its not needed
 	p.setRenderHint( QPainter::Antialiasing, false );
@@ -0,0 +1,261 @@
+/*
+ * InterpolationBenchmark.cpp - compares the cost of the built-in sample
+ *                              interpolator with libsamplerate
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QList>
+#include <QtCore/QPair>
+#include <QtCore/QString>
+
+#include <samplerate.h>
+
+#include "SampleBuffer.h"
+#include "SampleInterpolator.h"
+
+
+// length of the test sample, voices wrap around at its end
+static const f_cnt_t SourceFrames = 1 << 18;
+
+static const struct
+{
+	int converter;
+	const char * name;
+} Converters[] =
+{
+	{ SRC_ZERO_ORDER_HOLD, "zero_order_hold" },
+	{ SRC_LINEAR, "linear" },
+	{ SRC_SINC_FASTEST, "sinc_fastest" },
+	{ SRC_SINC_MEDIUM_QUALITY, "sinc_medium" },
+	{ SRC_SINC_BEST_QUALITY, "sinc_best" }
+} ;
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+//! Plays _voices voices at different pitches from the same source, like
+//! SampleBuffer::play() does for every note of a drum kit, and returns the
+//! time spent per voice and output frame.
+class InterpolationBenchmark
+{
+public:
+	InterpolationBenchmark( int _periods, fpp_t _frames, int _voices ) :
+		m_periods( _periods ),
+		m_frames( _frames ),
+		m_voices( _voices ),
+		m_source( new sampleFrame[SourceFrames] ),
+		m_output( new sampleFrame[_frames] )
+	{
+		// a chord of sines, so that the sinc kernels have some work
+		for( f_cnt_t f = 0; f < SourceFrames; ++f )
+		{
+			const float s = 0.3f * ( sinf( f * 0.0314f ) +
+				sinf( f * 0.0419f ) + sinf( f * 0.0627f ) );
+			m_source[f][0] = s;
+			m_source[f][1] = -s;
+		}
+	}
+
+	~InterpolationBenchmark()
+	{
+		delete[] m_source;
+		delete[] m_output;
+	}
+
+	// ratio of the given voice, spread over two octaves
+	double ratio( int _voice ) const
+	{
+		return pow( 2.0, ( _voice % 25 - 12 ) / 12.0 + 0.013 );
+	}
+
+	double libsamplerate( int _converter )
+	{
+		std::vector<SRC_STATE *> states( m_voices );
+		std::vector<f_cnt_t> positions( m_voices, 0 );
+		for( int v = 0; v < m_voices; ++v )
+		{
+			int error;
+			states[v] = src_new( _converter, DEFAULT_CHANNELS, &error );
+		}
+
+		Clock::duration elapsed = Clock::duration::zero();
+		for( int p = 0; p < m_periods; ++p )
+		{
+			const Clock::time_point start = Clock::now();
+			for( int v = 0; v < m_voices; ++v )
+			{
+				const f_cnt_t in = (f_cnt_t)( m_frames *
+					ratio( v ) ) + MARGIN[_converter];
+				if( positions[v] + in >= SourceFrames )
+				{
+					positions[v] = 0;
+				}
+				SRC_DATA src_data;
+				src_data.data_in = m_source[positions[v]];
+				src_data.data_out = m_output[0];
+				src_data.input_frames = in;
+				src_data.output_frames = m_frames;
+				src_data.src_ratio = 1.0 / ratio( v );
+				src_data.end_of_input = 0;
+				src_process( states[v], &src_data );
+				positions[v] += src_data.input_frames_used;
+			}
+			elapsed += Clock::now() - start;
+		}
+
+		for( SRC_STATE * state : states )
+		{
+			src_delete( state );
+		}
+		return nsPerVoiceFrame( elapsed );
+	}
+
+	double builtin( SampleInterpolator::Qualities _quality )
+	{
+		const f_cnt_t history =
+				SampleInterpolator::historyFrames( _quality );
+		std::vector<f_cnt_t> positions( m_voices, history );
+		std::vector<double> fractions( m_voices, 0 );
+
+		Clock::duration elapsed = Clock::duration::zero();
+		for( int p = 0; p < m_periods; ++p )
+		{
+			const Clock::time_point start = Clock::now();
+			for( int v = 0; v < m_voices; ++v )
+			{
+				const f_cnt_t in = SampleInterpolator::inputFrames(
+						_quality, m_frames, ratio( v ),
+								fractions[v] );
+				if( positions[v] + in >= SourceFrames )
+				{
+					positions[v] = history;
+				}
+				positions[v] += SampleInterpolator::process(
+					_quality, m_source + positions[v],
+					m_output, m_frames, ratio( v ),
+							&fractions[v] );
+			}
+			elapsed += Clock::now() - start;
+		}
+
+		return nsPerVoiceFrame( elapsed );
+	}
+
+
+private:
+	double nsPerVoiceFrame( Clock::duration _elapsed ) const
+	{
+		return std::chrono::duration<double, std::nano>(
+							_elapsed ).count() /
+			( (double) m_periods * m_voices * m_frames );
+	}
+
+	int m_periods;
+	fpp_t m_frames;
+	int m_voices;
+	sampleFrame * m_source;
+	sampleFrame * m_output;
+
+} ;
+
+
+
+
+int main( int argc, char * * argv )
+{
+	int periods = 200;
+	int frames = 256;
+	int voices = 64;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		const QString arg = argv[i];
+		if( ( arg == "--periods" || arg == "--frames" ||
+					arg == "--voices" ) && i + 1 < argc )
+		{
+			const int value = qMax( QString( argv[++i] ).toInt(), 1 );
+			if( arg == "--periods" )
+			{
+				periods = value;
+			}
+			else if( arg == "--frames" )
+			{
+				frames = value;
+			}
+			else
+			{
+				voices = value;
+			}
+		}
+		else
+		{
+			printf( "Usage: %s [--periods <n>] [--frames <n>] "
+						"[--voices <n>]\n\n"
+				"Compares the time libsamplerate and the "
+				"built-in interpolator take per voice\n"
+				"and output frame for every converter.\n",
+								argv[0] );
+			return arg == "--help" || arg == "-h" ?
+						EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	InterpolationBenchmark b( periods, frames, voices );
+
+	QByteArray json = "[\n";
+	bool first = true;
+	for( const auto & c : Converters )
+	{
+		QList<QPair<QByteArray, double> > results;
+		results << qMakePair( QByteArray( "libsamplerate" ),
+					b.libsamplerate( c.converter ) );
+		SampleInterpolator::Qualities quality;
+		if( SampleInterpolator::fromConverter( c.converter, &quality ) )
+		{
+			results << qMakePair( QByteArray( "builtin" ),
+						b.builtin( quality ) );
+		}
+
+		for( const auto & r : results )
+		{
+			json += first ? "\t{ " : ",\n\t{ ";
+			json += "\"converter\": \"" + QByteArray( c.name ) + "\"";
+			json += ", \"engine\": \"" + r.first + "\"";
+			json += ", \"voices\": " + QByteArray::number( voices );
+			json += ", \"frames\": " + QByteArray::number( frames );
+			json += ", \"nsPerVoiceFrame\": " +
+				QByteArray::number( r.second, 'f', 2 );
+			json += " }";
+			first = false;
+		}
+	}
+	json += "\n]\n";
+
+	fwrite( json.constData(), 1, json.size(), stdout );
+	return EXIT_SUCCESS;
+}
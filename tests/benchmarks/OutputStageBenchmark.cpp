@@ -0,0 +1,260 @@
+/*
+ * OutputStageBenchmark.cpp - measures what AudioDevice spends on bringing
+ *                            the mixer output to the device
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QString>
+
+#include <samplerate.h>
+
+#include "Mixer.h"
+#include "MixHelpers.h"
+
+
+static const struct
+{
+	int converter;
+	const char * name;
+} Converters[] =
+{
+	{ SRC_ZERO_ORDER_HOLD, "zero_order_hold" },
+	{ SRC_SINC_FASTEST, "sinc_fastest" },
+	{ SRC_SINC_MEDIUM_QUALITY, "sinc_medium" },
+	{ SRC_SINC_BEST_QUALITY, "sinc_best" }
+} ;
+
+static const int Oversampling[] = { 2, 4, 8 };
+
+
+typedef std::chrono::steady_clock Clock;
+
+
+//! Runs the stages AudioDevice::getNextBuffer() and
+//! AudioDevice::convertToS16() put every period through and returns the
+//! time spent per output frame.
+class OutputStageBenchmark
+{
+public:
+	OutputStageBenchmark( int _periods, fpp_t _frames ) :
+		m_periods( _periods ),
+		m_frames( _frames ),
+		m_input( new surroundSampleFrame[_frames * 8] ),
+		m_output( new surroundSampleFrame[_frames] ),
+		m_samples( new int_sample_t[_frames * SURROUND_CHANNELS] )
+	{
+		// a chord of sines, loud enough to get clipped now and then
+		for( f_cnt_t f = 0; f < _frames * 8; ++f )
+		{
+			const float s = 0.45f * ( sinf( f * 0.0314f ) +
+				sinf( f * 0.0419f ) + sinf( f * 0.0627f ) );
+			for( ch_cnt_t ch = 0; ch < SURROUND_CHANNELS; ++ch )
+			{
+				m_input[f][ch] = ch % 2 ? -s : s;
+			}
+		}
+	}
+
+	~OutputStageBenchmark()
+	{
+		delete[] m_input;
+		delete[] m_output;
+		delete[] m_samples;
+	}
+
+	// downsampling from the oversampled processing rate like
+	// AudioDevice::resample() does, with one converter for all periods
+	double resample( int _converter, int _oversampling )
+	{
+		int error;
+		SRC_STATE * state = src_new( _converter, SURROUND_CHANNELS,
+								&error );
+
+		Clock::duration elapsed = Clock::duration::zero();
+		for( int p = 0; p < m_periods; ++p )
+		{
+			const Clock::time_point start = Clock::now();
+			SRC_DATA src_data;
+			src_data.data_in = m_input[0];
+			src_data.data_out = m_output[0];
+			src_data.input_frames = m_frames * _oversampling;
+			src_data.output_frames = m_frames;
+			src_data.src_ratio = 1.0 / _oversampling;
+			src_data.end_of_input = 0;
+			src_process( state, &src_data );
+			elapsed += Clock::now() - start;
+		}
+
+		src_delete( state );
+		return nsPerFrame( elapsed );
+	}
+
+	// the per sample loop AudioDevice::convertToS16() used to run
+	double convertScalar( bool _swapBytes )
+	{
+		Clock::duration elapsed = Clock::duration::zero();
+		for( int p = 0; p < m_periods; ++p )
+		{
+			const Clock::time_point start = Clock::now();
+			for( fpp_t f = 0; f < m_frames; ++f )
+			{
+				for( ch_cnt_t ch = 0; ch < SURROUND_CHANNELS; ++ch )
+				{
+					const int_sample_t s =
+						static_cast<int_sample_t>(
+						Mixer::clip( m_input[f][ch] *
+							0.9f ) *
+						OUTPUT_SAMPLE_MULTIPLIER );
+					m_samples[f * SURROUND_CHANNELS + ch] =
+						_swapBytes ?
+						( ( s & 0x00ff ) << 8 |
+						( s & 0xff00 ) >> 8 ) : s;
+				}
+			}
+			elapsed += Clock::now() - start;
+		}
+
+		return nsPerFrame( elapsed );
+	}
+
+	double convert( bool _swapBytes )
+	{
+		Clock::duration elapsed = Clock::duration::zero();
+		for( int p = 0; p < m_periods; ++p )
+		{
+			const Clock::time_point start = Clock::now();
+			MixHelpers::convertToS16( m_samples, m_input[0], 0.9f,
+					m_frames * SURROUND_CHANNELS,
+								_swapBytes );
+			elapsed += Clock::now() - start;
+		}
+
+		return nsPerFrame( elapsed );
+	}
+
+
+private:
+	double nsPerFrame( Clock::duration _elapsed ) const
+	{
+		return std::chrono::duration<double, std::nano>(
+							_elapsed ).count() /
+					( (double) m_periods * m_frames );
+	}
+
+	int m_periods;
+	fpp_t m_frames;
+	surroundSampleFrame * m_input;
+	surroundSampleFrame * m_output;
+	int_sample_t * m_samples;
+
+} ;
+
+
+
+
+static void addResult( QByteArray & _json, bool & _first,
+				const QByteArray & _fields, double _ns )
+{
+	_json += _first ? "\t{ " : ",\n\t{ ";
+	_json += _fields;
+	_json += ", \"nsPerFrame\": " + QByteArray::number( _ns, 'f', 2 );
+	_json += " }";
+	_first = false;
+}
+
+
+
+
+int main( int argc, char * * argv )
+{
+	int periods = 2000;
+	int frames = 256;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		const QString arg = argv[i];
+		if( ( arg == "--periods" || arg == "--frames" ) &&
+								i + 1 < argc )
+		{
+			const int value = qMax( QString( argv[++i] ).toInt(), 1 );
+			if( arg == "--periods" )
+			{
+				periods = value;
+			}
+			else
+			{
+				frames = value;
+			}
+		}
+		else
+		{
+			printf( "Usage: %s [--periods <n>] [--frames <n>]\n\n"
+				"Measures the time the audio device output "
+				"stage takes per output frame:\n"
+				"downsampling from every oversampling factor "
+				"with every converter and\n"
+				"conversion to 16 bit samples.\n", argv[0] );
+			return arg == "--help" || arg == "-h" ?
+						EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+
+	OutputStageBenchmark b( periods, frames );
+
+	QByteArray json = "[\n";
+	bool first = true;
+	const QByteArray framesField = ", \"frames\": " +
+						QByteArray::number( frames );
+	for( int oversampling : Oversampling )
+	{
+		for( const auto & c : Converters )
+		{
+			addResult( json, first, "\"stage\": \"resample\""
+				", \"converter\": \"" + QByteArray( c.name ) +
+				"\", \"oversampling\": " +
+				QByteArray::number( oversampling ) +
+								framesField,
+				b.resample( c.converter, oversampling ) );
+		}
+	}
+	for( int swapBytes = 0; swapBytes < 2; ++swapBytes )
+	{
+		const QByteArray swapField = QByteArray( ", \"swapBytes\": " ) +
+					( swapBytes ? "true" : "false" );
+		addResult( json, first, "\"stage\": \"convert\""
+				", \"engine\": \"scalar\"" + swapField +
+								framesField,
+						b.convertScalar( swapBytes ) );
+		addResult( json, first, "\"stage\": \"convert\""
+				", \"engine\": \"MixHelpers\"" + swapField +
+								framesField,
+						b.convert( swapBytes ) );
+	}
+	json += "\n]\n";
+
+	fwrite( json.constData(), 1, json.size(), stdout );
+	return EXIT_SUCCESS;
+}
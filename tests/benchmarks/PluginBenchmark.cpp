@@ -0,0 +1,463 @@
+/*
+ * PluginBenchmark.cpp - measures the DSP cost of instrument and effect plugins
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QFile>
+#include <QtCore/QList>
+#include <QtCore/QStringList>
+
+#include "AtomicInt.h"
+#include "BufferManager.h"
+#include "Effect.h"
+#include "EffectChain.h"
+#include "Engine.h"
+#include "Instrument.h"
+#include "InstrumentTrack.h"
+#include "Mixer.h"
+#include "NotePlayHandle.h"
+#include "PluginFactory.h"
+#include "Song.h"
+
+
+// every allocation done through operator new while s_countAllocations is
+// set, no matter which thread or plugin it comes from
+static AtomicInt s_allocations;
+static volatile bool s_countAllocations = false;
+
+
+void * operator new( std::size_t size )
+{
+	if( s_countAllocations )
+	{
+		s_allocations.fetchAndAddOrdered( 1 );
+	}
+	void * p = malloc( size ? size : 1 );
+	if( p == NULL )
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+
+void * operator new[]( std::size_t size )
+{
+	return operator new( size );
+}
+
+
+void operator delete( void * p ) noexcept
+{
+	free( p );
+}
+
+
+void operator delete[]( void * p ) noexcept
+{
+	free( p );
+}
+
+
+
+// fixed seed for everything depending on rand()
+static const unsigned int RandomSeed = 0x4c4d4d53;
+
+// periods processed before measuring, so that buffers have been allocated
+// and the first notes are playing
+static const int WarmupPeriods = 16;
+
+// instruments get a new chord every ChordInterval periods, which is
+// released after ChordLength periods
+static const int ChordInterval = 8;
+static const int ChordLength = 6;
+
+
+
+//! Instantiates plugins through PluginFactory and measures how long they
+//! take to process a period, without any GUI and outside of the mixer:
+//! instruments play a fixed sequence of chords, effects process a fixed
+//! test signal.
+class PluginBenchmark
+{
+public:
+	PluginBenchmark( int _periods, const QList<int> & _frames,
+					const QList<int> & _oversampling ) :
+		m_periods( _periods ),
+		m_frames( _frames ),
+		m_oversampling( _oversampling ),
+		m_firstResult( true )
+	{
+	}
+
+	QByteArray run( QStringList _plugins )
+	{
+		if( _plugins.isEmpty() )
+		{
+			for( const Plugin::Descriptor * d : pluginFactory->descriptors() )
+			{
+				if( d->type == Plugin::Instrument ||
+						d->type == Plugin::Effect )
+				{
+					_plugins << d->name;
+				}
+			}
+		}
+
+		Mixer * mixer = Engine::mixer();
+		m_json = "[\n";
+		m_firstResult = true;
+
+		for( int oversampling : m_oversampling )
+		{
+			Mixer::qualitySettings qs( Mixer::qualitySettings::Mode_Draft );
+			qs.oversampling = oversampling == 8 ?
+				Mixer::qualitySettings::Oversampling_8x :
+						oversampling == 4 ?
+				Mixer::qualitySettings::Oversampling_4x :
+						oversampling == 2 ?
+				Mixer::qualitySettings::Oversampling_2x :
+				Mixer::qualitySettings::Oversampling_None;
+
+			// instruments are driven from this thread, so keep the
+			// mixer from rendering at the same time
+			mixer->changeQuality( qs );
+			mixer->stopProcessing();
+
+			for( const QString & name : _plugins )
+			{
+				const PluginFactory::PluginInfo pi =
+					pluginFactory->pluginInfo( name.toUtf8() );
+				if( pi.isNull() )
+				{
+					fprintf( stderr, "Plugin \"%s\" not found.\n",
+						name.toUtf8().constData() );
+					continue;
+				}
+
+				fprintf( stderr, "Benchmarking %s at %d Hz...\n",
+						name.toUtf8().constData(),
+					(int) mixer->processingSampleRate() );
+
+				if( pi.descriptor->type == Plugin::Instrument )
+				{
+					benchmarkInstrument( name );
+				}
+				else if( pi.descriptor->subPluginFeatures )
+				{
+					// LADSPA, LV2 and VST effects need to
+					// know which effect to load
+					fprintf( stderr, "Skipping %s, it hosts "
+						"external effects.\n",
+						name.toUtf8().constData() );
+				}
+				else if( pi.descriptor->type == Plugin::Effect )
+				{
+					for( int frames : m_frames )
+					{
+						benchmarkEffect( name, frames );
+					}
+				}
+			}
+
+			mixer->startProcessing();
+		}
+
+		m_json += "\n]\n";
+		return m_json;
+	}
+
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	void benchmarkInstrument( const QString & _name )
+	{
+		Mixer * mixer = Engine::mixer();
+		const fpp_t fpp = mixer->framesPerPeriod();
+
+		srand( RandomSeed );
+
+		InstrumentTrack * it = dynamic_cast<InstrumentTrack *>(
+			Track::create( Track::InstrumentTrack,
+						Engine::getSong() ) );
+		Instrument * instrument = it->loadInstrument( _name );
+
+		// let the mixer pick up the play handle of single-streamed
+		// instruments, so it is cleaned up properly with the track
+		mixer->nextBuffer();
+
+		const bool singleStreamed = instrument->flags() &
+						Instrument::IsSingleStreamed;
+
+		sampleFrame * buf = BufferManager::acquire();
+		QList<NotePlayHandle *> notes;
+		Clock::duration elapsed = Clock::duration::zero();
+		int allocations = 0;
+
+		for( int p = 0; p < WarmupPeriods + m_periods; ++p )
+		{
+			const bool measure = p >= WarmupPeriods;
+			if( measure )
+			{
+				s_allocations = 0;
+				s_countAllocations = true;
+			}
+			const Clock::time_point start = Clock::now();
+
+			if( p % ChordInterval == 0 )
+			{
+				const int base = 48 + ( p / ChordInterval * 5 ) % 24;
+				for( int key : { base, base + 4, base + 7 } )
+				{
+					notes << NotePlayHandleManager::acquire( it,
+						0, ChordLength * fpp,
+						Note( 0, 0, key ) );
+				}
+			}
+
+			for( int i = 0; i < notes.size(); ++i )
+			{
+				BufferManager::clear( buf, fpp );
+				notes[i]->play( buf );
+				if( notes[i]->isFinished() )
+				{
+					NotePlayHandleManager::release( notes[i] );
+					notes.removeAt( i-- );
+				}
+			}
+			if( singleStreamed )
+			{
+				BufferManager::clear( buf, fpp );
+				instrument->play( buf );
+			}
+
+			if( measure )
+			{
+				elapsed += Clock::now() - start;
+				s_countAllocations = false;
+				allocations += s_allocations;
+			}
+		}
+
+		for( NotePlayHandle * n : notes )
+		{
+			NotePlayHandleManager::release( n );
+		}
+		BufferManager::release( buf );
+		delete it;
+
+		addResult( _name, "instrument", fpp, elapsed, allocations );
+	}
+
+	void benchmarkEffect( const QString & _name, int _frames )
+	{
+		const fpp_t frames = qBound<int>( 1, _frames,
+					Engine::mixer()->framesPerPeriod() );
+
+		srand( RandomSeed );
+
+		EffectChain chain( NULL );
+		Effect * effect = Effect::instantiate( _name, &chain, NULL );
+		if( effect == NULL || effect->isOkay() == false )
+		{
+			fprintf( stderr, "Failed to instantiate %s.\n",
+						_name.toUtf8().constData() );
+			delete effect;
+			return;
+		}
+
+		sampleFrame * buf = BufferManager::acquire();
+		Clock::duration elapsed = Clock::duration::zero();
+		int allocations = 0;
+		f_cnt_t pos = 0;
+
+		for( int p = 0; p < WarmupPeriods + m_periods; ++p )
+		{
+			// a sine with some noise on top, so that effects with
+			// gates or auto-quit keep working
+			for( fpp_t f = 0; f < frames; ++f, ++pos )
+			{
+				const float noise = ( rand() % 2001 - 1000 ) /
+								10000.0f;
+				const float s = 0.5f * sinf( pos * 0.0314f );
+				buf[f][0] = s + noise;
+				buf[f][1] = -s + noise;
+			}
+
+			const bool measure = p >= WarmupPeriods;
+			if( measure )
+			{
+				s_allocations = 0;
+				s_countAllocations = true;
+			}
+			const Clock::time_point start = Clock::now();
+
+			effect->startRunning();
+			effect->processAudioBuffer( buf, frames );
+
+			if( measure )
+			{
+				elapsed += Clock::now() - start;
+				s_countAllocations = false;
+				allocations += s_allocations;
+			}
+		}
+
+		BufferManager::release( buf );
+		delete effect;
+
+		addResult( _name, "effect", frames, elapsed, allocations );
+	}
+
+	void addResult( const QString & _name, const char * _type,
+				int _frames, Clock::duration _elapsed,
+							int _allocations )
+	{
+		const double ns = std::chrono::duration<double, std::nano>(
+							_elapsed ).count();
+
+		m_json += m_firstResult ? "\t{ " : ",\n\t{ ";
+		m_json += "\"plugin\": \"" + _name.toUtf8() + "\"";
+		m_json += ", \"type\": \"" + QByteArray( _type ) + "\"";
+		m_json += ", \"sampleRate\": " + QByteArray::number(
+				Engine::mixer()->processingSampleRate() );
+		m_json += ", \"frames\": " + QByteArray::number( _frames );
+		m_json += ", \"nsPerFrame\": " + QByteArray::number(
+				ns / ( (double) m_periods * _frames ), 'f', 2 );
+		m_json += ", \"allocationsPerPeriod\": " + QByteArray::number(
+				(double) _allocations / m_periods, 'f', 2 );
+		m_json += " }";
+		m_firstResult = false;
+	}
+
+	int m_periods;
+	QList<int> m_frames;
+	QList<int> m_oversampling;
+
+	QByteArray m_json;
+	bool m_firstResult;
+
+} ;
+
+
+
+
+static QList<int> parseList( const char * _arg )
+{
+	QList<int> list;
+	for( const QString & n : QString( _arg ).split( ',',
+						QString::SkipEmptyParts ) )
+	{
+		if( n.toInt() > 0 )
+		{
+			list << n.toInt();
+		}
+	}
+	return list;
+}
+
+
+
+
+int main( int argc, char * * argv )
+{
+	NotePlayHandleManager::init();
+
+	new QCoreApplication( argc, argv );
+
+	int periods = 500;
+	QList<int> frames = QList<int>() << 64 << 128 << 256;
+	QList<int> oversampling = QList<int>() << 1 << 2 << 4;
+	QString output;
+	QStringList plugins;
+
+	for( int i = 1; i < argc; ++i )
+	{
+		const QString arg = argv[i];
+		if( ( arg == "--periods" || arg == "--frames" ||
+			arg == "--oversampling" || arg == "-o" ) && i + 1 < argc )
+		{
+			++i;
+			if( arg == "--periods" )
+			{
+				periods = qMax( QString( argv[i] ).toInt(), 1 );
+			}
+			else if( arg == "--frames" )
+			{
+				frames = parseList( argv[i] );
+			}
+			else if( arg == "--oversampling" )
+			{
+				oversampling = parseList( argv[i] );
+			}
+			else
+			{
+				output = QString::fromLocal8Bit( argv[i] );
+			}
+		}
+		else if( arg.startsWith( '-' ) )
+		{
+			printf( "Usage: %s [--periods <n>] [--frames <list>] "
+				"[--oversampling <list>] [-o <file>] "
+							"[plugins...]\n\n"
+				"Benchmarks all instrument and effect plugins "
+				"if none are given. Set LMMS_PLUGIN_DIR\n"
+				"if the plugins can't be found.\n", argv[0] );
+			return arg == "--help" || arg == "-h" ?
+						EXIT_SUCCESS : EXIT_FAILURE;
+		}
+		else
+		{
+			plugins << arg;
+		}
+	}
+
+	Engine::init( true );
+
+	PluginBenchmark b( periods, frames, oversampling );
+	const QByteArray json = b.run( plugins );
+
+	int ret = EXIT_SUCCESS;
+	if( output.isEmpty() )
+	{
+		fwrite( json.constData(), 1, json.size(), stdout );
+	}
+	else
+	{
+		QFile f( output );
+		if( !f.open( QIODevice::WriteOnly ) || f.write( json ) != json.size() )
+		{
+			fprintf( stderr, "Could not write %s.\n",
+						output.toUtf8().constData() );
+			ret = EXIT_FAILURE;
+		}
+	}
+
+	Engine::destroy();
+	return ret;
+}
@@ -0,0 +1,96 @@
+/*
+ * FreezeCacheTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "FreezeCache.h"
+
+class FreezeCacheTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void ReadWriteTests()
+	{
+		FreezeCache * cache = new FreezeCache;
+		QVERIFY(cache->allocate(8, 44100, QByteArray("hash")));
+		QCOMPARE(cache->frames(), 8);
+
+		sampleFrame src[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			src[i][0] = src[i][1] = i + 1;
+		}
+		cache->write(src, 4);
+		cache->write(src, 4);
+		cache->write(src, 4);
+		QCOMPARE(cache->framesWritten(), 8);
+
+		// reads outside of the cached range must be silent
+		sampleFrame dst[4];
+		cache->read(-2, dst, 4);
+		QCOMPARE(dst[0][0], 0.0f);
+		QCOMPARE(dst[1][0], 0.0f);
+		QCOMPARE(dst[2][0], 1.0f);
+		QCOMPARE(dst[3][1], 2.0f);
+
+		cache->read(6, dst, 4);
+		QCOMPARE(dst[0][0], 3.0f);
+		QCOMPARE(dst[1][0], 4.0f);
+		QCOMPARE(dst[2][0], 0.0f);
+		QCOMPARE(dst[3][1], 0.0f);
+
+		sharedObject::unref(cache);
+	}
+
+	void TickMapTests()
+	{
+		FreezeCache * cache = new FreezeCache;
+		QVERIFY(cache->allocate(64, 44100, QByteArray("hash")));
+
+		// nothing rendered yet, so the current tempo is all we know
+		QCOMPARE(cache->tickFrame(3, 10.0f), 30);
+
+		sampleFrame src[16] = {};
+		// two ticks per period, the second period at a slower tempo
+		cache->markTick(0, 0);
+		cache->markTick(1, 8);
+		cache->write(src, 16);
+		cache->markTick(2, 0);
+		cache->markTick(3, 12);
+		cache->write(src, 16);
+
+		QCOMPARE(cache->tickFrame(0, 10.0f), 0);
+		QCOMPARE(cache->tickFrame(1, 10.0f), 8);
+		QCOMPARE(cache->tickFrame(2, 10.0f), 16);
+		QCOMPARE(cache->tickFrame(3, 10.0f), 28);
+		// past the render, continue from the last tick
+		QCOMPARE(cache->tickFrame(5, 10.0f), 48);
+
+		// revisiting a tick keeps where it was rendered first
+		cache->markTick(1, 0);
+		QCOMPARE(cache->tickFrame(1, 10.0f), 8);
+
+		sharedObject::unref(cache);
+	}
+} FreezeCacheTests;
+
+#include "FreezeCacheTest.moc"
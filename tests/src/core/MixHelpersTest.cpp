@@ -0,0 +1,73 @@
+/*
+ * MixHelpersTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include <cmath>
+#include <limits>
+
+#include "Mixer.h"
+#include "MixHelpers.h"
+
+class MixHelpersTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void ConvertToS16Tests()
+	{
+		// odd length, so that both the vectorized part and the rest
+		// are covered
+		const int samples = 67;
+		sample_t src[samples];
+		for (int i = 0; i < samples; ++i)
+		{
+			src[i] = sinf(i * 0.7f) * 1.5f;
+		}
+		src[3] = std::numeric_limits<float>::quiet_NaN();
+		src[10] = std::numeric_limits<float>::infinity();
+		src[11] = -std::numeric_limits<float>::infinity();
+		src[12] = 1.0f;
+		src[13] = -1.0f;
+		src[samples - 1] = std::numeric_limits<float>::quiet_NaN();
+
+		const float gain = 0.9f;
+		for (int swapBytes = 0; swapBytes < 2; ++swapBytes)
+		{
+			int_sample_t dst[samples];
+			MixHelpers::convertToS16(dst, src, gain, samples, swapBytes);
+
+			for (int i = 0; i < samples; ++i)
+			{
+				// the per sample loop AudioDevice::convertToS16()
+				// used to run, with NaNs being silenced
+				const float v = std::isnan(src[i]) ? 0.0f : src[i] * gain;
+				const int_sample_t s = static_cast<int_sample_t>(
+						Mixer::clip(v) * OUTPUT_SAMPLE_MULTIPLIER);
+				const int_sample_t expected = swapBytes ?
+						((s & 0x00ff) << 8 | (s & 0xff00) >> 8) : s;
+				QCOMPARE(dst[i], expected);
+			}
+		}
+	}
+} MixHelpersTests;
+
+#include "MixHelpersTest.moc"
@@ -0,0 +1,65 @@
+/*
+ * SampleDataCacheTest.cpp
+ *
+ * This file is part of LMMS - https://lmms.io
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program (see COPYING); if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin Street, Fifth Floor,
+ * Boston, MA 02110-1301 USA.
+ *
+ */
+
+#include "QTestSuite.h"
+
+#include "SampleData.h"
+#include "SampleDataCache.h"
+
+class SampleDataCacheTest : QTestSuite
+{
+	Q_OBJECT
+private slots:
+	void SharingTests()
+	{
+		sampleFrame frames[4];
+		for (int i = 0; i < 4; ++i)
+		{
+			frames[i][0] = frames[i][1] = i;
+		}
+		const QString key = SampleDataCache::dataKey(frames, 4);
+		QCOMPARE(SampleDataCache::dataKey(frames, 4), key);
+		QVERIFY(SampleDataCache::dataKey(frames, 3) != key);
+
+		QVERIFY(SampleDataCache::acquire(key) == NULL);
+
+		SampleData * first = SampleDataCache::insert(key,
+				new SampleData(MM_ALLOC(sampleFrame, 4), 4));
+		QVERIFY(SampleDataCache::acquire(key) == first);
+
+		// data inserted for the same key later on is dropped
+		SampleData * second = SampleDataCache::insert(key,
+				new SampleData(MM_ALLOC(sampleFrame, 4), 4));
+		QVERIFY(second == first);
+
+		sharedObject::unref(first);
+		sharedObject::unref(first);
+		QVERIFY(SampleDataCache::acquire(key) == first);
+		sharedObject::unref(first);
+
+		// the cache doesn't keep released data alive
+		sharedObject::unref(first);
+		QVERIFY(SampleDataCache::acquire(key) == NULL);
+	}
+} SampleDataCacheTests;
+
+#include "SampleDataCacheTest.moc"